@@ -0,0 +1,104 @@
+﻿#include "Analyzer.h"
+#include "Compiler.h"
+#include "Validator.h"
+
+AnalyzerContext::AnalyzerContext(const vector<string>& modulePath) : interfaces(modulePath)
+{
+}
+
+bool AnalyzerContext::addModule(const string& module, const vector<FunctionSignature>& functions, string& error)
+{
+    string bytes;
+    if (!InterfaceFile::encode(functions, bytes, error))
+        return false;
+    return interfaces.add(module, bytes.data(), bytes.size(), error);
+}
+
+bool AnalyzerContext::addModule(const string& module, const char* data, size_t size, string& error)
+{
+    return interfaces.add(module, data, size, error);
+}
+
+bool AnalyzerContext::analyze(const char* source, size_t size, const AnalysisOptions& options, AnalysisResult& result)
+{
+    return analyze(string(source, size), options, result);
+}
+
+bool AnalyzerContext::analyze(const string& source, const AnalysisOptions& options, AnalysisResult& result)
+{
+    StringInterner strings;     // Словарь этого анализа - результат на него не ссылается
+    strings.internKeywords();
+    CompileResult compiled;
+    compileSource(source, options.report ? options.treeFormat : "none", &interfaces,
+        options.needIr, compiled, options.parseThreads, strings, options.limits);
+
+    result = AnalysisResult();
+    result.correct = compiled.syntaxCorrect;
+    for (const string& text : compiled.errors)
+        result.errors.push_back(parseDiagnostic(text));
+    for (const string& text : compiled.warnings)
+        result.warnings.push_back(parseDiagnostic(text));
+    result.postfix = move(compiled.postfix);
+    if (options.report)
+        result.report = move(compiled.report);
+    result.program = move(compiled.program);
+    result.irError = move(compiled.irError);
+    result.exported = compiled.exported;
+    result.signature = move(compiled.signature);
+    result.aborted = compiled.aborted;
+    return result.correct;
+}
+
+bool AnalyzerContext::check(const char* source, size_t size, Diagnostic& error, const ResourceLimits& limits)
+{
+    ResourceBudget budget(limits);
+    Validator validator(&interfaces);
+    if (limits.any())   // Без ограничений счет лексем не нужен и проверке
+        validator.setBudget(&budget);
+    string message;
+    if (validator.validate(source, size, message))
+    {
+        error = Diagnostic();
+        return true;
+    }
+    error = parseDiagnostic(message);
+    return false;
+}
+
+static bool readNumber(const string& text, size_t& pos, int64_t& value)
+{
+    size_t start = pos;
+    value = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+        value = value * 10 + (text[pos++] - '0');
+    return pos > start;
+}
+
+Diagnostic AnalyzerContext::parseDiagnostic(const string& text)
+{
+    static const string LINE = "строка ";
+    static const string POSITION = ", позиция ";
+
+    Diagnostic diagnostic;
+    diagnostic.message = text;
+    if (text.compare(0, LINE.size(), LINE) != 0)
+        return diagnostic;
+
+    size_t pos = LINE.size();
+    int64_t line = 0, position = 0;
+    if (!readNumber(text, pos, line))
+        return diagnostic;
+    if (text.compare(pos, POSITION.size(), POSITION) == 0)
+    {
+        pos += POSITION.size();
+        if (!readNumber(text, pos, position))
+            return diagnostic;
+    }
+    if (text.compare(pos, 2, ": ") != 0)
+        return diagnostic;
+
+    diagnostic.line = line;
+    diagnostic.position = position;
+    diagnostic.message = text.substr(pos + 2);
+    return diagnostic;
+}
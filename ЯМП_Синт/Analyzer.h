@@ -0,0 +1,81 @@
+﻿#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include "Ir.h"
+#include "Interface.h"
+#include "ResourceBudget.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+struct Diagnostic           // Ошибка или предупреждение анализа
+{
+    int64_t line;           // 0 - место не указано
+    int64_t position;       // 0 - указана только строка
+    string message;         // Текст без места
+
+    Diagnostic() : line(0), position(0) {}
+};
+
+struct AnalysisOptions
+{
+    bool report;            // Собрать текстовый отчет - тот же, что в output.txt
+    string treeFormat;      // Формат дерева в отчете: text или json
+    bool needIr;            // Построить IR корректной программы - для генерации кода
+    unsigned parseThreads;  // Потоков разбора и проверок типов длинных последовательностей операторов
+    ResourceLimits limits;  // Бюджет анализа текста, которому нельзя доверять
+
+    AnalysisOptions() : report(false), treeFormat("text"), needIr(false), parseThreads(1) {}
+};
+
+struct AnalysisResult       // Итог анализа одного текста
+{
+    bool correct;
+    vector<Diagnostic> errors;      // В порядке отчета
+    vector<Diagnostic> warnings;    // Только у корректной программы
+    vector<string> postfix;         // Постфиксная запись по командам
+    string report;                  // Если запрошен
+    IrFunction program;             // Если запрошен
+    string irError;
+    bool exported;                  // Программа корректна, signature - ее функция
+    FunctionSignature signature;
+    bool aborted;                   // Превышен бюджет - причина в последней ошибке
+
+    AnalysisResult() : correct(false), exported(false), aborted(false) {}
+};
+
+// Анализатор для встраивания в многопоточный сервер: текст - из памяти, результат -
+// в структурах, без файлов и без изменения состояния процесса (локаль не меняется).
+// Анализы разделяют между собой только интерфейсы модулей для import - они принадлежат
+// контексту. Словарь текстов лексем у каждого анализа свой и освобождается вместе с ним:
+// память контекста не растет с числом обработанных запросов, а текст одного запроса
+// ограничен пределами StringInterner и ResourceLimits. Методы контекста можно вызывать
+// из нескольких потоков одновременно; контексты друг от друга не зависят.
+// Единственное общее для процесса - профилирование Trace, и то только если
+// оно явно включено (Trace::enable).
+class AnalyzerContext
+{
+private:
+    InterfaceLibrary interfaces;
+
+public:
+    explicit AnalyzerContext(const vector<string>& modulePath = vector<string>());  // Каталоги с .ifc
+    AnalyzerContext(const AnalyzerContext&) = delete;
+    AnalyzerContext& operator=(const AnalyzerContext&) = delete;
+
+    // Модуль для import без файла на диске: сигнатуры функций или содержимое .ifc
+    bool addModule(const string& module, const vector<FunctionSignature>& functions, string& error);
+    bool addModule(const string& module, const char* data, size_t size, string& error);
+
+    bool analyze(const char* source, size_t size, const AnalysisOptions& options, AnalysisResult& result);
+    bool analyze(const string& source, const AnalysisOptions& options, AnalysisResult& result);
+
+    // Только корректность и первая ошибка - без таблицы лексем, дерева и постфикса (см. Validator)
+    bool check(const char* source, size_t size, Diagnostic& error, const ResourceLimits& limits = ResourceLimits());
+
+    static Diagnostic parseDiagnostic(const string& text);  // "строка L, позиция P: текст"
+};
+
+#endif
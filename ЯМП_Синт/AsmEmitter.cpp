@@ -0,0 +1,648 @@
+﻿#include "AsmEmitter.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cmath>
+
+// Пулы регистров под переменные - только регистры, не сохраняемые вызываемой функцией.
+// eax/xmm0 - аккумулятор (и регистр результата), xmm15 - вспомогательный для вычитания.
+static const char* const INT_REGS[] = { "ecx", "edx", "esi", "edi", "r8d", "r9d", "r10d", "r11d" };
+static const char* const DOUBLE_REGS[] = { "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7",
+    "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14" };
+// Регистры аргументов System V ABI
+static const char* const INT_ARG_REGS[] = { "edi", "esi", "edx", "ecx", "r8d", "r9d" };
+static const char* const DOUBLE_ARG_REGS[] = { "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7" };
+static const int INT_REG_COUNT = sizeof(INT_REGS) / sizeof(INT_REGS[0]);
+static const int DOUBLE_REG_COUNT = sizeof(DOUBLE_REGS) / sizeof(DOUBLE_REGS[0]);
+
+static uint64_t doubleBits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Имя допустимо как символ объектного файла: латиница, цифры и _, не с цифры
+static bool isValidSymbol(const string& name)
+{
+    bool valid = !name.empty() && !isdigit((unsigned char)name[0]);
+    for (unsigned char c : name)
+        valid = valid && c < 0x80 && (isalnum(c) || c == '_');
+    return valid;
+}
+
+AsmEmitter::AsmEmitter(const IrFunction& fn)
+    : function(fn), outgoingSlots(0), frameSlots(0), tempSlots(0), body(nullptr)
+{
+}
+
+// Интервал жизни переменной - от первой записи (или входа в функцию, если
+// переменная читается до записи и должна быть нулевой) до последнего места,
+// где ее значение снимается со стека выражения.
+void AsmEmitter::allocateRegisters()
+{
+    size_t count = function.variables.size();
+    vector<int> first(count, -2), last(count, -2);
+    zeroInit.assign(count, false);
+    locations.assign(count, Location{ -1, -1 });
+
+    for (int param : function.parameters)   // Параметры определены с момента входа
+        first[param] = last[param] = -1;
+
+    vector<int> producers;      // Переменная, лежащая на стеке выражения, или -1
+    vector<int> callSites;
+    size_t maxDepth = 0;
+    auto consume = [&](int at)
+    {
+        int var = producers.back();
+        producers.pop_back();
+        if (var >= 0)
+            last[var] = max(last[var], at);
+    };
+
+    for (int i = 0; i < (int)function.code.size(); i++)
+    {
+        const IrInstr& instr = function.code[i];
+        switch (instr.op)
+        {
+        case IrOp::LOAD:
+            if (first[instr.var] == -2)
+            {
+                first[instr.var] = -1;
+                zeroInit[instr.var] = true;
+            }
+            last[instr.var] = max(last[instr.var], i);
+            producers.push_back(instr.var);
+            break;
+        case IrOp::CONST_INT:
+        case IrOp::CONST_DOUBLE:
+            producers.push_back(-1);
+            break;
+        case IrOp::ADD:
+        case IrOp::SUB:
+            consume(i);
+            consume(i);
+            producers.push_back(-1);
+            break;
+        case IrOp::ITOD:
+        case IrOp::DTOI:
+            consume(i);
+            producers.push_back(-1);
+            break;
+        case IrOp::STORE:
+            consume(i);
+            if (first[instr.var] == -2)
+                first[instr.var] = i;
+            last[instr.var] = max(last[instr.var], i);
+            break;
+        case IrOp::CALL:
+            for (size_t p = 0; p < function.callees[instr.var].params.size(); p++)
+                consume(i);
+            producers.push_back(-1);
+            callSites.push_back(i);
+            break;
+        case IrOp::RETURN:
+            consume(i);
+            break;
+        }
+        maxDepth = max(maxDepth, producers.size());
+    }
+
+    for (int param : function.parameters)   // Неиспользуемому параметру место не нужно
+        if (last[param] == -1)
+            first[param] = -2;
+
+    // Линейное сканирование отдельно для целых и вещественных регистров
+    for (ValueType type : { ValueType::INT, ValueType::DOUBLE })
+    {
+        struct Interval { int var, start, end; };
+        vector<Interval> intervals;
+        for (size_t v = 0; v < count; v++)
+            if (function.variables[v].type == type && first[v] != -2)
+                intervals.push_back({ (int)v, first[v], last[v] });
+        sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b)
+            { return a.start != b.start ? a.start < b.start : a.var < b.var; });
+
+        int regCount = type == ValueType::INT ? INT_REG_COUNT : DOUBLE_REG_COUNT;
+        vector<int> freeRegs;
+        for (int r = regCount - 1; r >= 0; r--)
+            freeRegs.push_back(r);
+        vector<Interval> active;    // По возрастанию конца интервала
+
+        for (const Interval& current : intervals)
+        {
+            while (!active.empty() && active.front().end < current.start)   // Освобождаем истекшие
+            {
+                freeRegs.push_back(locations[active.front().var].reg);
+                active.erase(active.begin());
+            }
+
+            if (!freeRegs.empty())
+            {
+                locations[current.var].reg = freeRegs.back();
+                freeRegs.pop_back();
+            }
+            else if (active.back().end > current.end)   // Вытесняем интервал, живущий дольше всех
+            {
+                Interval spilled = active.back();
+                active.pop_back();
+                locations[current.var].reg = locations[spilled.var].reg;
+                locations[spilled.var] = Location{ -1, frameSlots++ };
+            }
+            else
+            {
+                locations[current.var].slot = frameSlots++;
+                continue;
+            }
+            auto pos = upper_bound(active.begin(), active.end(), current,
+                [](const Interval& a, const Interval& b) { return a.end < b.end; });
+            active.insert(pos, current);
+        }
+    }
+
+    // Регистры пулов не сохраняются вызываемой функцией: переменной, которая живет
+    // в регистре через вызов (или передается в него аргументом), нужен слот для копии
+    liveStart = first;
+    liveEnd = last;
+    saveSlots.assign(count, -1);
+    outgoingSlots = 0;
+    for (int at : callSites)
+    {
+        int intArgs = 0, doubleArgs = 0, stackArgs = 0;
+        for (ValueType type : function.callees[function.code[at].var].params)
+        {
+            if (type == ValueType::INT ? intArgs++ >= 6 : doubleArgs++ >= 8)
+                stackArgs++;
+        }
+        outgoingSlots = max(outgoingSlots, stackArgs);
+        for (size_t v = 0; v < count; v++)
+            if (locations[v].reg >= 0 && saveSlots[v] < 0 && first[v] < at && last[v] >= at)
+                saveSlots[v] = frameSlots++;
+    }
+
+    // Каждый элемент стека выражения может быть вытеснен не более чем в один слот
+    tempSlots = (int)maxDepth;
+    freeTemps.clear();
+    for (int t = tempSlots - 1; t >= 0; t--)
+        freeTemps.push_back(t);
+}
+
+string AsmEmitter::slotAddress(int slot, ValueType type) const
+{
+    return string(type == ValueType::INT ? "dword" : "qword") + " ptr [rsp + " + to_string((outgoingSlots + slot) * 8) + "]";
+}
+
+string AsmEmitter::varText(int var) const
+{
+    const Location& loc = locations[var];
+    ValueType type = function.variables[var].type;
+    if (loc.reg >= 0)
+        return type == ValueType::INT ? INT_REGS[loc.reg] : DOUBLE_REGS[loc.reg];
+    return slotAddress(loc.slot, type);
+}
+
+string AsmEmitter::operandText(const Operand& operand)
+{
+    switch (operand.kind)
+    {
+    case Operand::IMM:
+        if (operand.type == ValueType::INT)
+            return to_string(operand.intValue);
+        else
+        {
+            // Вещественные константы берутся из .rodata относительно rip
+            uint64_t bits = doubleBits(operand.doubleValue);
+            size_t index = 0;
+            while (index < constants.size() && doubleBits(constants[index]) != bits)
+                index++;
+            if (index == constants.size())
+                constants.push_back(operand.doubleValue);
+            return "qword ptr [rip + .L" + symbol + "_c" + to_string(index) + "]";
+        }
+    case Operand::VAR:
+        return varText(operand.index);
+    case Operand::ACC:
+        return operand.type == ValueType::INT ? "eax" : "xmm0";
+    case Operand::TEMP:
+        return slotAddress(frameSlots + operand.index, operand.type);
+    }
+    return "";
+}
+
+bool AsmEmitter::inMemory(const Operand& operand) const
+{
+    if (operand.kind == Operand::TEMP)
+        return true;
+    if (operand.kind == Operand::VAR)
+        return locations[operand.index].reg < 0;
+    return operand.kind == Operand::IMM && operand.type == ValueType::DOUBLE;
+}
+
+int AsmEmitter::allocateTemp()
+{
+    int slot = freeTemps.back();
+    freeTemps.pop_back();
+    return slot;
+}
+
+void AsmEmitter::releaseTemp(const Operand& operand)
+{
+    if (operand.kind == Operand::TEMP)
+        freeTemps.push_back(operand.index);
+}
+
+void AsmEmitter::spillAccumulator(ValueType type)  // Аккумулятор нужен под новое значение
+{
+    for (Operand& operand : stack)
+        if (operand.kind == Operand::ACC && operand.type == type)
+        {
+            int slot = allocateTemp();
+            *body << "    " << (type == ValueType::INT ? "mov" : "movsd") << " "
+                << slotAddress(frameSlots + slot, type) << ", " << operandText(operand) << "\n";
+            operand.kind = Operand::TEMP;
+            operand.index = slot;
+        }
+}
+
+void AsmEmitter::toAccumulator(Operand& operand)
+{
+    if (operand.kind == Operand::ACC)
+        return;
+    spillAccumulator(operand.type);
+
+    if (operand.type == ValueType::INT)
+    {
+        if (operand.kind == Operand::IMM && operand.intValue == 0)
+            *body << "    xor eax, eax\n";
+        else
+            *body << "    mov eax, " << operandText(operand) << "\n";
+    }
+    else
+    {
+        if (operand.kind == Operand::IMM && doubleBits(operand.doubleValue) == 0)
+            *body << "    xorpd xmm0, xmm0\n";
+        else if (inMemory(operand))
+            *body << "    movsd xmm0, " << operandText(operand) << "\n";
+        else
+            *body << "    movapd xmm0, " << operandText(operand) << "\n";
+    }
+    releaseTemp(operand);
+    operand.kind = Operand::ACC;
+}
+
+void AsmEmitter::emitBinary(bool add)
+{
+    Operand right = stack.back();
+    stack.pop_back();
+    Operand left = stack.back();
+    stack.pop_back();
+
+    if (left.kind == Operand::IMM && right.kind == Operand::IMM)   // Свертка констант
+    {
+        if (left.type == ValueType::INT)    // Переполнение - по модулю 2^32, как в машинной команде
+            left.intValue = (int32_t)(add ? (uint32_t)left.intValue + (uint32_t)right.intValue
+                : (uint32_t)left.intValue - (uint32_t)right.intValue);
+        else
+            left.doubleValue = add ? left.doubleValue + right.doubleValue : left.doubleValue - right.doubleValue;
+        stack.push_back(left);
+        return;
+    }
+
+    bool isInt = left.type == ValueType::INT;
+    if (add && right.kind == Operand::ACC)      // Сложение коммутативно - аккумулятор слева
+        swap(left, right);
+
+    if (!add && right.kind == Operand::ACC)     // left - acc: правый операнд уже в аккумуляторе
+    {
+        if (isInt)
+        {
+            *body << "    neg eax\n";
+            *body << "    add eax, " << operandText(left) << "\n";
+            releaseTemp(left);
+        }
+        else
+        {
+            *body << "    movapd xmm15, xmm0\n";
+            toAccumulator(left);
+            *body << "    subsd xmm0, xmm15\n";
+        }
+    }
+    else
+    {
+        toAccumulator(left);
+        *body << "    " << (isInt ? (add ? "add" : "sub") : (add ? "addsd" : "subsd")) << " "
+            << (isInt ? "eax" : "xmm0") << ", " << operandText(right) << "\n";
+        releaseTemp(right);
+    }
+
+    left.kind = Operand::ACC;
+    stack.push_back(left);
+}
+
+void AsmEmitter::emitConversion(bool toDouble)
+{
+    Operand operand = stack.back();
+    stack.pop_back();
+
+    Operand result = operand;
+    result.type = toDouble ? ValueType::DOUBLE : ValueType::INT;
+    if (operand.kind == Operand::IMM)
+    {
+        if (toDouble)
+            result.doubleValue = operand.intValue;
+        else
+            result.intValue = truncateToInt32(operand.doubleValue);
+        stack.push_back(result);
+        return;
+    }
+
+    spillAccumulator(result.type);
+    *body << "    " << (toDouble ? "cvtsi2sd xmm0, " : "cvttsd2si eax, ") << operandText(operand) << "\n";
+    releaseTemp(operand);
+    result.kind = Operand::ACC;
+    stack.push_back(result);
+}
+
+void AsmEmitter::emitStore(int var)
+{
+    Operand value = stack.back();
+    stack.pop_back();
+
+    string dest = varText(var);
+    bool destInRegister = locations[var].reg >= 0;
+    bool isInt = function.variables[var].type == ValueType::INT;
+
+    if (destInRegister && value.kind == Operand::IMM &&
+        (isInt ? value.intValue == 0 : doubleBits(value.doubleValue) == 0))    // Обнуление регистра
+    {
+        *body << "    " << (isInt ? "xor " : "xorpd ") << dest << ", " << dest << "\n";
+        return;
+    }
+    if (!destInRegister && inMemory(value))     // Память в память - через аккумулятор
+        toAccumulator(value);
+
+    string source = operandText(value);
+    if (source != dest)     // Присваивание переменной, которой достался тот же регистр, не нужно
+    {
+        if (isInt)
+            *body << "    mov " << dest << ", " << source << "\n";
+        else
+            *body << "    " << (destInRegister && !inMemory(value) ? "movapd " : "movsd ") << dest << ", " << source << "\n";
+    }
+    releaseTemp(value);
+}
+
+// Перенос параметров из регистров и стека вызова в места, выбранные распределителем.
+// Пересылки между регистрами - параллельные: порядок выбирается так, чтобы не затереть
+// еще не прочитанный источник, циклы разрываются через eax / xmm15.
+void AsmEmitter::emitParameterMoves(int frameSize)
+{
+    struct Move { string dest, source; bool isInt; };
+    vector<Move> registerMoves, memoryMoves;
+    int intArgs = 0, doubleArgs = 0, stackArgs = 0;
+
+    for (int param : function.parameters)
+    {
+        bool isInt = function.variables[param].type == ValueType::INT;
+        string source;
+        if (isInt && intArgs < 6)
+            source = INT_ARG_REGS[intArgs++];
+        else if (!isInt && doubleArgs < 8)
+            source = DOUBLE_ARG_REGS[doubleArgs++];
+        else    // Над адресом возврата, в порядке параметров
+            source = string(isInt ? "dword" : "qword") + " ptr [rsp + " + to_string(frameSize + 8 + 8 * stackArgs++) + "]";
+
+        const Location& loc = locations[param];
+        if (loc.reg < 0 && loc.slot < 0)    // Параметр не используется
+            continue;
+        string dest = varText(param);
+        if (dest == source)
+            continue;
+        (loc.reg >= 0 && source.find("ptr") == string::npos ? registerMoves : memoryMoves).push_back({ dest, source, isInt });
+    }
+
+    // Сначала записи в память (источники - еще не тронутые регистры)
+    for (const Move& move : memoryMoves)
+    {
+        if (move.dest.find("ptr") == string::npos)
+            continue;
+        string source = move.source;
+        if (source.find("ptr") != string::npos)     // Из стека вызова в кадр - через вспомогательный регистр
+        {
+            source = move.isInt ? "eax" : "xmm15";
+            *body << "    " << (move.isInt ? "mov " : "movsd ") << source << ", " << move.source << "\n";
+        }
+        *body << "    " << (move.isInt ? "mov " : "movsd ") << move.dest << ", " << source << "\n";
+    }
+
+    while (!registerMoves.empty())
+    {
+        bool progress = false;
+        for (size_t i = 0; i < registerMoves.size(); i++)
+        {
+            bool blocked = false;   // Приемник еще нужен как источник другой пересылки
+            for (size_t j = 0; j < registerMoves.size(); j++)
+                blocked = blocked || (j != i && registerMoves[j].source == registerMoves[i].dest);
+            if (blocked)
+                continue;
+            const Move& move = registerMoves[i];
+            *body << "    " << (move.isInt ? "mov " : "movapd ") << move.dest << ", " << move.source << "\n";
+            registerMoves.erase(registerMoves.begin() + i);
+            progress = true;
+            break;
+        }
+        if (!progress)  // Остались только циклы - один источник уводим во вспомогательный регистр
+        {
+            Move& move = registerMoves.front();
+            string scratch = move.isInt ? "eax" : "xmm15";
+            *body << "    " << (move.isInt ? "mov " : "movapd ") << scratch << ", " << move.source << "\n";
+            move.source = scratch;
+        }
+    }
+
+    // Параметры из стека вызова в регистры (источники в памяти не затираются)
+    for (const Move& move : memoryMoves)
+        if (move.dest.find("ptr") == string::npos)
+            *body << "    " << (move.isInt ? "mov " : "movsd ") << move.dest << ", " << move.source << "\n";
+}
+
+// Аргументы читаются из памяти или непосредственных значений, поэтому регистры
+// аргументов заполняются в любом порядке: переменная из регистра берется из своей
+// копии в кадре, а не из регистра, который мог быть уже занят другим аргументом.
+void AsmEmitter::emitCall(const IrInstr& instr, int at)
+{
+    const FunctionSignature& callee = function.callees[instr.var];
+    spillAccumulator(ValueType::INT);       // eax и xmm0 затираются вызовом
+    spillAccumulator(ValueType::DOUBLE);
+
+    for (size_t v = 0; v < saveSlots.size(); v++)
+        if (saveSlots[v] >= 0 && liveStart[v] < at && liveEnd[v] >= at)
+        {
+            ValueType type = function.variables[v].type;
+            *body << "    " << (type == ValueType::INT ? "mov " : "movsd ") << slotAddress(saveSlots[v], type)
+                << ", " << varText((int)v) << "\n";
+        }
+
+    vector<Operand> args(stack.end() - callee.params.size(), stack.end());
+    stack.resize(stack.size() - callee.params.size());
+    int intArgs = 0, doubleArgs = 0, stackArgs = 0;
+    for (const Operand& arg : args)
+    {
+        bool isInt = arg.type == ValueType::INT;
+        string source = arg.kind == Operand::VAR && locations[arg.index].reg >= 0
+            ? slotAddress(saveSlots[arg.index], arg.type) : operandText(arg);
+        string dest;
+        if (isInt && intArgs < 6)
+            dest = INT_ARG_REGS[intArgs++];
+        else if (!isInt && doubleArgs < 8)
+            dest = DOUBLE_ARG_REGS[doubleArgs++];
+        else    // Остальные - в стек над адресом возврата, в порядке аргументов
+            dest = string(isInt ? "dword" : "qword") + " ptr [rsp + " + to_string(8 * stackArgs++) + "]";
+        bool destInMemory = dest.find("ptr") != string::npos;
+
+        if (isInt)
+        {
+            if (destInMemory && arg.kind != Operand::IMM)   // Память в память - через eax
+            {
+                *body << "    mov eax, " << source << "\n";
+                source = "eax";
+            }
+            if (!destInMemory && arg.kind == Operand::IMM && arg.intValue == 0)
+                *body << "    xor " << dest << ", " << dest << "\n";
+            else
+                *body << "    mov " << dest << ", " << source << "\n";
+        }
+        else
+        {
+            if (destInMemory)
+            {
+                *body << "    movsd xmm15, " << source << "\n";
+                source = "xmm15";
+            }
+            if (!destInMemory && arg.kind == Operand::IMM && doubleBits(arg.doubleValue) == 0)
+                *body << "    xorpd " << dest << ", " << dest << "\n";
+            else
+                *body << "    movsd " << dest << ", " << source << "\n";
+        }
+        releaseTemp(arg);
+    }
+
+    *body << "    call " << callee.name << "@PLT\n";
+
+    for (size_t v = 0; v < saveSlots.size(); v++)   // Восстанавливаем переменные, нужные после вызова
+        if (saveSlots[v] >= 0 && liveStart[v] < at && liveEnd[v] > at)
+        {
+            ValueType type = function.variables[v].type;
+            *body << "    " << (type == ValueType::INT ? "mov " : "movsd ") << varText((int)v)
+                << ", " << slotAddress(saveSlots[v], type) << "\n";
+        }
+
+    Operand result = { Operand::ACC, callee.returnType, 0, 0.0, -1 };
+    stack.push_back(result);
+}
+
+void AsmEmitter::emitInstr(const IrInstr& instr, int at)
+{
+    Operand operand = { Operand::IMM, instr.type, 0, 0.0, -1 };
+    switch (instr.op)
+    {
+    case IrOp::CONST_INT:
+        operand.intValue = instr.intValue;
+        stack.push_back(operand);
+        break;
+    case IrOp::CONST_DOUBLE:
+        operand.doubleValue = instr.doubleValue;
+        stack.push_back(operand);
+        break;
+    case IrOp::LOAD:    // Значение не копируется - операнд ссылается на место переменной
+        operand.kind = Operand::VAR;
+        operand.index = instr.var;
+        stack.push_back(operand);
+        break;
+    case IrOp::STORE:
+        emitStore(instr.var);
+        break;
+    case IrOp::ADD:
+    case IrOp::SUB:
+        emitBinary(instr.op == IrOp::ADD);
+        break;
+    case IrOp::ITOD:
+    case IrOp::DTOI:
+        emitConversion(instr.op == IrOp::ITOD);
+        break;
+    case IrOp::CALL:
+        emitCall(instr, at);
+        break;
+    case IrOp::RETURN:
+        operand = stack.back();
+        stack.pop_back();
+        toAccumulator(operand);
+        break;
+    }
+}
+
+bool AsmEmitter::emit(const string& symbolName, ostream& out, string& error)
+{
+    if (!isValidSymbol(symbolName))
+    {
+        error = "имя '" + symbolName + "' не может быть символом объектного файла";
+        return false;
+    }
+    for (const FunctionSignature& callee : function.callees)
+        if (!isValidSymbol(callee.name))
+        {
+            error = "имя '" + callee.name + "' не может быть символом объектного файла";
+            return false;
+        }
+    symbol = symbolName;
+
+    allocateRegisters();
+    stack.clear();
+    constants.clear();
+
+    int frameSize = (outgoingSlots + frameSlots + tempSlots) * 8;
+    if (!function.callees.empty() && frameSize % 16 == 0)     // В момент call rsp кратен 16
+        frameSize += 8;
+
+    ostringstream code;
+    body = &code;
+    emitParameterMoves(frameSize);
+    for (size_t v = 0; v < function.variables.size(); v++)  // Переменные, читаемые до записи, равны нулю
+        if (zeroInit[v])
+        {
+            Operand zero = { Operand::IMM, function.variables[v].type, 0, 0.0, -1 };
+            stack.push_back(zero);
+            emitStore((int)v);
+        }
+    for (size_t i = 0; i < function.code.size(); i++)
+        emitInstr(function.code[i], (int)i);
+    body = nullptr;
+
+    bool isDouble = function.returnType == ValueType::DOUBLE;
+
+    out << "# " << (isDouble ? "double " : "int ") << symbol << "() - x86-64, System V ABI\n";
+    out << "    .intel_syntax noprefix\n";
+    out << "    .text\n";
+    out << "    .globl " << symbol << "\n";
+    out << "    .type " << symbol << ", @function\n";
+    out << symbol << ":\n";
+    if (frameSize > 0)
+        out << "    sub rsp, " << frameSize << "\n";
+    out << code.str();
+    if (frameSize > 0)
+        out << "    add rsp, " << frameSize << "\n";
+    out << "    ret\n";
+    out << "    .size " << symbol << ", .-" << symbol << "\n";
+
+    if (!constants.empty())
+    {
+        out << "    .section .rodata\n";
+        out << "    .p2align 3\n";
+        for (size_t i = 0; i < constants.size(); i++)
+            out << ".L" << symbol << "_c" << i << ":\n    .quad 0x" << hex << setw(16) << setfill('0')
+                << doubleBits(constants[i]) << dec << setfill(' ') << "\n";
+    }
+    out << "    .section .note.GNU-stack,\"\",@progbits\n";
+    return true;
+}
@@ -0,0 +1,75 @@
+﻿#ifndef ASMEMITTER_H
+#define ASMEMITTER_H
+
+#include "Ir.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Генерация ассемблера x86-64 (синтаксис Intel для GNU as, ELF, System V ABI).
+// Функция экспортируется под именем symbol и вызывается из C/C++ как
+// int f(int a, double b): параметры приходят в регистрах (и стеке) по System V,
+// результат возвращается в eax или xmm0.
+//
+// Переменные размещаются в регистрах линейным сканированием по интервалам жизни,
+// не поместившиеся - в кадре стека. Вершина стека выражения кешируется
+// в аккумуляторе (eax / xmm0), остальные операнды используются прямо из своих мест.
+// Функции других модулей вызываются по System V: регистры переменных, живущих
+// через вызов, сохраняются в кадре, rsp в момент call выровнен на 16.
+class AsmEmitter
+{
+private:
+    struct Location         // Место переменной: регистр или слот кадра
+    {
+        int reg;            // Номер регистра в пуле или -1
+        int slot;           // Номер 8-байтового слота в кадре или -1
+    };
+
+    struct Operand          // Элемент стека выражения во время генерации
+    {
+        enum Kind { IMM, VAR, ACC, TEMP } kind;
+        ValueType type;
+        int32_t intValue;   // IMM int
+        double doubleValue; // IMM double
+        int index;          // VAR - номер переменной, TEMP - номер слота
+    };
+
+    const IrFunction& function;
+    string symbol;              // Имя функции в объектном файле
+    vector<Location> locations;
+    vector<bool> zeroInit;      // Переменная читается до первой записи
+    vector<int> liveStart, liveEnd;     // Интервалы жизни переменных по номерам команд
+    vector<int> saveSlots;      // Слот для сохранения регистра переменной на время вызова или -1
+    int outgoingSlots;          // Аргументы вызовов, передаваемые через стек, - в начале кадра
+    int frameSlots;             // Слоты кадра под переменные
+    vector<int> freeTemps;      // Свободные слоты под временные значения
+    int tempSlots;              // Всего слотов под временные значения
+    vector<Operand> stack;
+    vector<double> constants;   // Вещественные константы для .rodata
+    ostream* body;
+
+    void allocateRegisters();
+    string slotAddress(int slot, ValueType type) const;
+    string varText(int var) const;
+    string operandText(const Operand& operand);
+    bool inMemory(const Operand& operand) const;
+    int allocateTemp();
+    void releaseTemp(const Operand& operand);
+    void spillAccumulator(ValueType type);
+    void toAccumulator(Operand& operand);
+    void emitBinary(bool add);
+    void emitConversion(bool toDouble);
+    void emitStore(int var);
+    void emitParameterMoves(int frameSize);
+    void emitCall(const IrInstr& instr, int at);
+    void emitInstr(const IrInstr& instr, int at);
+
+public:
+    explicit AsmEmitter(const IrFunction& fn);
+
+    bool emit(const string& symbol, ostream& out, string& error);
+};
+
+#endif
@@ -0,0 +1,232 @@
+﻿#include "BatchEvaluator.h"
+#include <algorithm>
+#include <cstring>
+
+// Регистры банка: сначала переменные этого типа, затем временные значения
+// по глубине стека выражения, затем константы
+BatchEvaluator::BatchEvaluator(const IrFunction& function)
+    : intRegs(0), doubleRegs(0), resultReg(0), resultType(function.returnType)
+{
+    vector<uint16_t> varReg(function.variables.size());
+    vector<bool> written(function.variables.size(), false);
+    for (size_t v = 0; v < function.variables.size(); v++)
+        varReg[v] = (uint16_t)(function.variables[v].type == ValueType::INT ? intRegs++ : doubleRegs++);
+    for (int param : function.parameters)
+    {
+        paramRegs.push_back(varReg[param]);
+        paramTypes.push_back(function.variables[param].type);
+        written[param] = true;
+    }
+
+    size_t maxDepth = 0, depth = 0;
+    for (const IrInstr& instr : function.code)
+    {
+        if (instr.op == IrOp::CONST_INT || instr.op == IrOp::CONST_DOUBLE || instr.op == IrOp::LOAD)
+            maxDepth = max(maxDepth, ++depth);
+        else if (instr.op == IrOp::ADD || instr.op == IrOp::SUB || instr.op == IrOp::STORE || instr.op == IrOp::RETURN)
+            depth--;
+        else if (instr.op == IrOp::CALL)
+            maxDepth = max(maxDepth, depth = depth + 1 - function.callees[instr.var].params.size());
+    }
+    int intTemps = intRegs, doubleTemps = doubleRegs;
+    intRegs += (int)maxDepth;
+    doubleRegs += (int)maxDepth;
+
+    struct Entry { ValueType type; uint16_t reg; };
+    vector<Entry> stack;
+    auto temp = [&](ValueType type) -> uint16_t     // Регистр результата на текущей глубине
+    {
+        return (uint16_t)((type == ValueType::INT ? intTemps : doubleTemps) + stack.size());
+    };
+
+    for (const IrInstr& instr : function.code)
+    {
+        switch (instr.op)
+        {
+        case IrOp::CONST_INT:
+        {
+            auto it = find_if(intConstants.begin(), intConstants.end(),
+                [&](const Constant& c) { return c.intValue == instr.intValue; });
+            if (it == intConstants.end())
+            {
+                intConstants.push_back({ (uint16_t)intRegs++, instr.intValue, 0.0 });
+                it = intConstants.end() - 1;
+            }
+            stack.push_back({ ValueType::INT, it->reg });
+            break;
+        }
+        case IrOp::CONST_DOUBLE:
+        {
+            auto it = find_if(doubleConstants.begin(), doubleConstants.end(),
+                [&](const Constant& c) { return memcmp(&c.doubleValue, &instr.doubleValue, sizeof(double)) == 0; });
+            if (it == doubleConstants.end())
+            {
+                doubleConstants.push_back({ (uint16_t)doubleRegs++, 0, instr.doubleValue });
+                it = doubleConstants.end() - 1;
+            }
+            stack.push_back({ ValueType::DOUBLE, it->reg });
+            break;
+        }
+        case IrOp::LOAD:
+            if (!written[instr.var])    // Чтение до записи - переменная равна нулю
+            {
+                (instr.type == ValueType::INT ? zeroIntRegs : zeroDoubleRegs).push_back(varReg[instr.var]);
+                written[instr.var] = true;
+            }
+            stack.push_back({ instr.type, varReg[instr.var] });
+            break;
+        case IrOp::STORE:
+        {
+            Entry value = stack.back();
+            stack.pop_back();
+            written[instr.var] = true;
+            if (value.reg != varReg[instr.var])
+                code.push_back({ Op::COPY, instr.type, varReg[instr.var], value.reg, 0 });
+            break;
+        }
+        case IrOp::ADD:
+        case IrOp::SUB:
+        {
+            Entry right = stack.back();
+            stack.pop_back();
+            Entry left = stack.back();
+            stack.pop_back();
+            uint16_t dest = temp(instr.type);
+            code.push_back({ instr.op == IrOp::ADD ? Op::ADD : Op::SUB, instr.type, dest, left.reg, right.reg });
+            stack.push_back({ instr.type, dest });
+            break;
+        }
+        case IrOp::ITOD:
+        case IrOp::DTOI:
+        {
+            Entry arg = stack.back();
+            stack.pop_back();
+            uint16_t dest = temp(instr.type);
+            code.push_back({ instr.op == IrOp::ITOD ? Op::ITOD : Op::DTOI, instr.type, dest, arg.reg, 0 });
+            stack.push_back({ instr.type, dest });
+            break;
+        }
+        case IrOp::CALL:    // Кода функций других модулей здесь нет
+        {
+            unsupported = "вызов функции '" + function.callees[instr.var].name + "' другого модуля";
+            stack.resize(stack.size() - function.callees[instr.var].params.size());
+            uint16_t dest = temp(instr.type);
+            stack.push_back({ instr.type, dest });
+            break;
+        }
+        case IrOp::RETURN:
+            resultReg = stack.back().reg;
+            stack.pop_back();
+            break;
+        }
+    }
+    // Номера регистров сверх предела усечены при приведении к uint16_t, такой код не исполняется
+    if (unsupported.empty() && max(intRegs, doubleRegs) > MAX_REGISTERS)
+        unsupported = "функции, которым нужно больше " + to_string(MAX_REGISTERS) + " регистров";
+}
+
+bool BatchEvaluator::evaluate(const vector<BatchColumn>& inputs, size_t rows, void* result, string& error) const
+{
+    if (!unsupported.empty())
+    {
+        error = "пакетное вычисление не поддерживает " + unsupported;
+        return false;
+    }
+    if (inputs.size() != paramTypes.size())
+    {
+        error = "ожидалось столбцов: " + to_string(paramTypes.size()) + ", передано: " + to_string(inputs.size());
+        return false;
+    }
+    for (size_t p = 0; p < inputs.size(); p++)
+        if (inputs[p].type != paramTypes[p])
+        {
+            error = "тип столбца " + to_string(p + 1) + " не совпадает с типом параметра";
+            return false;
+        }
+
+    vector<int32_t> ints(intRegs * LANES);
+    vector<double> doubles(doubleRegs * LANES);
+    for (const Constant& c : intConstants)  // Константы размножаются по всем дорожкам один раз
+        fill_n(&ints[c.reg * LANES], LANES, c.intValue);
+    for (const Constant& c : doubleConstants)
+        fill_n(&doubles[c.reg * LANES], LANES, c.doubleValue);
+
+    for (size_t start = 0; start < rows; start += LANES)
+    {
+        size_t n = min(LANES, rows - start);
+
+        for (size_t p = 0; p < inputs.size(); p++)
+        {
+            if (paramTypes[p] == ValueType::INT)
+                memcpy(&ints[paramRegs[p] * LANES], (const int32_t*)inputs[p].data + start, n * sizeof(int32_t));
+            else
+                memcpy(&doubles[paramRegs[p] * LANES], (const double*)inputs[p].data + start, n * sizeof(double));
+        }
+        for (uint16_t reg : zeroIntRegs)
+            fill_n(&ints[reg * LANES], n, 0);
+        for (uint16_t reg : zeroDoubleRegs)
+            fill_n(&doubles[reg * LANES], n, 0.0);
+
+        for (const Instr& instr : code)
+        {
+            bool isInt = instr.type == ValueType::INT;
+            int32_t* id = ints.data() + instr.dest * LANES;
+            double* dd = doubles.data() + instr.dest * LANES;
+            switch (instr.op)
+            {
+            case Op::COPY:
+                if (isInt)
+                    memcpy(id, &ints[instr.a * LANES], n * sizeof(int32_t));
+                else
+                    memcpy(dd, &doubles[instr.a * LANES], n * sizeof(double));
+                break;
+            case Op::ADD:
+            case Op::SUB:
+                if (isInt)  // Переполнение - по модулю 2^32
+                {
+                    const uint32_t* a = (const uint32_t*)&ints[instr.a * LANES];
+                    const uint32_t* b = (const uint32_t*)&ints[instr.b * LANES];
+                    uint32_t* d = (uint32_t*)id;
+                    if (instr.op == Op::ADD)
+                        for (size_t i = 0; i < n; i++)
+                            d[i] = a[i] + b[i];
+                    else
+                        for (size_t i = 0; i < n; i++)
+                            d[i] = a[i] - b[i];
+                }
+                else
+                {
+                    const double* a = &doubles[instr.a * LANES];
+                    const double* b = &doubles[instr.b * LANES];
+                    if (instr.op == Op::ADD)
+                        for (size_t i = 0; i < n; i++)
+                            dd[i] = a[i] + b[i];
+                    else
+                        for (size_t i = 0; i < n; i++)
+                            dd[i] = a[i] - b[i];
+                }
+                break;
+            case Op::ITOD:
+            {
+                const int32_t* a = &ints[instr.a * LANES];
+                for (size_t i = 0; i < n; i++)
+                    dd[i] = a[i];
+                break;
+            }
+            case Op::DTOI:
+            {
+                const double* a = &doubles[instr.a * LANES];
+                for (size_t i = 0; i < n; i++)
+                    id[i] = truncateToInt32(a[i]);
+                break;
+            }
+            }
+        }
+
+        if (resultType == ValueType::INT)
+            memcpy((int32_t*)result + start, &ints[resultReg * LANES], n * sizeof(int32_t));
+        else
+            memcpy((double*)result + start, &doubles[resultReg * LANES], n * sizeof(double));
+    }
+    return true;
+}
@@ -0,0 +1,68 @@
+﻿#ifndef BATCHEVALUATOR_H
+#define BATCHEVALUATOR_H
+
+#include "Ir.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+struct BatchColumn          // Значения одного параметра для всех строк
+{
+    ValueType type;
+    const void* data;       // int32_t[rows] или double[rows]
+};
+
+// Пакетное вычисление функции над столбцами входных данных.
+// IR переводится в регистровый байт-код, где каждый регистр - массив из LANES
+// значений. Команда выбирается один раз на LANES строк, а ее тело - простой цикл
+// по массивам, который компилятор векторизует. evaluate не меняет состояние объекта,
+// поэтому строки можно делить между потоками, вызывая его параллельно.
+class BatchEvaluator
+{
+public:
+    static const size_t LANES = 256;    // Строк за одну выборку команды
+
+private:
+    enum class Op : uint8_t { COPY, ADD, SUB, ITOD, DTOI };
+
+    static const int MAX_REGISTERS = 1 << 16;   // Номер регистра хранится в uint16_t
+
+    struct Instr
+    {
+        Op op;
+        ValueType type;     // Тип результата
+        uint16_t dest, a, b;
+    };
+
+    struct Constant
+    {
+        uint16_t reg;
+        int32_t intValue;
+        double doubleValue;
+    };
+
+    vector<Instr> code;
+    int intRegs;                    // Регистров в целом банке
+    int doubleRegs;                 // Регистров в вещественном банке
+    vector<Constant> intConstants, doubleConstants;
+    vector<uint16_t> paramRegs;     // Регистр каждого параметра в банке его типа
+    vector<ValueType> paramTypes;
+    vector<uint16_t> zeroIntRegs, zeroDoubleRegs;   // Переменные, читаемые до записи
+    uint16_t resultReg;
+    ValueType resultType;
+    string unsupported;             // Причина, по которой функцию нельзя вычислить пакетно
+
+public:
+    explicit BatchEvaluator(const IrFunction& function);
+
+    size_t parameterCount() const { return paramTypes.size(); }
+    ValueType parameterType(size_t i) const { return paramTypes[i]; }
+    ValueType getResultType() const { return resultType; }
+
+    // result - int32_t[rows] или double[rows] по типу функции
+    bool evaluate(const vector<BatchColumn>& inputs, size_t rows, void* result, string& error) const;
+};
+
+#endif
@@ -0,0 +1,245 @@
+﻿#include "BuildScheduler.h"
+#include "Compiler.h"
+#include "Interface.h"
+#include "AsmEmitter.h"
+#include "SourceMap.h"
+#include "Trace.h"
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+static const unsigned MAX_IO_IN_FLIGHT = 32;    // Операций ввода-вывода в полете одновременно
+
+BuildScheduler::BuildScheduler(const string& dir, const vector<string>& extraPath, const string& format,
+    bool asmOutput, unsigned threads)
+    : directory(dir), outputDirectory((fs::path(dir) / "build").string()), modulePath(extraPath),
+    treeFormat(format), emitAsm(asmOutput), jobs(max(1u, threads)), io(MAX_IO_IN_FLIGHT, jobs)
+{
+}
+
+bool BuildScheduler::loadModules(string& error)
+{
+    error_code ec;
+    vector<fs::path> files;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+        if (it->is_regular_file(ec) && it->path().extension() == ".txt")
+            files.push_back(it->path());
+    if (ec)
+    {
+        error = "не удалось прочитать каталог " + directory;
+        return false;
+    }
+    sort(files.begin(), files.end());   // Порядок сводки не зависит от файловой системы
+
+    vector<BulkIo::File> sources(files.size());
+    for (size_t i = 0; i < files.size(); i++)
+        sources[i].path = files[i].string();
+    {
+        TRACE_SCOPE("input");
+        io.readAll(sources);
+    }
+
+    unordered_map<string, int> byName;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        Module module;
+        module.name = files[i].stem().string();
+        module.built = false;
+        TraceFile traceFile(sources[i].path);
+        if (!sources[i].ok)
+        {
+            error = "не удалось открыть файл " + sources[i].path;
+            return false;
+        }
+        module.source = move(sources[i].content);
+        module.imports = scanImports(module.source);
+        byName[module.name] = (int)modules.size();
+        modules.push_back(move(module));
+    }
+
+    // Импорт модуля не из каталога - готовый интерфейс, его ищет разбор
+    for (size_t i = 0; i < modules.size(); i++)
+        for (const string& name : modules[i].imports)
+        {
+            auto it = byName.find(name);
+            if (it == byName.end() || find(modules[i].dependencies.begin(), modules[i].dependencies.end(), it->second) !=
+                modules[i].dependencies.end())
+                continue;
+            modules[i].dependencies.push_back(it->second);
+            modules[it->second].dependents.push_back((int)i);
+        }
+
+    fs::create_directories(outputDirectory, ec);
+    if (ec)
+    {
+        error = "не удалось создать каталог " + outputDirectory;
+        return false;
+    }
+    return true;
+}
+
+// Алгоритм Кана: модули, которые так и не освободились от зависимостей,
+// лежат на цикле или зависят от него
+void BuildScheduler::findCycles()
+{
+    vector<size_t> waiting(modules.size());
+    vector<int> ready;
+    for (size_t i = 0; i < modules.size(); i++)
+        if ((waiting[i] = modules[i].dependencies.size()) == 0)
+            ready.push_back((int)i);
+    while (!ready.empty())
+    {
+        int next = ready.back();
+        ready.pop_back();
+        for (int dependent : modules[next].dependents)
+            if (--waiting[dependent] == 0)
+                ready.push_back(dependent);
+    }
+    for (size_t i = 0; i < modules.size(); i++)
+        if (waiting[i] != 0)
+            modules[i].status = "циклическая зависимость модулей";
+}
+
+string BuildScheduler::outputBase(const Module& module) const
+{
+    return (fs::path(outputDirectory) / module.name).string();
+}
+
+void BuildScheduler::buildModule(Module& module, InterfaceLibrary& library)
+{
+    string base = outputBase(module);
+    TraceFile traceFile((fs::path(directory) / (module.name + ".txt")).string());
+    TRACE_SCOPE("module");
+
+    CompileResult result;
+    compileSource(module.source, treeFormat, &library, emitAsm, result);
+    io.writeAsync(base + ".txt", move(result.report));
+    if (!result.syntaxCorrect || !result.exported)
+    {
+        module.status = "ОШИБКИ";
+        return;
+    }
+
+    string error;
+    if (!InterfaceFile::write(InterfaceLibrary::fileName(base), { result.signature }, error))
+    {
+        module.status = error;
+        return;
+    }
+
+    if (emitAsm)
+    {
+        ostringstream assembly;
+        error = result.irError;
+        if (error.empty() && AsmEmitter(result.program).emit(result.program.name, assembly, error))
+            io.writeAsync(base + ".s", assembly.str());
+        else
+        {
+            module.status = "ассемблер не создан: " + error;
+            return;
+        }
+    }
+    module.built = true;
+    module.status = "УСПЕХ";
+}
+
+bool BuildScheduler::run(ostream& log)
+{
+    string error;
+    if (!loadModules(error))
+    {
+        log << "Ошибка: " << error << endl;
+        return false;
+    }
+    findCycles();
+
+    vector<string> searchPath = { outputDirectory };
+    searchPath.insert(searchPath.end(), modulePath.begin(), modulePath.end());
+    InterfaceLibrary library(searchPath);
+
+    // Готовые к сборке модули - в очереди; модуль попадает в нее, когда собраны
+    // все его зависимости. Модуль с несобранной зависимостью не компилируется.
+    mutex lock;
+    condition_variable changed;
+    vector<int> ready;
+    vector<size_t> waiting(modules.size());
+    size_t finished = 0;
+    for (size_t i = 0; i < modules.size(); i++)
+    {
+        waiting[i] = modules[i].dependencies.size();
+        if (!modules[i].status.empty())     // На цикле - не собирается
+        {
+            error_code ec;
+            fs::remove(InterfaceLibrary::fileName(outputBase(modules[i])), ec);
+            finished++;
+        }
+        else if (waiting[i] == 0)
+            ready.push_back((int)i);
+    }
+    reverse(ready.begin(), ready.end());    // Первыми - модули в порядке имен
+
+    auto worker = [&]()
+    {
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            changed.wait(guard, [&] { return !ready.empty() || finished == modules.size(); });
+            if (ready.empty())
+                return;
+            Module& module = modules[ready.back()];
+            ready.pop_back();
+
+            string failed;      // Первая несобранная зависимость
+            for (int dependency : module.dependencies)
+                if (!modules[dependency].built && failed.empty())
+                    failed = modules[dependency].name;
+
+            error_code ec;      // Интерфейс прошлой сборки не должен пережить ошибку
+            fs::remove(InterfaceLibrary::fileName(outputBase(module)), ec);
+            if (failed.empty())
+            {
+                guard.unlock();
+                buildModule(module, library);
+                guard.lock();
+            }
+            else
+                module.status = "не собран модуль " + failed;
+
+            finished++;
+            for (int dependent : module.dependents)
+                if (--waiting[dependent] == 0 && modules[dependent].status.empty())
+                    ready.push_back(dependent);
+            changed.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned t = 1; t < min<size_t>(jobs, modules.size()); t++)
+        workers.emplace_back(worker);
+    worker();
+    for (auto& thread : workers)
+        thread.join();
+
+    vector<string> failedWrites;
+    bool success = !modules.empty();
+    {
+        TRACE_SCOPE("output");
+        success = io.finishWrites(failedWrites) && success;
+    }
+    for (const Module& module : modules)
+    {
+        log << module.name << ": " << module.status << endl;
+        success = success && module.built;
+    }
+    for (const string& path : failedWrites)
+        log << "Ошибка: не удалось записать файл " << path << endl;
+    if (modules.empty())
+        log << "Ошибка: в каталоге " << directory << " нет модулей (*.txt)" << endl;
+    return success;
+}
@@ -0,0 +1,52 @@
+﻿#ifndef BUILDSCHEDULER_H
+#define BUILDSCHEDULER_H
+
+#include "Interface.h"
+#include "BulkIo.h"
+#include <string>
+#include <vector>
+#include <ostream>
+
+using namespace std;
+
+// Сборка каталога модулей. Каждый файл *.txt каталога - модуль с именем файла
+// без расширения; import задает зависимости. Модули собираются в порядке
+// зависимостей, независимые - параллельно. Результаты пишутся в подкаталог build:
+// отчет <модуль>.txt, интерфейс <модуль>.ifc и, по запросу, ассемблер <модуль>.s.
+// Исходные файлы читаются одним пакетом, отчеты и ассемблер пишутся асинхронно (BulkIo);
+// интерфейс пишется сразу - его читают зависимые модули.
+class BuildScheduler
+{
+private:
+    struct Module
+    {
+        string name;
+        string source;
+        vector<string> imports;
+        vector<int> dependencies;   // Модули каталога, от которых зависит этот
+        vector<int> dependents;
+        bool built;
+        string status;              // Итог сборки для сводки
+    };
+
+    string directory;
+    string outputDirectory;
+    vector<string> modulePath;      // Дополнительные каталоги с готовыми интерфейсами
+    string treeFormat;
+    bool emitAsm;
+    unsigned jobs;
+    vector<Module> modules;
+    BulkIo io;
+
+    bool loadModules(string& error);
+    void findCycles();
+    string outputBase(const Module& module) const;  // Путь результатов модуля без расширения
+    void buildModule(Module& module, InterfaceLibrary& library);
+
+public:
+    BuildScheduler(const string& dir, const vector<string>& extraPath, const string& format, bool asmOutput, unsigned threads);
+
+    bool run(ostream& log);     // true - все модули собраны без ошибок
+};
+
+#endif
@@ -0,0 +1,377 @@
+﻿#include "BulkIo.h"
+#include "SourceMap.h"
+#include <fstream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+// Минимальная обертка над системными вызовами io_uring без liburing.
+// Кольца используются одним потоком, поэтому барьеры нужны только
+// на границе с ядром: хвост SQ и голова CQ.
+struct BulkIo::Ring
+{
+    int fd = -1;
+    void* sqMap = MAP_FAILED;
+    size_t sqMapSize = 0;
+    void* cqMap = MAP_FAILED;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned unsubmitted = 0;   // Заполненные SQE, еще не переданные ядру
+    unsigned active = 0;        // Операции, результат которых еще не получен
+
+    bool setup(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0)
+            return false;
+
+        sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sqMapSize = cqMapSize = max(sqMapSize, cqMapSize);
+
+        sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqMap == MAP_FAILED)
+            return false;
+        cqMap = single ? sqMap : mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED)
+            return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+
+        char* sq = (char*)sqMap;
+        char* cq = (char*)cqMap;
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        return supports(IORING_OP_READ) && supports(IORING_OP_WRITE);
+    }
+
+    bool supports(int opcode) const    // READ и WRITE появились в 5.6 - на старых ядрах нужен пул потоков
+    {
+        vector<char> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = (io_uring_probe*)buffer.data();
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+            return false;
+        return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    ~Ring()
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqMap != MAP_FAILED && cqMap != sqMap)
+            munmap(cqMap, cqMapSize);
+        if (sqMap != MAP_FAILED)
+            munmap(sqMap, sqMapSize);
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    io_uring_sqe* nextSqe()     // Место в SQ есть всегда: в полете не больше записей кольца
+    {
+        io_uring_sqe* sqe = &sqes[*sqTail & *sqMask];
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    void pushSqe()              // Опубликовать заполненный nextSqe: ядро видит SQE только после tail
+    {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+        active++;
+    }
+
+    bool enter()                // Передать SQE ядру и дождаться хотя бы одного результата
+    {
+        while (true)
+        {
+            int result = (int)syscall(__NR_io_uring_enter, fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result >= 0)
+            {
+                unsubmitted -= (unsigned)result;
+                return true;
+            }
+            if (errno != EINTR)
+                return false;
+        }
+    }
+};
+
+static const size_t MAX_CHUNK = 1u << 30;  // Результат операции - int, большие файлы читаются частями
+
+bool BulkIo::start(Operation* operation)
+{
+    if (operation->write)
+        operation->fd = ::open(operation->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    else
+        operation->fd = ::open(operation->path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (operation->fd < 0)
+        return false;
+
+    if (!operation->write)
+    {
+        struct stat info;
+        if (fstat(operation->fd, &info) != 0)
+            return false;
+        operation->buffer->resize((size_t)info.st_size);
+    }
+    if (operation->buffer->empty())     // Пустой файл - операций ввода-вывода нет
+        return true;
+    submit(operation);
+    return true;
+}
+
+void BulkIo::submit(Operation* operation)
+{
+    io_uring_sqe* sqe = ring->nextSqe();
+    sqe->opcode = operation->write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = operation->fd;
+    sqe->off = operation->done;
+    sqe->addr = (uint64_t)(uintptr_t)&(*operation->buffer)[operation->done];
+    sqe->len = (uint32_t)min(operation->buffer->size() - operation->done, MAX_CHUNK);
+    sqe->user_data = (uint64_t)(uintptr_t)operation;
+    ring->pushSqe();
+}
+
+void BulkIo::ringLoop()
+{
+    while (true)
+    {
+        vector<unique_ptr<Operation>> taken;
+        {
+            unique_lock<mutex> guard(lock);
+            if (ring->active == 0)
+            {
+                queued.wait(guard, [&] { return !queue.empty() || stopping; });
+                if (queue.empty())
+                    return;
+            }
+            while (ring->active + taken.size() < maxInFlight && !queue.empty())
+            {
+                taken.push_back(move(queue.front()));
+                queue.pop_front();
+            }
+        }
+
+        for (unique_ptr<Operation>& operation : taken)
+        {
+            Operation* raw = operation.get();
+            bool started = start(raw);
+            if (!started || raw->buffer->empty())
+                finish(move(operation), started);
+            else
+                operation.release();    // Владеет SQE до получения результата
+        }
+        if (ring->active == 0)
+            continue;
+
+        if (!ring->enter())
+        {
+            // Кольцо сломалось - незавершенные операции остаются без результата;
+            // такого не бывает при корректной настройке, но ждать вечно нельзя
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            completed.notify_all();
+            return;
+        }
+
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            io_uring_cqe* cqe = &ring->cqes[head & *ring->cqMask];
+            unique_ptr<Operation> operation((Operation*)(uintptr_t)cqe->user_data);
+            ring->active--;
+            int result = cqe->res;
+            if (result < 0 || (result == 0 && operation->write))   // Запись без продвижения повторялась бы вечно
+                finish(move(operation), false);
+            else if (result == 0)       // Файл стал короче, чем при открытии
+            {
+                operation->buffer->resize(operation->done);
+                finish(move(operation), true);
+            }
+            else if ((operation->done += (size_t)result) < operation->buffer->size())
+                submit(operation.release());
+            else
+                finish(move(operation), true);
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+}
+
+#else
+
+struct BulkIo::Ring
+{
+    bool setup(unsigned) { return false; }
+};
+
+bool BulkIo::start(Operation*) { return false; }
+void BulkIo::submit(Operation*) {}
+void BulkIo::ringLoop() {}
+
+#endif
+
+BulkIo::BulkIo(unsigned inFlight, unsigned poolThreads, bool allowRing)
+    : maxInFlight(max(1u, inFlight)), pendingReads(0), pendingWrites(0), stopping(false)
+{
+    if (allowRing)
+    {
+        ring.reset(new Ring());
+        if (!ring->setup(maxInFlight))
+            ring.reset();
+    }
+    if (ring)
+        threads.emplace_back(&BulkIo::ringLoop, this);
+    else
+        for (unsigned i = 0; i < max(1u, min(poolThreads, maxInFlight)); i++)
+            threads.emplace_back(&BulkIo::threadLoop, this);
+}
+
+BulkIo::~BulkIo()
+{
+    {
+        unique_lock<mutex> guard(lock);
+        completed.wait(guard, [&] { return pendingWrites == 0 || stopping; });
+        stopping = true;
+    }
+    queued.notify_all();
+    for (thread& worker : threads)
+        worker.join();
+}
+
+void BulkIo::enqueue(unique_ptr<Operation> operation)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        if (operation->write)
+            pendingWrites++;
+        else
+            pendingReads++;
+        queue.push_back(move(operation));
+    }
+    queued.notify_one();
+}
+
+void BulkIo::finish(unique_ptr<Operation> operation, bool success)
+{
+#ifdef __linux__
+    if (ring && operation->fd >= 0)
+        ::close(operation->fd);
+#endif
+    {
+        lock_guard<mutex> guard(lock);
+        if (operation->write)
+        {
+            if (!success)
+                failedWrites.push_back(operation->path);
+            pendingWrites--;
+        }
+        else
+        {
+            *operation->ok = success;
+            pendingReads--;
+        }
+    }
+    completed.notify_all();
+}
+
+void BulkIo::threadLoop()
+{
+    unique_lock<mutex> guard(lock);
+    while (true)
+    {
+        queued.wait(guard, [&] { return !queue.empty() || stopping; });
+        if (queue.empty())
+            return;
+        unique_ptr<Operation> operation = move(queue.front());
+        queue.pop_front();
+        guard.unlock();
+
+        bool success;
+        if (operation->write)
+        {
+            ofstream output(operation->path, ios::binary);
+            output << operation->data;
+            output.close();
+            success = !output.fail();
+        }
+        else
+            success = SourceMap::readFile(operation->path, *operation->buffer);
+
+        finish(move(operation), success);
+        guard.lock();
+    }
+}
+
+void BulkIo::readAll(vector<File>& files)
+{
+    for (File& file : files)
+    {
+        unique_ptr<Operation> operation(new Operation());
+        operation->write = false;
+        operation->path = file.path;
+        operation->buffer = &file.content;
+        operation->ok = &file.ok;
+        operation->fd = -1;
+        operation->done = 0;
+        file.ok = false;
+        enqueue(move(operation));
+    }
+
+    unique_lock<mutex> guard(lock);
+    completed.wait(guard, [&] { return pendingReads == 0 || stopping; });
+}
+
+void BulkIo::writeAsync(const string& path, string content)
+{
+    unique_ptr<Operation> operation(new Operation());
+    operation->write = true;
+    operation->path = path;
+    operation->data = move(content);
+    operation->buffer = &operation->data;
+    operation->ok = nullptr;
+    operation->fd = -1;
+    operation->done = 0;
+    enqueue(move(operation));
+}
+
+bool BulkIo::finishWrites(vector<string>& failed)
+{
+    unique_lock<mutex> guard(lock);
+    completed.wait(guard, [&] { return pendingWrites == 0 || stopping; });
+    failed = failedWrites;
+    failedWrites.clear();
+    return failed.empty() && pendingWrites == 0;
+}
@@ -0,0 +1,76 @@
+﻿#ifndef BULKIO_H
+#define BULKIO_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// Пакетный ввод-вывод для сборки каталога: все исходные файлы читаются сразу,
+// в полете держится не больше maxInFlight операций, лексеры получают готовые буферы.
+// Отчеты пишутся асинхронно через ту же очередь. В Linux операции выполняет
+// io_uring в одном потоке; если он недоступен (старое ядро, запрет seccomp,
+// другая ОС) - пул из poolThreads потоков (не больше maxInFlight) с обычными
+// блокирующими вызовами.
+class BulkIo
+{
+public:
+    struct File
+    {
+        string path;
+        string content;
+        bool ok;
+    };
+
+private:
+    struct Operation
+    {
+        bool write;
+        string path;
+        string* buffer;     // Чтение: содержимое файла; запись: указывает на data
+        string data;        // Содержимое записи
+        bool* ok;           // Итог чтения
+        int fd;
+        size_t done;        // Уже прочитано или записано байт
+    };
+    struct Ring;            // Кольца io_uring, отображенные в память
+
+    unsigned maxInFlight;
+    unique_ptr<Ring> ring;  // nullptr - операции выполняет пул потоков
+    vector<thread> threads;
+
+    mutex lock;
+    condition_variable queued;      // В очереди появилась операция или пора завершаться
+    condition_variable completed;   // Операция завершена
+    deque<unique_ptr<Operation>> queue;
+    size_t pendingReads;
+    size_t pendingWrites;
+    vector<string> failedWrites;
+    bool stopping;
+
+    void enqueue(unique_ptr<Operation> operation);
+    void finish(unique_ptr<Operation> operation, bool success);
+    void ringLoop();
+    void threadLoop();
+    bool start(Operation* operation);       // io_uring: открыть файл и поставить первую операцию
+    void submit(Operation* operation);      // io_uring: очередная часть чтения или записи
+
+public:
+    BulkIo(unsigned inFlight, unsigned poolThreads, bool allowRing = true);
+    ~BulkIo();                      // Дожидается незавершенных записей
+    BulkIo(const BulkIo&) = delete;
+    BulkIo& operator=(const BulkIo&) = delete;
+
+    void readAll(vector<File>& files);              // Возвращает, когда прочитаны все файлы
+    void writeAsync(const string& path, string content);
+    bool finishWrites(vector<string>& failed);      // Дождаться записей; false - часть не записана
+
+    const char* getBackend() const { return ring ? "io_uring" : "потоки"; }
+};
+
+#endif
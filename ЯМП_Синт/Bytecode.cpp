@@ -0,0 +1,438 @@
+﻿#include "Bytecode.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+static const char BYC_MAGIC[4] = { 'B', 'Y', 'C', '1' };
+static const uint32_t BYC_VERSION = 1;
+
+// Как и в файле интерфейса, поля читаются и пишутся через memcpy в порядке байтов машины.
+// Константа int32 занимает первые 4 байта своей ячейки при любом порядке байтов.
+struct BycHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t fileSize;
+    uint32_t stackDepth;        // Наибольшая глубина стека выражений
+    uint32_t nameOffset;        // Имя функции - от начала области строк
+    uint32_t nameLength;
+    uint8_t returnType;
+    uint8_t reserved[3];
+    uint32_t variableCount;
+    uint32_t parameterCount;
+    uint32_t constantCount;
+    uint32_t instructionCount;
+    uint32_t constantsOffset;
+    uint32_t variablesOffset;
+    uint32_t parametersOffset;
+    uint32_t codeOffset;
+    uint32_t stringsOffset;
+};
+
+struct BycVariable
+{
+    uint32_t nameOffset;        // От начала области строк
+    uint16_t nameLength;
+    uint8_t type;
+    uint8_t reserved;
+};
+
+struct BycInstr
+{
+    uint8_t op;                 // IrOp
+    uint8_t type;               // ValueType результата
+    uint16_t reserved;
+    uint32_t operand;           // Номер переменной (LOAD, STORE) или константы (CONST_INT, CONST_DOUBLE)
+};
+
+static_assert(sizeof(BycHeader) == 64, "BycHeader layout");
+static_assert(sizeof(BycVariable) == 8, "BycVariable layout");
+static_assert(sizeof(BycInstr) == 8, "BycInstr layout");
+
+union Cell                      // Переменная или ячейка стека исполнения
+{
+    int32_t intValue;
+    double doubleValue;
+};
+
+static uint64_t align8(uint64_t offset)
+{
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+BytecodeFile::BytecodeFile()
+    : constants(nullptr), variables(nullptr), parameters(nullptr), code(nullptr),
+    parameterTotal(0), variableTotal(0), instructionTotal(0), stackDepth(0), resultType(ValueType::INT)
+{
+}
+
+ValueType BytecodeFile::parameterType(size_t i) const
+{
+    uint32_t index;
+    memcpy(&index, parameters + i * sizeof(uint32_t), sizeof(index));
+    BycVariable variable;
+    memcpy(&variable, variables + index * sizeof(BycVariable), sizeof(variable));
+    return (ValueType)variable.type;
+}
+
+bool BytecodeFile::open(const string& path, string& error)
+{
+    if (!file.open(path))
+    {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    string corrupted = path + ": байт-код поврежден";
+
+    BycHeader header;
+    if (file.getSize() < sizeof(header))
+    {
+        error = corrupted;
+        return false;
+    }
+    memcpy(&header, file.getData(), sizeof(header));
+    if (memcmp(header.magic, BYC_MAGIC, sizeof(BYC_MAGIC)) != 0 || header.version != BYC_VERSION)
+    {
+        error = path + ": неизвестный формат байт-кода";
+        return false;
+    }
+
+    // Раздел выровнен, лежит после заголовка и целиком внутри файла
+    auto section = [&](uint32_t offset, uint64_t bytes)
+    {
+        return offset % 8 == 0 && offset >= sizeof(header) && offset + bytes <= header.fileSize;
+    };
+    if (header.fileSize != file.getSize() ||
+        !section(header.constantsOffset, (uint64_t)header.constantCount * 8) ||
+        !section(header.variablesOffset, (uint64_t)header.variableCount * sizeof(BycVariable)) ||
+        !section(header.parametersOffset, (uint64_t)header.parameterCount * sizeof(uint32_t)) ||
+        !section(header.codeOffset, (uint64_t)header.instructionCount * sizeof(BycInstr)) ||
+        !section(header.stringsOffset, 0) ||
+        (uint64_t)header.nameOffset + header.nameLength > header.fileSize - header.stringsOffset ||
+        header.returnType > 1 || header.instructionCount == 0 || header.stackDepth > header.instructionCount)
+    {
+        error = corrupted;
+        return false;
+    }
+
+    const char* base = file.getData();
+    const char* strings = base + header.stringsOffset;
+    uint64_t stringsSize = header.fileSize - header.stringsOffset;
+
+    vector<uint8_t> variableTypes(header.variableCount);
+    for (uint32_t v = 0; v < header.variableCount; v++)
+    {
+        BycVariable variable;
+        memcpy(&variable, base + header.variablesOffset + v * sizeof(BycVariable), sizeof(variable));
+        if (variable.type > 1 || (uint64_t)variable.nameOffset + variable.nameLength > stringsSize)
+        {
+            error = corrupted;
+            return false;
+        }
+        variableTypes[v] = variable.type;
+    }
+    for (uint32_t p = 0; p < header.parameterCount; p++)
+    {
+        uint32_t index;
+        memcpy(&index, base + header.parametersOffset + p * sizeof(uint32_t), sizeof(index));
+        if (index >= header.variableCount)
+        {
+            error = corrupted;
+            return false;
+        }
+    }
+
+    // Код линейный - достаточно одного прохода с типами значений на стеке
+    vector<uint8_t> stack;
+    stack.reserve(header.stackDepth);
+    for (uint32_t i = 0; i < header.instructionCount; i++)
+    {
+        BycInstr instr;
+        memcpy(&instr, base + header.codeOffset + i * sizeof(BycInstr), sizeof(instr));
+        uint8_t type = instr.type;
+        auto top = [&](uint8_t expected) { return !stack.empty() && stack.back() == expected; };
+
+        bool valid = type <= 1;
+        switch ((IrOp)instr.op)
+        {
+        case IrOp::CONST_INT:
+        case IrOp::CONST_DOUBLE:
+            valid = valid && instr.operand < header.constantCount &&
+                type == (uint8_t)(instr.op == (uint8_t)IrOp::CONST_INT ? ValueType::INT : ValueType::DOUBLE);
+            stack.push_back(type);
+            break;
+        case IrOp::LOAD:
+            valid = valid && instr.operand < header.variableCount && variableTypes[instr.operand] == type;
+            stack.push_back(type);
+            break;
+        case IrOp::STORE:
+            valid = valid && instr.operand < header.variableCount && variableTypes[instr.operand] == type && top(type);
+            if (valid)
+                stack.pop_back();
+            break;
+        case IrOp::ADD:
+        case IrOp::SUB:
+            valid = valid && stack.size() >= 2 && top(type) && stack[stack.size() - 2] == type;
+            if (valid)
+                stack.pop_back();
+            break;
+        case IrOp::ITOD:
+            valid = valid && type == (uint8_t)ValueType::DOUBLE && top((uint8_t)ValueType::INT);
+            if (valid)
+                stack.back() = type;
+            break;
+        case IrOp::DTOI:
+            valid = valid && type == (uint8_t)ValueType::INT && top((uint8_t)ValueType::DOUBLE);
+            if (valid)
+                stack.back() = type;
+            break;
+        case IrOp::RETURN:      // Только последней командой
+            valid = valid && i + 1 == header.instructionCount && type == header.returnType && top(type);
+            break;
+        default:                // CALL и неизвестные операции
+            valid = false;
+            break;
+        }
+        if (!valid || stack.size() > header.stackDepth || (i + 1 == header.instructionCount && instr.op != (uint8_t)IrOp::RETURN))
+        {
+            error = corrupted + " (команда " + to_string(i + 1) + ")";
+            return false;
+        }
+    }
+
+    constants = base + header.constantsOffset;
+    variables = base + header.variablesOffset;
+    parameters = base + header.parametersOffset;
+    code = base + header.codeOffset;
+    parameterTotal = header.parameterCount;
+    variableTotal = header.variableCount;
+    instructionTotal = header.instructionCount;
+    stackDepth = header.stackDepth;
+    resultType = (ValueType)header.returnType;
+    name.assign(strings + header.nameOffset, header.nameLength);
+    return true;
+}
+
+bool BytecodeFile::execute(const vector<Constant>& arguments, Constant& result, string& error) const
+{
+    if (arguments.size() != parameterTotal)
+    {
+        error = "ожидалось аргументов: " + to_string(parameterTotal) + ", передано: " + to_string(arguments.size());
+        return false;
+    }
+    for (size_t p = 0; p < arguments.size(); p++)
+        if (arguments[p].type != parameterType(p))
+        {
+            error = "тип аргумента " + to_string(p + 1) + " не совпадает с типом параметра";
+            return false;
+        }
+
+    // Переменные, затем стек; переменные, читаемые до записи, равны нулю
+    Cell local[64];
+    vector<Cell> large;
+    size_t cellCount = (size_t)variableTotal + stackDepth;
+    if (cellCount > sizeof(local) / sizeof(local[0]))
+        large.resize(cellCount);
+    Cell* vars = large.empty() ? local : large.data();
+    memset(vars, 0, cellCount * sizeof(Cell));
+    Cell* top = vars + variableTotal;   // Первая свободная ячейка стека
+
+    for (size_t p = 0; p < arguments.size(); p++)
+    {
+        uint32_t index;
+        memcpy(&index, parameters + p * sizeof(uint32_t), sizeof(index));
+        if (arguments[p].type == ValueType::INT)
+            vars[index].intValue = arguments[p].intValue;
+        else
+            vars[index].doubleValue = arguments[p].doubleValue;
+    }
+
+    for (const char* p = code;; p += sizeof(BycInstr))
+    {
+        BycInstr instr;
+        memcpy(&instr, p, sizeof(instr));
+        bool isInt = instr.type == (uint8_t)ValueType::INT;
+        switch ((IrOp)instr.op)
+        {
+        case IrOp::CONST_INT:
+            memcpy(&top->intValue, constants + (size_t)instr.operand * 8, sizeof(int32_t));
+            top++;
+            break;
+        case IrOp::CONST_DOUBLE:
+            memcpy(&top->doubleValue, constants + (size_t)instr.operand * 8, sizeof(double));
+            top++;
+            break;
+        case IrOp::LOAD:
+            *top++ = vars[instr.operand];
+            break;
+        case IrOp::STORE:
+            vars[instr.operand] = *--top;
+            break;
+        case IrOp::ADD:
+        case IrOp::SUB:
+        {
+            Cell right = *--top;
+            Cell& left = top[-1];
+            if (isInt)  // Переполнение - по модулю 2^32
+                left.intValue = (int32_t)(instr.op == (uint8_t)IrOp::ADD ?
+                    (uint32_t)left.intValue + (uint32_t)right.intValue : (uint32_t)left.intValue - (uint32_t)right.intValue);
+            else
+                left.doubleValue = instr.op == (uint8_t)IrOp::ADD ?
+                    left.doubleValue + right.doubleValue : left.doubleValue - right.doubleValue;
+            break;
+        }
+        case IrOp::ITOD:
+            top[-1].doubleValue = top[-1].intValue;
+            break;
+        case IrOp::DTOI:
+            top[-1].intValue = truncateToInt32(top[-1].doubleValue);
+            break;
+        case IrOp::RETURN:
+        default:            // Проверка при открытии оставляет здесь только RETURN
+            --top;
+            result.type = resultType;
+            result.intValue = isInt ? top->intValue : 0;
+            result.doubleValue = isInt ? 0.0 : top->doubleValue;
+            return true;
+        }
+    }
+}
+
+bool BytecodeFile::write(const string& path, const IrFunction& function, string& error)
+{
+    string strings = function.name;
+    vector<BycVariable> variableRecords;
+    for (const IrVariable& variable : function.variables)
+    {
+        if (variable.name.size() > UINT16_MAX)
+        {
+            error = "имя переменной '" + variable.name + "' слишком длинное";
+            return false;
+        }
+        variableRecords.push_back({ (uint32_t)strings.size(), (uint16_t)variable.name.size(), (uint8_t)variable.type, 0 });
+        strings += variable.name;
+    }
+    vector<uint32_t> parameterIndexes(function.parameters.begin(), function.parameters.end());
+
+    vector<uint64_t> constantCells;
+    unordered_map<uint64_t, uint32_t> constantIndex;    // Одинаковые ячейки хранятся один раз
+    vector<BycInstr> instructions;
+    uint32_t depth = 0, maxDepth = 0;
+    for (const IrInstr& instr : function.code)
+    {
+        BycInstr out = { (uint8_t)instr.op, (uint8_t)instr.type, 0, 0 };
+        switch (instr.op)
+        {
+        case IrOp::CONST_INT:
+        case IrOp::CONST_DOUBLE:
+        {
+            uint64_t cell = 0;
+            if (instr.op == IrOp::CONST_INT)
+                memcpy(&cell, &instr.intValue, sizeof(instr.intValue));
+            else
+                memcpy(&cell, &instr.doubleValue, sizeof(instr.doubleValue));
+            auto inserted = constantIndex.emplace(cell, (uint32_t)constantCells.size());
+            if (inserted.second)
+                constantCells.push_back(cell);
+            out.operand = inserted.first->second;
+            depth++;
+            break;
+        }
+        case IrOp::LOAD:
+            out.operand = (uint32_t)instr.var;
+            depth++;
+            break;
+        case IrOp::STORE:
+            out.operand = (uint32_t)instr.var;
+            depth--;
+            break;
+        case IrOp::ADD:
+        case IrOp::SUB:
+        case IrOp::RETURN:
+            depth--;
+            break;
+        case IrOp::ITOD:
+        case IrOp::DTOI:
+            break;
+        case IrOp::CALL:    // Кода функций других модулей в файле нет
+            error = "байт-код не поддерживает вызов функции '" + function.callees[instr.var].name + "' другого модуля";
+            return false;
+        }
+        maxDepth = max(maxDepth, depth);
+        instructions.push_back(out);
+    }
+
+    BycHeader header = {};
+    memcpy(header.magic, BYC_MAGIC, sizeof(BYC_MAGIC));
+    header.version = BYC_VERSION;
+    header.stackDepth = maxDepth;
+    header.nameOffset = 0;
+    header.nameLength = (uint32_t)function.name.size();
+    header.returnType = (uint8_t)function.returnType;
+    header.variableCount = (uint32_t)variableRecords.size();
+    header.parameterCount = (uint32_t)parameterIndexes.size();
+    header.constantCount = (uint32_t)constantCells.size();
+    header.instructionCount = (uint32_t)instructions.size();
+
+    uint64_t offset = sizeof(BycHeader);
+    header.constantsOffset = (uint32_t)offset;
+    offset += constantCells.size() * 8;
+    header.variablesOffset = (uint32_t)offset;
+    offset += variableRecords.size() * sizeof(BycVariable);
+    header.parametersOffset = (uint32_t)offset;
+    offset = align8(offset + parameterIndexes.size() * sizeof(uint32_t));
+    header.codeOffset = (uint32_t)offset;
+    offset += instructions.size() * sizeof(BycInstr);
+    header.stringsOffset = (uint32_t)offset;
+    offset += strings.size();
+    if (offset > UINT32_MAX)
+    {
+        error = "функция '" + function.name + "' слишком велика для байт-кода";
+        return false;
+    }
+    header.fileSize = (uint32_t)offset;
+
+    // Временный файл и атомарное переименование - исполняющий процесс не увидит файл частично записанным
+    static atomic<unsigned> counter(0);
+    ostringstream tempName;
+    tempName << path << ".tmp." << hash<thread::id>()(this_thread::get_id()) << "."
+        << chrono::steady_clock::now().time_since_epoch().count() << "." << counter++;
+    string tempPath = tempName.str();
+    {
+        static const char padding[8] = {};
+        ofstream out(tempPath, ios::binary | ios::trunc);
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)constantCells.data(), constantCells.size() * 8);
+        out.write((const char*)variableRecords.data(), variableRecords.size() * sizeof(BycVariable));
+        out.write((const char*)parameterIndexes.data(), parameterIndexes.size() * sizeof(uint32_t));
+        out.write(padding, header.codeOffset - header.parametersOffset - parameterIndexes.size() * sizeof(uint32_t));
+        out.write((const char*)instructions.data(), instructions.size() * sizeof(BycInstr));
+        out.write(strings.data(), strings.size());
+        if (!out)
+        {
+            out.close();
+            error_code ec;
+            fs::remove(tempPath, ec);
+            error = "не удалось записать " + path;
+            return false;
+        }
+    }
+
+    error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec)
+    {
+        fs::remove(tempPath, ec);
+        error = "не удалось записать " + path;
+        return false;
+    }
+    return true;
+}
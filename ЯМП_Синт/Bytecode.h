@@ -0,0 +1,59 @@
+﻿#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "Ir.h"
+#include "ConstantPool.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Скомпилированная функция (файл .bc) для многократного исполнения без разбора текста.
+// Файл отображается в память и исполняется на месте: команды и константы не копируются
+// и не перекодируются. Все разделы выровнены на 8 байт, смещения - от начала файла,
+// поэтому файл не зависит от адреса отображения.
+//
+//   заголовок   "BYC1", версия, размер файла, глубина стека, имя функции, тип результата,
+//               число переменных, параметров, констант и команд, смещения разделов
+//   константы   по 8 байт: int32 в младших байтах или double, тип задает команда
+//   переменные  смещение имени, длина имени, тип
+//   параметры   номера переменных по 4 байта в порядке объявления
+//   команды     по 8 байт: операция IrOp, тип результата, номер переменной или константы
+//   строки      имя функции и имена переменных
+//
+// open проверяет структуру за один проход по командам: границы разделов, номера
+// переменных и констант, типы и глубину стека. Прошедший проверку код исполняется
+// без проверок. Вызовы функций других модулей в байт-код не записываются.
+class BytecodeFile
+{
+private:
+    MappedFile file;
+    const char* constants;
+    const char* variables;
+    const char* parameters;
+    const char* code;
+    uint32_t parameterTotal;
+    uint32_t variableTotal;
+    uint32_t instructionTotal;
+    uint32_t stackDepth;
+    ValueType resultType;
+    string name;
+
+public:
+    BytecodeFile();
+
+    bool open(const string& path, string& error);   // Отображение и проверка структуры
+    static bool write(const string& path, const IrFunction& function, string& error);
+
+    const string& getName() const { return name; }
+    size_t parameterCount() const { return parameterTotal; }
+    ValueType parameterType(size_t i) const;
+    ValueType getResultType() const { return resultType; }
+
+    // Аргументы - по одному на параметр, тип каждого совпадает с типом параметра
+    bool execute(const vector<Constant>& arguments, Constant& result, string& error) const;
+};
+
+#endif
@@ -0,0 +1,175 @@
+﻿#include "Compiler.h"
+#include "Lexer.h"
+#include "SymbolTable.h"
+#include "Parser.h"
+#include "Trace.h"
+#include <sstream>
+#include <locale>
+
+template <class TreeOutput>
+static bool runParser(Lexer& lexer, ostream& report, SymbolTable* symbols, InterfaceLibrary* interfaces,
+    bool needIr, CompileResult& result, const ResourceBudget* budget, unsigned parseThreads = 1)
+{
+    BasicParser<TreeOutput> parser(lexer, report, symbols, interfaces);
+    parser.setParseThreads(parseThreads);
+    parser.setBudget(budget);
+    bool correct = parser.parse();
+    result.aborted = parser.isAborted();
+    if (needIr && !parser.buildIr(result.program, result.irError))
+        result.irError = result.irError.empty() ? "не удалось построить IR" : result.irError;
+    result.exported = parser.getExport(result.signature);
+    result.errors = parser.getErrors();
+    result.warnings = parser.getWarnings();
+    result.postfix = parser.getPostfix();
+    return correct;
+}
+
+// Анализ прерван до начала разбора: в отчете только ошибка и итог
+static void reportAborted(ostream& report, const BudgetExceeded& exceeded, CompileResult& result)
+{
+    report << "=== ОШИБКИ ===" << endl << exceeded.what() << endl << endl;
+    report << "=== РЕЗУЛЬТАТ АНАЛИЗА ===" << endl << "Найдено ошибок: 1" << endl;
+    result.syntaxCorrect = false;
+    result.aborted = true;
+    result.errors.assign(1, exceeded.what());
+}
+
+void compileSource(const string& source, const string& treeFormat, InterfaceLibrary* interfaces,
+    bool needIr, CompileResult& result, unsigned parseThreads, StringInterner& strings, const ResourceLimits& limits)
+{
+    ostringstream report;
+    report.imbue(locale::classic());    // Отчет не зависит от локали процесса
+    SourceMap sourceMap(source);
+    SymbolTable symbols(strings);   // Лексемы и объявления переменных
+    ResourceBudget budget(limits);
+    budget.setTokenBytes(TokenStream::BYTES_PER_TOKEN);
+    symbols.setBudget(&budget);
+
+    // ОДИН раз читаем файл и сохраняем все токены в компактный поток
+    TokenStream allTokens(sourceMap);
+    try
+    {
+        budget.charge(source.size());
+        Lexer fileLexer(sourceMap, &symbols);
+        fileLexer.readAll(allTokens);
+    }
+    catch (const BudgetExceeded& exceeded)  // Прервано чтение лексем: ни таблицы, ни разбора
+    {
+        reportAborted(report, exceeded, result);
+        result.report = report.str();
+        return;
+    }
+
+    // Вывод таблицы лексем
+    symbols.printToFile(report);
+    report << "\n";
+
+    // Синтаксический анализ использует токены из памяти
+    Lexer memoryLexer(allTokens, &symbols);
+    if (treeFormat == "json")
+        result.syntaxCorrect = runParser<JsonTreeOutput>(memoryLexer, report, &symbols, interfaces, needIr, result, &budget, parseThreads);
+    else if (treeFormat == "none")
+        result.syntaxCorrect = runParser<NullTreeOutput>(memoryLexer, report, &symbols, interfaces, needIr, result, &budget, parseThreads);
+    else
+        result.syntaxCorrect = runParser<TextTreeOutput>(memoryLexer, report, &symbols, interfaces, needIr, result, &budget, parseThreads);
+    result.report = report.str();
+}
+
+static const size_t STREAM_CHANNEL_TOKENS = 4096;   // Лексем в очереди между чтением и разбором
+
+StreamCompiler::StreamCompiler(const string& treeFormat, InterfaceLibrary* interfaces, bool needIr,
+    const ResourceLimits& limits)
+    : budget(limits), channel(STREAM_CHANNEL_TOKENS), finished(false)
+{
+    symbols.setBudget(&budget);
+    uint32_t traceFile = Trace::getCurrentFile();
+    parser = thread([this, treeFormat, interfaces, needIr, traceFile]()
+    {
+        Trace::setCurrentFile(traceFile);
+        Lexer channelLexer(channel, &symbols);
+        try
+        {
+            if (treeFormat == "json")
+                result.syntaxCorrect = runParser<JsonTreeOutput>(channelLexer, parserOutput, &symbols, interfaces, needIr, result, &budget);
+            else if (treeFormat == "none")
+                result.syntaxCorrect = runParser<NullTreeOutput>(channelLexer, parserOutput, &symbols, interfaces, needIr, result, &budget);
+            else
+                result.syntaxCorrect = runParser<TextTreeOutput>(channelLexer, parserOutput, &symbols, interfaces, needIr, result, &budget);
+        }
+        catch (const BudgetExceeded& exceeded)  // Бюджет превышен первой же лексемой - разбор не начинался
+        {
+            reportAborted(parserOutput, exceeded, result);
+        }
+
+        // Лексемы после конца разбора тоже входят в таблицу - пока позволяет бюджет
+        try
+        {
+            if (!result.aborted)
+                while (channelLexer.getNextToken().getType() != TokenType::END_OF_FILE)
+                    ;
+        }
+        catch (const BudgetExceeded&)   // Текст после конца программы - уже ошибка "ожидался конец файла"
+        {
+        }
+        while (channel.pop().getType() != TokenType::END_OF_FILE)   // Остаток текста только пропускается
+            ;
+    });
+}
+
+StreamCompiler::~StreamCompiler()
+{
+    if (!finished)      // Текст не дочитан - разбор завершается на уже полученных лексемах
+    {
+        channel.close();
+        parser.join();
+    }
+}
+
+void StreamCompiler::pushScanned()
+{
+    for (Token& token : scanned)
+        channel.push(move(token));
+    scanned.clear();
+}
+
+void StreamCompiler::feed(const char* data, size_t size)
+{
+    lexer.feed(data, size, scanned);
+    pushScanned();
+}
+
+void StreamCompiler::finish(CompileResult& compiled)
+{
+    lexer.finish(scanned);
+    pushScanned();
+    channel.close(lexer.endOfText());
+    parser.join();
+    finished = true;
+
+    ostringstream report;
+    symbols.printToFile(report);
+    report << "\n" << parserOutput.str();
+    result.report = report.str();
+    compiled = move(result);
+}
+
+vector<string> scanImports(const string& source)
+{
+    TRACE_SCOPE("scanImports");
+    SourceMap sourceMap(source);
+    SymbolTable symbols;
+    Lexer lexer(sourceMap, &symbols);
+
+    vector<string> modules;
+    while (lexer.peekNextType() == TokenType::IMPORT)   // import Id ;
+    {
+        lexer.getNextToken();
+        Token name = lexer.getNextToken();
+        if (name.getType() != TokenType::ID)
+            break;
+        modules.push_back(name.getValue());
+        if (lexer.getNextToken().getType() != TokenType::SEMICOLON)
+            break;
+    }
+    return modules;
+}
@@ -0,0 +1,74 @@
+﻿#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "Ir.h"
+#include "Interface.h"
+#include "Lexer.h"
+#include "SymbolTable.h"
+#include "StringInterner.h"
+#include "TokenChannel.h"
+#include "ResourceBudget.h"
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+struct CompileResult        // Результат анализа одного исходного текста
+{
+    bool syntaxCorrect;
+    string report;          // Отчет: хеш-таблица, дерево, постфикс, ошибки
+    vector<string> errors;  // Те же ошибки, предупреждения и постфикс - без разбора отчета
+    vector<string> warnings;
+    vector<string> postfix;
+    IrFunction program;     // IR - только если он запрошен
+    string irError;
+    bool exported;          // Программа корректна, signature - ее функция
+    FunctionSignature signature;
+    bool aborted;           // Анализ прерван: превышен бюджет, ошибка об этом - последняя
+
+    CompileResult() : syntaxCorrect(false), exported(false), aborted(false) {}
+};
+
+// Полный анализ: лексер, разбор с деревом в формате treeFormat, постфикс.
+// interfaces - откуда берутся модули для import (nullptr - импорт недоступен).
+// parseThreads > 1 - длинные последовательности операторов разбираются и проверяются в нескольких потоках.
+// strings - словарь текстов лексем (по умолчанию общий для процесса).
+// limits - бюджет анализа: при превышении анализ прерывается с ошибкой в отчете.
+void compileSource(const string& source, const string& treeFormat, InterfaceLibrary* interfaces,
+    bool needIr, CompileResult& result, unsigned parseThreads = 1,
+    StringInterner& strings = StringInterner::global(), const ResourceLimits& limits = ResourceLimits());
+
+// Анализ текста, поступающего частями (например, из сокета): feed по мере получения,
+// finish в конце. Разбор идет в своем потоке и ждет лексемы, пока текст не дополнится,
+// поэтому в памяти - только незаконченный хвост текста и ограниченная очередь лексем.
+// Отчет совпадает с compileSource для того же текста.
+class StreamCompiler
+{
+private:
+    StreamLexer lexer;
+    ResourceBudget budget;  // Лексемы считает поток разбора - он заполняет таблицу
+    SymbolTable symbols;    // Заполняется потоком разбора
+    TokenChannel channel;
+    ostringstream parserOutput;     // Дерево и постфикс - в отчете они идут после таблицы лексем
+    CompileResult result;
+    thread parser;
+    vector<Token> scanned;  // Лексемы очередной части текста
+    bool finished;
+
+    void pushScanned();
+
+public:
+    StreamCompiler(const string& treeFormat, InterfaceLibrary* interfaces, bool needIr,
+        const ResourceLimits& limits = ResourceLimits());
+    ~StreamCompiler();
+
+    void feed(const char* data, size_t size);
+    void finish(CompileResult& compiled);   // Конец текста; результат - как у compileSource
+};
+
+// Имена модулей из import в начале текста - без разбора всей программы
+vector<string> scanImports(const string& source);
+
+#endif
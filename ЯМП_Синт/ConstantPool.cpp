@@ -0,0 +1,48 @@
+﻿#include "ConstantPool.h"
+#include <charconv>
+#include <cstring>
+
+bool ConstantPool::parse(TokenType kind, const char* first, const char* last, Constant& constant)
+{
+    constant = { kind == TokenType::INT_NUM ? ValueType::INT : ValueType::DOUBLE, 0, 0.0 };
+
+    // from_chars не зависит от локали и округляет вещественные значения точно
+    from_chars_result parsed = constant.type == ValueType::INT
+        ? from_chars(first, last, constant.intValue)
+        : from_chars(first, last, constant.doubleValue, chars_format::fixed);
+    if (parsed.ptr != last)
+        return false;
+    if (parsed.ec == errc::result_out_of_range && constant.type == ValueType::DOUBLE)
+    {
+        // from_chars не отличает потерю значимости от переполнения. Литерал - цифры с точкой,
+        // значит, переполнение - только при ненулевой целой части; иначе значение меньше
+        // наименьшего денормализованного и округляется до нуля
+        const char* digit = first;
+        while (digit != last && *digit == '0')
+            digit++;
+        constant.doubleValue = 0.0;
+        return digit != last && *digit == '.';
+    }
+    return parsed.ec == errc();
+}
+
+int ConstantPool::add(TokenType kind, const string& text)
+{
+    Constant constant;
+    if (!parse(kind, text.data(), text.data() + text.size(), constant))
+        return -1;
+
+    int next = (int)constants.size();
+    int index;
+    if (constant.type == ValueType::INT)
+        index = intIndex.emplace(constant.intValue, next).first->second;
+    else
+    {
+        uint64_t bits;
+        memcpy(&bits, &constant.doubleValue, sizeof(bits));
+        index = doubleIndex.emplace(bits, next).first->second;
+    }
+    if (index == next)
+        constants.push_back(constant);
+    return index;
+}
@@ -0,0 +1,42 @@
+﻿#ifndef CONSTANTPOOL_H
+#define CONSTANTPOOL_H
+
+#include "Token.h"
+#include "Ir.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+struct Constant             // Значение числового литерала
+{
+    ValueType type;
+    int32_t intValue;
+    double doubleValue;
+};
+
+// Пул констант: литерал разбирается один раз при первом появлении лексемы,
+// одинаковые значения ("1.5" и "1.50") занимают одну запись.
+class ConstantPool
+{
+private:
+    vector<Constant> constants;
+    unordered_map<int32_t, int> intIndex;       // Значение -> номер записи
+    unordered_map<uint64_t, int> doubleIndex;   // Биты значения -> номер записи
+
+public:
+    // Номер записи для лексемы INT_NUM или DOUBLE_NUM; -1, если значение
+    // не представимо в своем типе (целое вне диапазона int)
+    int add(TokenType kind, const string& text);
+
+    // Разбор литерала без копии текста; false - не представим в своем типе.
+    // Вне диапазона double только переполнение, слишком малое значение становится нулем.
+    static bool parse(TokenType kind, const char* first, const char* last, Constant& constant);
+
+    const Constant& at(int index) const { return constants[index]; }
+    size_t size() const { return constants.size(); }
+};
+
+#endif
@@ -0,0 +1,77 @@
+﻿#include "Dataflow.h"
+
+void DataflowPass::clear()
+{
+    variables.clear();
+    assigned.clear();
+    everAssigned.clear();
+    read.clear();
+    reported.clear();
+    warnings.clear();
+}
+
+int DataflowPass::declare(const string& name, int64_t line, int64_t position)
+{
+    int slot = (int)variables.size();
+    variables.push_back({ name, line, position });
+    if ((size_t)slot % 64 == 0)     // Множества растут по слову
+    {
+        assigned.resize(slot + 1);
+        everAssigned.resize(slot + 1);
+        read.resize(slot + 1);
+        reported.resize(slot + 1);
+    }
+    return slot;
+}
+
+void DataflowPass::assign(int slot)
+{
+    assigned.set(slot);
+    everAssigned.set(slot);
+}
+
+void DataflowPass::use(int slot, int64_t line, int64_t position)
+{
+    read.set(slot);
+    if (assigned.test(slot) || reported.test(slot))
+        return;
+    reported.set(slot);
+    warnings.push_back("строка " + to_string(line) + ", позиция " + to_string(position) +
+        ": переменная '" + variables[slot].name + "' используется до присваивания");
+}
+
+void DataflowPass::replay(const vector<DataflowEvent>& events)
+{
+    for (const DataflowEvent& event : events)
+    {
+        if (event.assignment)
+            assign(event.slot);
+        else
+            use(event.slot, event.line, event.position);
+    }
+}
+
+const vector<string>& DataflowPass::finish()
+{
+    // Непрочитанные переменные - слово за словом: ~read, затем разделение по everAssigned
+    for (size_t w = 0; w < read.wordCount(); w++)
+    {
+        uint64_t unused = ~read.word(w);
+        if (w == read.wordCount() - 1 && variables.size() % 64 != 0)   // Биты за последним слотом
+            unused &= (1ull << (variables.size() % 64)) - 1;
+        while (unused != 0)
+        {
+            int bit = 0;
+            while ((unused >> bit & 1) == 0)
+                bit++;
+            unused &= unused - 1;
+
+            const Variable& variable = variables[w * 64 + bit];
+            bool wasAssigned = (everAssigned.word(w) >> bit & 1) != 0;
+            warnings.push_back("строка " + to_string(variable.line) + ", позиция " + to_string(variable.position) +
+                (wasAssigned ? ": значение переменной '" + variable.name + "' не используется"
+                    : ": переменная '" + variable.name + "' объявлена, но не используется"));
+        }
+    }
+    return warnings;
+}
@@ -0,0 +1,71 @@
+﻿#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Плотное множество номеров переменных: по биту на переменную,
+// операции над множествами - по 64 переменные за одну машинную операцию
+class BitVector
+{
+private:
+    vector<uint64_t> words;
+
+public:
+    void resize(size_t bits) { words.resize((bits + 63) / 64, 0); }
+    void set(size_t bit) { words[bit >> 6] |= 1ull << (bit & 63); }
+    bool test(size_t bit) const { return (words[bit >> 6] >> (bit & 63) & 1) != 0; }
+    void clear() { words.clear(); }
+
+    size_t wordCount() const { return words.size(); }
+    uint64_t word(size_t i) const { return words[i]; }
+};
+
+struct DataflowEvent        // Чтение или присваивание, найденное при разборе фрагмента в другом потоке
+{
+    int slot;
+    int64_t line;           // Место чтения
+    int64_t position;
+    bool assignment;
+};
+
+// Поток данных по операторам функции: чтение переменной до присваивания и
+// переменные, значение которых не используется. Ветвлений и циклов в языке нет,
+// поэтому граф потока - цепочка операторов, и анализ - один проход вперед:
+// чтение проверяет бит "присвоена", присваивание его ставит. Переменная
+// каждого объявления (с учетом блоков) получает свой номер - слот.
+// Время - линейное по длине программы, память - два бита на переменную
+// и описание ее объявления.
+class DataflowPass
+{
+private:
+    struct Variable
+    {
+        string name;
+        int64_t line;
+        int64_t position;
+    };
+
+    vector<Variable> variables;     // По номерам слотов
+    BitVector assigned;             // Присвоены к текущему оператору
+    BitVector everAssigned;         // Присваивались хотя бы раз
+    BitVector read;                 // Читались хотя бы раз
+    BitVector reported;             // О чтении до присваивания уже сообщено
+    vector<string> warnings;
+
+public:
+    void clear();
+
+    int declare(const string& name, int64_t line, int64_t position);    // Новый слот
+    void assign(int slot);
+    void use(int slot, int64_t line, int64_t position);     // Чтение значения переменной
+    void replay(const vector<DataflowEvent>& events);   // События фрагмента в порядке текста
+
+    // Предупреждения: чтения до присваивания в порядке текста, затем неиспользуемые переменные
+    const vector<string>& finish();
+};
+
+#endif
@@ -0,0 +1,280 @@
+﻿#ifndef GRAMMAR_H
+#define GRAMMAR_H
+
+#include "Token.h"
+#include <cstdint>
+
+// Описание грамматики языка. По нему на этапе компиляции строятся
+// множества FIRST/FOLLOW и управляющая таблица LL(1)-разбора.
+
+typedef uint32_t TokenSet;  // Множество типов токенов - по одному биту на TokenType
+
+const int TOKEN_TYPE_COUNT = (int)TokenType::ERROR + 1;
+static_assert(TOKEN_TYPE_COUNT <= 32, "TokenSet must hold every TokenType");
+
+constexpr TokenSet tokenBit(TokenType t) { return TokenSet(1) << (int)t; }
+constexpr bool inSet(TokenSet set, TokenType t) { return (set & tokenBit(t)) != 0; }
+
+enum class NonTerminal
+{
+    FUNCTION, IMPORTS, IMPORT, BEGIN, PARAMS, PARAM, PARAMS_TAIL, DESCRIPTIONS, DESCR, TYPE, VARLIST, VARLIST_TAIL,
+    OPERATORS, OP, BLOCK, EXPR, EXPR_TAIL, SIMPLE_EXPR, ID_TAIL, ARGS, ARGS_TAIL, END,
+    COUNT
+};
+
+const int NON_TERMINAL_COUNT = (int)NonTerminal::COUNT;
+
+enum class Production       // Правила грамматики - в том же порядке, что и в GRAMMAR
+{
+    FUNCTION, IMPORTS_LIST, IMPORTS_EMPTY, IMPORT, BEGIN,
+    PARAMS_LIST, PARAMS_EMPTY, PARAM, PARAMS_TAIL_COMMA, PARAMS_TAIL_EMPTY,
+    DESCRIPTIONS_LIST, DESCRIPTIONS_EMPTY, DESCR,
+    TYPE_INT, TYPE_DOUBLE,
+    VARLIST, VARLIST_TAIL_COMMA, VARLIST_TAIL_EMPTY,
+    OPERATORS_LIST, OPERATORS_EMPTY, OP_ASSIGN, OP_BLOCK, BLOCK,
+    EXPR, EXPR_TAIL_PLUS, EXPR_TAIL_MINUS, EXPR_TAIL_EMPTY,
+    SIMPLE_ID, SIMPLE_INT, SIMPLE_DOUBLE, SIMPLE_PARENS, SIMPLE_ITOD, SIMPLE_DTOI,
+    ID_TAIL_CALL, ID_TAIL_EMPTY, ARGS_LIST, ARGS_EMPTY, ARGS_TAIL_COMMA, ARGS_TAIL_EMPTY,
+    END,
+    COUNT,
+    NONE = -1               // Пустая клетка таблицы - синтаксическая ошибка
+};
+
+struct GrammarRule
+{
+    NonTerminal lhs;        // Левая часть правила
+    int length;             // Длина правой части
+    int rhs[6];             // Символы правой части: терминал - TokenType, нетерминал - NT_BASE + NonTerminal
+};
+
+const int NT_BASE = 100;    // Смещение номеров нетерминалов в правой части правила
+
+constexpr int T(TokenType t) { return (int)t; }
+constexpr int N(NonTerminal n) { return NT_BASE + (int)n; }
+
+constexpr GrammarRule GRAMMAR[] =
+{
+    // Function → Imports Begin Descriptions Operators End
+    { NonTerminal::FUNCTION, 5, { N(NonTerminal::IMPORTS), N(NonTerminal::BEGIN), N(NonTerminal::DESCRIPTIONS), N(NonTerminal::OPERATORS), N(NonTerminal::END) } },
+    // Imports → Import Imports | ε
+    { NonTerminal::IMPORTS, 2, { N(NonTerminal::IMPORT), N(NonTerminal::IMPORTS) } },
+    { NonTerminal::IMPORTS, 0, {} },
+    // Import → import Id ;
+    { NonTerminal::IMPORT, 3, { T(TokenType::IMPORT), T(TokenType::ID), T(TokenType::SEMICOLON) } },
+    // Begin → Type Id ( Params ) {
+    { NonTerminal::BEGIN, 6, { N(NonTerminal::TYPE), T(TokenType::ID), T(TokenType::LPAREN), N(NonTerminal::PARAMS), T(TokenType::RPAREN), T(TokenType::LBRACE) } },
+    // Params → Param ParamsTail | ε
+    { NonTerminal::PARAMS, 2, { N(NonTerminal::PARAM), N(NonTerminal::PARAMS_TAIL) } },
+    { NonTerminal::PARAMS, 0, {} },
+    // Param → Type Id
+    { NonTerminal::PARAM, 2, { N(NonTerminal::TYPE), T(TokenType::ID) } },
+    // ParamsTail → , Param ParamsTail | ε
+    { NonTerminal::PARAMS_TAIL, 3, { T(TokenType::COMMA), N(NonTerminal::PARAM), N(NonTerminal::PARAMS_TAIL) } },
+    { NonTerminal::PARAMS_TAIL, 0, {} },
+    // Descriptions → Descr Descriptions | ε
+    { NonTerminal::DESCRIPTIONS, 2, { N(NonTerminal::DESCR), N(NonTerminal::DESCRIPTIONS) } },
+    { NonTerminal::DESCRIPTIONS, 0, {} },
+    // Descr → Type VarList ;
+    { NonTerminal::DESCR, 3, { N(NonTerminal::TYPE), N(NonTerminal::VARLIST), T(TokenType::SEMICOLON) } },
+    // Type → int | double
+    { NonTerminal::TYPE, 1, { T(TokenType::INT) } },
+    { NonTerminal::TYPE, 1, { T(TokenType::DOUBLE) } },
+    // VarList → Id VarListTail
+    { NonTerminal::VARLIST, 2, { T(TokenType::ID), N(NonTerminal::VARLIST_TAIL) } },
+    // VarListTail → , Id VarListTail | ε
+    { NonTerminal::VARLIST_TAIL, 3, { T(TokenType::COMMA), T(TokenType::ID), N(NonTerminal::VARLIST_TAIL) } },
+    { NonTerminal::VARLIST_TAIL, 0, {} },
+    // Operators → Op Operators | ε
+    { NonTerminal::OPERATORS, 2, { N(NonTerminal::OP), N(NonTerminal::OPERATORS) } },
+    { NonTerminal::OPERATORS, 0, {} },
+    // Op → Id = Expr ; | Block
+    { NonTerminal::OP, 4, { T(TokenType::ID), T(TokenType::ASSIGN), N(NonTerminal::EXPR), T(TokenType::SEMICOLON) } },
+    { NonTerminal::OP, 1, { N(NonTerminal::BLOCK) } },
+    // Block → { Descriptions Operators }
+    { NonTerminal::BLOCK, 4, { T(TokenType::LBRACE), N(NonTerminal::DESCRIPTIONS), N(NonTerminal::OPERATORS), T(TokenType::RBRACE) } },
+    // Expr → SimpleExpr ExprTail
+    { NonTerminal::EXPR, 2, { N(NonTerminal::SIMPLE_EXPR), N(NonTerminal::EXPR_TAIL) } },
+    // ExprTail → + Expr | - Expr | ε
+    { NonTerminal::EXPR_TAIL, 2, { T(TokenType::PLUS), N(NonTerminal::EXPR) } },
+    { NonTerminal::EXPR_TAIL, 2, { T(TokenType::MINUS), N(NonTerminal::EXPR) } },
+    { NonTerminal::EXPR_TAIL, 0, {} },
+    // SimpleExpr → Id IdTail | Const | ( Expr ) | itod ( Expr ) | dtoi ( Expr )
+    { NonTerminal::SIMPLE_EXPR, 2, { T(TokenType::ID), N(NonTerminal::ID_TAIL) } },
+    { NonTerminal::SIMPLE_EXPR, 1, { T(TokenType::INT_NUM) } },
+    { NonTerminal::SIMPLE_EXPR, 1, { T(TokenType::DOUBLE_NUM) } },
+    { NonTerminal::SIMPLE_EXPR, 3, { T(TokenType::LPAREN), N(NonTerminal::EXPR), T(TokenType::RPAREN) } },
+    { NonTerminal::SIMPLE_EXPR, 4, { T(TokenType::ITOD), T(TokenType::LPAREN), N(NonTerminal::EXPR), T(TokenType::RPAREN) } },
+    { NonTerminal::SIMPLE_EXPR, 4, { T(TokenType::DTOI), T(TokenType::LPAREN), N(NonTerminal::EXPR), T(TokenType::RPAREN) } },
+    // IdTail → ( Args ) | ε - вызов функции импортированного модуля или переменная
+    { NonTerminal::ID_TAIL, 3, { T(TokenType::LPAREN), N(NonTerminal::ARGS), T(TokenType::RPAREN) } },
+    { NonTerminal::ID_TAIL, 0, {} },
+    // Args → Expr ArgsTail | ε
+    { NonTerminal::ARGS, 2, { N(NonTerminal::EXPR), N(NonTerminal::ARGS_TAIL) } },
+    { NonTerminal::ARGS, 0, {} },
+    // ArgsTail → , Expr ArgsTail | ε
+    { NonTerminal::ARGS_TAIL, 3, { T(TokenType::COMMA), N(NonTerminal::EXPR), N(NonTerminal::ARGS_TAIL) } },
+    { NonTerminal::ARGS_TAIL, 0, {} },
+    // End → return Id ; }
+    { NonTerminal::END, 4, { T(TokenType::RETURN), T(TokenType::ID), T(TokenType::SEMICOLON), T(TokenType::RBRACE) } },
+};
+
+const int RULE_COUNT = sizeof(GRAMMAR) / sizeof(GRAMMAR[0]);
+static_assert(RULE_COUNT == (int)Production::COUNT, "Production must list every grammar rule");
+
+struct ParseTables
+{
+    TokenSet first[NON_TERMINAL_COUNT];     // FIRST для каждого нетерминала
+    bool nullable[NON_TERMINAL_COUNT];      // Выводится ли пустая строка
+    TokenSet follow[NON_TERMINAL_COUNT];    // FOLLOW для каждого нетерминала
+    Production table[NON_TERMINAL_COUNT][TOKEN_TYPE_COUNT];     // Управляющая таблица: правило по (нетерминал, токен)
+    bool isLL1;                             // false - в какой-то клетке таблицы конфликт двух правил
+};
+
+// FIRST цепочки rhs[from..length) и признак того, что вся цепочка выводит пустую строку
+constexpr TokenSet firstOfSequence(const ParseTables& t, const GrammarRule& rule, int from, bool& sequenceNullable)
+{
+    TokenSet result = 0;
+    for (int i = from; i < rule.length; ++i)
+    {
+        int symbol = rule.rhs[i];
+        if (symbol < NT_BASE)           // Терминал завершает цепочку
+        {
+            result |= TokenSet(1) << symbol;
+            sequenceNullable = false;
+            return result;
+        }
+        result |= t.first[symbol - NT_BASE];
+        if (!t.nullable[symbol - NT_BASE])
+        {
+            sequenceNullable = false;
+            return result;
+        }
+    }
+    sequenceNullable = true;
+    return result;
+}
+
+constexpr ParseTables buildParseTables()
+{
+    ParseTables t{};
+
+    // FIRST и nullable - итерация до неподвижной точки
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int r = 0; r < RULE_COUNT; ++r)
+        {
+            int lhs = (int)GRAMMAR[r].lhs;
+            bool sequenceNullable = false;
+            TokenSet first = firstOfSequence(t, GRAMMAR[r], 0, sequenceNullable);
+            if ((t.first[lhs] | first) != t.first[lhs])
+            {
+                t.first[lhs] |= first;
+                changed = true;
+            }
+            if (sequenceNullable && !t.nullable[lhs])
+            {
+                t.nullable[lhs] = true;
+                changed = true;
+            }
+        }
+    }
+
+    // FOLLOW: за аксиомой следует конец файла
+    t.follow[(int)NonTerminal::FUNCTION] = tokenBit(TokenType::END_OF_FILE);
+    changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int r = 0; r < RULE_COUNT; ++r)
+        {
+            const GrammarRule& rule = GRAMMAR[r];
+            for (int i = 0; i < rule.length; ++i)
+            {
+                if (rule.rhs[i] < NT_BASE)
+                    continue;
+                int symbol = rule.rhs[i] - NT_BASE;
+                bool restNullable = false;
+                TokenSet trailer = firstOfSequence(t, rule, i + 1, restNullable);
+                if (restNullable)
+                    trailer |= t.follow[(int)rule.lhs];
+                if ((t.follow[symbol] | trailer) != t.follow[symbol])
+                {
+                    t.follow[symbol] |= trailer;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Управляющая таблица
+    t.isLL1 = true;
+    for (int nt = 0; nt < NON_TERMINAL_COUNT; ++nt)
+        for (int tok = 0; tok < TOKEN_TYPE_COUNT; ++tok)
+            t.table[nt][tok] = Production::NONE;
+
+    for (int r = 0; r < RULE_COUNT; ++r)
+    {
+        int lhs = (int)GRAMMAR[r].lhs;
+        bool sequenceNullable = false;
+        TokenSet predict = firstOfSequence(t, GRAMMAR[r], 0, sequenceNullable);
+        if (sequenceNullable)
+            predict |= t.follow[lhs];
+
+        for (int tok = 0; tok < TOKEN_TYPE_COUNT; ++tok)
+        {
+            if ((predict & (TokenSet(1) << tok)) == 0)
+                continue;
+            if (t.table[lhs][tok] != Production::NONE)
+                t.isLL1 = false;
+            t.table[lhs][tok] = (Production)r;
+        }
+    }
+
+    return t;
+}
+
+constexpr ParseTables PARSE_TABLES = buildParseTables();
+static_assert(PARSE_TABLES.isLL1, "grammar is not LL(1)");
+
+// Выбор правила для нетерминала по текущему токену - один доступ к таблице
+constexpr Production predict(NonTerminal nt, TokenType t) { return PARSE_TABLES.table[(int)nt][(int)t]; }
+constexpr TokenSet firstSet(NonTerminal nt) { return PARSE_TABLES.first[(int)nt]; }
+constexpr TokenSet followSet(NonTerminal nt) { return PARSE_TABLES.follow[(int)nt]; }
+
+// Идентификатор на месте типа в Descriptions. По таблице это Descriptions → ε: Id начинает
+// первый оператор. Объявление с ошибкой в типе отличает второй токен - по нему выбирается
+// ветвь восстановления: продолжение списка переменных - объявление без типа,
+// начало списка переменных - объявление с неизвестным типом, иначе - оператор
+enum class DescrRecovery { NONE, WITHOUT_TYPE, UNKNOWN_TYPE };
+
+constexpr TokenSet DESCR_WITHOUT_TYPE = firstSet(NonTerminal::VARLIST_TAIL) | followSet(NonTerminal::VARLIST);
+constexpr TokenSet DESCR_UNKNOWN_TYPE = firstSet(NonTerminal::VARLIST);
+static_assert((DESCR_WITHOUT_TYPE & DESCR_UNKNOWN_TYPE) == 0, "recovery branches must not overlap");
+static_assert(!inSet(DESCR_WITHOUT_TYPE | DESCR_UNKNOWN_TYPE, (TokenType)GRAMMAR[(int)Production::OP_ASSIGN].rhs[1]),
+    "Id = Expr ; must stay an operator");
+
+constexpr DescrRecovery predictDescrRecovery(TokenType next)     // next - токен после Id
+{
+    return inSet(DESCR_WITHOUT_TYPE, next) ? DescrRecovery::WITHOUT_TYPE :
+        inSet(DESCR_UNKNOWN_TYPE, next) ? DescrRecovery::UNKNOWN_TYPE : DescrRecovery::NONE;
+}
+
+// Множества синхронизации для восстановления после ошибок
+
+// Конец оператора: ; или то, что может следовать за списком операторов (return, }), или конец файла
+constexpr TokenSet SYNC_STATEMENT = tokenBit(TokenType::SEMICOLON) |
+    followSet(NonTerminal::OPERATORS) | followSet(NonTerminal::FUNCTION);
+
+// Конец правила End: хвост "; }" или конец файла
+constexpr TokenSet SYNC_END = tokenBit(TokenType::SEMICOLON) | tokenBit(TokenType::RBRACE) |
+    followSet(NonTerminal::FUNCTION);
+
+// Продолжение или конец списка переменных: , ; следующее объявление, следующий идентификатор
+// (пропущенная запятая), конец списка операторов или конец файла
+constexpr TokenSet SYNC_VARLIST = firstSet(NonTerminal::VARLIST_TAIL) | followSet(NonTerminal::VARLIST) |
+    firstSet(NonTerminal::DESCR) | tokenBit(TokenType::ID) |
+    followSet(NonTerminal::OPERATORS) | followSet(NonTerminal::FUNCTION);
+
+#endif
@@ -1,145 +0,0 @@
-#include "HashTable.h"
-#include <iostream>
-#include <iomanip>
-
-HashTable::HashTable() : sequentialIndex(0)
-{
-    for (int i = 0; i < TABLE_SIZE; ++i)
-        table[i] = nullptr;
-}
-
-HashTable::~HashTable()
-{
-    clear();
-}
-
-int HashTable::hashFunction(const string& value) const // - -      0  TABLE_SIZE-1
-{
-    int hash = 0;               //   
-    for (char c : value)        //     
-        hash = (hash * 31 + c) % TABLE_SIZE;            //  ,   
-    return hash;                //     [0, TABLE_SIZE-1]
-}
-
-int HashTable::insert(const Token& token)
-{
-    string value = token.getValue();
-    int index = hashFunction(value);        //  -  
-
-    // ,       
-    HashEntry* current = table[index];      //      index
-    while (current != nullptr)              //       
-    {
-        if (current->occupied && current->token.getValue() == value)
-            return current->sequentialIndex;    //   -   
-        current = current->next;                //     
-    }
-
-    //    -   
-    HashEntry* newEntry = new HashEntry(token);
-    newEntry->sequentialIndex = sequentialIndex++;
-
-    //     (   )
-    if (table[index] == nullptr)        //   
-        table[index] = newEntry;        //     
-    else
-    {
-        //   -    
-        HashEntry* current = table[index];
-        while (current->next != nullptr)        //    
-            current = current->next;
-        current->next = newEntry;       //     
-    }
-
-    return newEntry->sequentialIndex;   //    
-}
-
-int HashTable::insertWithType(const Token& token, const string& type)
-{
-    string value = token.getValue();
-    int index = hashFunction(value);
-
-    // ,       
-    HashEntry* current = table[index];
-    while (current != nullptr)
-    {
-        if (current->occupied && current->token.getValue() == value)
-        {
-            current->varType = type; //  ,    
-            return current->sequentialIndex;
-        }
-        current = current->next;
-    }
-
-    //    -     
-    HashEntry* newEntry = new HashEntry(token, type);
-    newEntry->sequentialIndex = sequentialIndex++;
-
-    //    
-    if (table[index] == nullptr)
-        table[index] = newEntry;
-    else
-    {
-        HashEntry* current = table[index];
-        while (current->next != nullptr)
-            current = current->next;
-        current->next = newEntry;
-    }
-
-    return newEntry->sequentialIndex;
-}
-
-void HashTable::printToFile(ofstream& output) const
-{
-    output << setw(35) << "=== - ===" << "\n";
-    output << left;
-    output << setw(15) << " " << " | "
-        << setw(15) << "" << " | "
-        << "\n";
-    output << "----------------|-----------------|-------\n";
-
-    HashEntry** entries = new HashEntry*[sequentialIndex]; //    
-    for (int i = 0; i < sequentialIndex; ++i)
-        entries[i] = nullptr;       //     nullptr
-
-    //   
-    for (int i = 0; i < TABLE_SIZE; ++i)    //     
-    {
-        HashEntry* current = table[i];      //    
-        while (current != nullptr)          //    
-        {
-            if (current->occupied)          //   
-                entries[current->sequentialIndex] = current;    //     sequentialIndex
-            current = current->next;        //     
-        }
-    }
-
-    //      sequentialIndex
-    for (int i = 0; i < sequentialIndex; ++i)
-    {
-        if (entries[i] != nullptr) 
-        {
-            output << setw(15) << entries[i]->token.getTypeString() << " | "
-                << setw(15) << entries[i]->token.getValue() << " | "
-                << i << "\n";
-        }
-    }
-
-    delete[] entries;
-    output << "\n  : " << sequentialIndex << "\n";
-}
-
-void HashTable::clear()
-{
-    for (int i = 0; i < TABLE_SIZE; ++i)
-    {
-        HashEntry* current = table[i];
-        while (current != nullptr)
-        {
-            HashEntry* next = current->next;    //     
-            delete current;                     //   
-            current = next;                     //    
-        }
-        table[i] = nullptr; //   
-    }
-}
\ No newline at end of file
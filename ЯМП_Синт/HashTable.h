@@ -1,67 +0,0 @@
-#ifndef HASHTABLE_H
-#define HASHTABLE_H
-
-#include "Token.h"
-#include <fstream>
-
-struct HashEntry            //      -
-{
-    Token token;            //   ()
-    bool occupied;          // ,    
-    HashEntry* next;        //      
-    int sequentialIndex;    //     
-    string varType;         //  
-
-    HashEntry() : occupied(false), next(nullptr), sequentialIndex(-1) {}
-    HashEntry(const Token& t) : token(t), occupied(true), next(nullptr), sequentialIndex(-1) {}
-    HashEntry(const Token& t, const string& type) : token(t), occupied(true), next(nullptr), sequentialIndex(-1), varType(type) {}
-};
-
-class HashTable
-{
-private:
-    static const int TABLE_SIZE = 100;  //  - ()
-    HashEntry* table[TABLE_SIZE];       //     
-    int sequentialIndex;                //     
-
-    int hashFunction(const string& value) const;    // - -     
-
-public:
-    HashTable();
-    ~HashTable();
-
-    int insert(const Token& token);                 //    
-    int insertWithType(const Token& token, const string& type); //    
-    void printToFile(ofstream& output) const;       //    
-    void clear();                                   //  
-
-    bool contains(const string& value) const
-    {
-        int index = hashFunction(value);
-        HashEntry* current = table[index];
-
-        while (current != nullptr)
-        {
-            if (current->occupied && current->token.getValue() == value)
-                return true;
-            current = current->next;
-        }
-        return false;
-    }
-
-    string getVariableType(const string& varName) const //     
-    {
-        int index = hashFunction(varName);
-        HashEntry* current = table[index];
-
-        while (current != nullptr)
-        {
-            if (current->occupied && current->token.getValue() == varName)
-                return current->varType;
-            current = current->next;
-        }
-        return ""; //  ,    
-    }
-};
-
-#endif
\ No newline at end of file
@@ -0,0 +1,244 @@
+﻿#include "Interface.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+static const char IFC_MAGIC[4] = { 'I', 'F', 'C', '1' };
+static const uint32_t IFC_VERSION = 1;
+
+// Поля читаются и пишутся через memcpy: файл не обязан быть выровнен,
+// порядок байтов - порядок машины, собравшей модуль (x86-64 и Windows - little-endian)
+struct IfcHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t functionCount;
+    uint32_t recordsOffset;
+    uint32_t stringsOffset;
+    uint32_t fileSize;
+};
+
+struct IfcRecord
+{
+    uint32_t nameOffset;        // Смещения - от начала области строк
+    uint32_t paramsOffset;
+    uint16_t nameLength;
+    uint8_t returnType;
+    uint8_t paramCount;
+};
+
+static_assert(sizeof(IfcHeader) == 24, "IfcHeader layout");
+static_assert(sizeof(IfcRecord) == 12, "IfcRecord layout");
+
+bool InterfaceFile::attach(const char* data, size_t size, const string& name, string& error)
+{
+    IfcHeader header;
+    if (size < sizeof(header))
+    {
+        error = name + ": файл интерфейса поврежден";
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, IFC_MAGIC, sizeof(IFC_MAGIC)) != 0 || header.version != IFC_VERSION)
+    {
+        error = name + ": неизвестный формат интерфейса";
+        return false;
+    }
+    if (header.fileSize != size || header.recordsOffset < sizeof(header) ||
+        header.recordsOffset + (uint64_t)header.functionCount * sizeof(IfcRecord) > header.stringsOffset ||
+        header.stringsOffset > header.fileSize)
+    {
+        error = name + ": файл интерфейса поврежден";
+        return false;
+    }
+
+    count = header.functionCount;
+    records = data + header.recordsOffset;
+    strings = data + header.stringsOffset;
+    stringsSize = header.fileSize - header.stringsOffset;
+    return true;
+}
+
+bool InterfaceFile::open(const string& path, string& error)
+{
+    if (!file.open(path))
+    {
+        error = "не удалось открыть " + path;
+        return false;
+    }
+    return attach(file.getData(), file.getSize(), path, error);
+}
+
+bool InterfaceFile::open(const char* data, size_t size, const string& name, string& error)
+{
+    buffer.assign(data, size);
+    return attach(buffer.data(), buffer.size(), name, error);
+}
+
+bool InterfaceFile::function(size_t index, FunctionSignature& signature) const
+{
+    if (index >= count)
+        return false;
+    IfcRecord record;
+    memcpy(&record, records + index * sizeof(IfcRecord), sizeof(record));
+    if ((uint64_t)record.nameOffset + record.nameLength > stringsSize ||
+        (uint64_t)record.paramsOffset + record.paramCount > stringsSize || record.returnType > 1)
+        return false;
+
+    signature.name.assign(strings + record.nameOffset, record.nameLength);
+    signature.returnType = (ValueType)record.returnType;
+    signature.params.clear();
+    for (uint8_t p = 0; p < record.paramCount; p++)
+    {
+        uint8_t type = (uint8_t)strings[record.paramsOffset + p];
+        if (type > 1)
+            return false;
+        signature.params.push_back((ValueType)type);
+    }
+    return true;
+}
+
+bool InterfaceFile::find(const string& name, FunctionSignature& signature) const
+{
+    size_t low = 0, high = count;
+    while (low < high)
+    {
+        size_t middle = (low + high) / 2;
+        IfcRecord record;
+        memcpy(&record, records + middle * sizeof(IfcRecord), sizeof(record));
+        if ((uint64_t)record.nameOffset + record.nameLength > stringsSize)
+            return false;
+        int order = name.compare(0, string::npos, strings + record.nameOffset, record.nameLength);
+        if (order == 0)
+            return function(middle, signature);
+        if (order < 0)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return false;
+}
+
+bool InterfaceFile::encode(vector<FunctionSignature> functions, string& bytes, string& error)
+{
+    sort(functions.begin(), functions.end(), [](const FunctionSignature& a, const FunctionSignature& b)
+        { return a.name < b.name; });
+
+    string strings;
+    vector<IfcRecord> records;
+    for (const FunctionSignature& function : functions)
+    {
+        if (function.name.size() > UINT16_MAX || function.params.size() > UINT8_MAX)
+        {
+            error = "функция '" + function.name + "' не может быть экспортирована";
+            return false;
+        }
+        IfcRecord record;
+        record.nameOffset = (uint32_t)strings.size();
+        record.nameLength = (uint16_t)function.name.size();
+        strings += function.name;
+        record.paramsOffset = (uint32_t)strings.size();
+        record.paramCount = (uint8_t)function.params.size();
+        for (ValueType type : function.params)
+            strings += (char)type;
+        record.returnType = (uint8_t)function.returnType;
+        records.push_back(record);
+    }
+
+    IfcHeader header;
+    memcpy(header.magic, IFC_MAGIC, sizeof(IFC_MAGIC));
+    header.version = IFC_VERSION;
+    header.functionCount = (uint32_t)records.size();
+    header.recordsOffset = sizeof(IfcHeader);
+    header.stringsOffset = header.recordsOffset + (uint32_t)(records.size() * sizeof(IfcRecord));
+    header.fileSize = header.stringsOffset + (uint32_t)strings.size();
+
+    bytes.clear();
+    bytes.reserve(header.fileSize);
+    bytes.append((const char*)&header, sizeof(header));
+    bytes.append((const char*)records.data(), records.size() * sizeof(IfcRecord));
+    bytes += strings;
+    return true;
+}
+
+bool InterfaceFile::write(const string& path, vector<FunctionSignature> functions, string& error)
+{
+    string bytes;
+    if (!encode(move(functions), bytes, error))
+        return false;
+
+    // Как и в кеше результатов: временный файл и атомарное переименование,
+    // чтобы импортирующий модуль не увидел интерфейс частично записанным
+    static atomic<unsigned> counter(0);
+    ostringstream tempName;
+    tempName << path << ".tmp." << hash<thread::id>()(this_thread::get_id()) << "."
+        << chrono::steady_clock::now().time_since_epoch().count() << "." << counter++;
+    string tempPath = tempName.str();
+    {
+        ofstream out(tempPath, ios::binary | ios::trunc);
+        out.write(bytes.data(), bytes.size());
+        if (!out)
+        {
+            out.close();
+            error_code ec;
+            fs::remove(tempPath, ec);
+            error = "не удалось записать " + path;
+            return false;
+        }
+    }
+
+    error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec)
+    {
+        fs::remove(tempPath, ec);
+        error = "не удалось записать " + path;
+        return false;
+    }
+    return true;
+}
+
+const InterfaceFile* InterfaceLibrary::load(const string& module, string& error)
+{
+    lock_guard<mutex> guard(lock);
+    auto it = loaded.find(module);
+    if (it != loaded.end())
+        return it->second.get();
+
+    for (const string& directory : searchPath)
+    {
+        fs::path path = fs::path(directory) / fileName(module);
+        error_code ec;
+        if (!fs::exists(path, ec))
+            continue;
+        unique_ptr<InterfaceFile> ifc(new InterfaceFile());
+        if (!ifc->open(path.string(), error))
+            return nullptr;
+        return (loaded[module] = move(ifc)).get();
+    }
+    error = "не найден интерфейс модуля '" + module + "'";
+    return nullptr;
+}
+
+bool InterfaceLibrary::add(const string& module, const char* data, size_t size, string& error)
+{
+    unique_ptr<InterfaceFile> ifc(new InterfaceFile());
+    if (!ifc->open(data, size, fileName(module), error))
+        return false;
+
+    lock_guard<mutex> guard(lock);
+    if (loaded.count(module) != 0)  // Уже выданный интерфейс мог запомнить импортирующий разбор
+    {
+        error = "модуль '" + module + "' уже загружен";
+        return false;
+    }
+    loaded[module] = move(ifc);
+    return true;
+}
@@ -0,0 +1,67 @@
+﻿#ifndef INTERFACE_H
+#define INTERFACE_H
+
+#include "Ir.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+// Интерфейс скомпилированного модуля (файл .ifc): сигнатуры экспортируемых функций.
+// Формат рассчитан на отображение в память: заголовок, массив записей фиксированного
+// размера, отсортированный по имени, и область строк. Открытие проверяет только
+// заголовок и не зависит от размера модуля; запись читается при обращении к ней.
+//
+//   заголовок   "IFC1", версия, число функций, смещение записей, смещение строк, размер файла
+//   запись      смещение имени, смещение типов параметров, длина имени, тип результата, число параметров
+//   строки      имена функций и типы параметров (по байту на параметр)
+class InterfaceFile
+{
+private:
+    MappedFile file;
+    string buffer;              // Интерфейс, переданный из памяти
+    uint32_t count;             // Число функций
+    const char* records;
+    const char* strings;
+    size_t stringsSize;
+
+    bool attach(const char* data, size_t size, const string& name, string& error);   // Проверка заголовка
+
+public:
+    InterfaceFile() : count(0), records(nullptr), strings(nullptr), stringsSize(0) {}
+
+    bool open(const string& path, string& error);
+    bool open(const char* data, size_t size, const string& name, string& error);   // Копия содержимого .ifc
+    static bool encode(vector<FunctionSignature> functions, string& bytes, string& error);
+    static bool write(const string& path, vector<FunctionSignature> functions, string& error);
+
+    size_t functionCount() const { return count; }
+    bool function(size_t index, FunctionSignature& signature) const;    // false - запись повреждена
+    bool find(const string& name, FunctionSignature& signature) const;  // Двоичный поиск по имени
+};
+
+// Интерфейсы модулей, доступные для import. Модуль name ищется как name.ifc
+// в каталогах поиска по порядку; интерфейс можно и передать из памяти (add).
+// Загруженные файлы остаются отображенными до уничтожения библиотеки;
+// load и add можно вызывать из нескольких потоков.
+class InterfaceLibrary
+{
+private:
+    vector<string> searchPath;
+    mutex lock;
+    unordered_map<string, unique_ptr<InterfaceFile>> loaded;
+
+public:
+    explicit InterfaceLibrary(const vector<string>& directories) : searchPath(directories) {}
+
+    static string fileName(const string& module) { return module + ".ifc"; }
+
+    const InterfaceFile* load(const string& module, string& error);    // nullptr - модуль не найден
+    bool add(const string& module, const char* data, size_t size, string& error);  // Без файла на диске
+};
+
+#endif
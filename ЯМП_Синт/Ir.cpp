@@ -0,0 +1,223 @@
+﻿#include "Ir.h"
+#include "SymbolTable.h"
+#include <unordered_map>
+#include <algorithm>
+
+static IrInstr makeInstr(IrOp op, ValueType type, int var = -1)
+{
+    IrInstr instr = { op, type, var, 0, 0.0 };
+    return instr;
+}
+
+bool buildIr(const vector<PostfixToken>& postfix, const vector<size_t>& declarationEnds, const FunctionTable& imports,
+    const SymbolTable& symbols, const string& functionName, const string& functionType, IrFunction& function, string& error)
+{
+    function = IrFunction();
+    function.name = functionName;
+    function.returnType = functionType == "double" ? ValueType::DOUBLE : ValueType::INT;
+
+    vector<unordered_map<string, int>> scopes(1);   // Имя -> номер переменной, по блокам
+    vector<ValueType> typeStack;                    // Типы значений на стеке - для проверки IR
+    size_t nextDeclaration = 0;
+    bool returned = false;
+
+    auto lookup = [&](const string& name) -> int
+    {
+        for (size_t s = scopes.size(); s-- > 0; )
+        {
+            auto it = scopes[s].find(name);
+            if (it != scopes[s].end())
+                return it->second;
+        }
+        return -1;
+    };
+    auto pop = [&](ValueType& type) -> bool
+    {
+        if (typeStack.empty())
+            return false;
+        type = typeStack.back();
+        typeStack.pop_back();
+        return true;
+    };
+    auto findLiteral = [&](const string& text) -> const Symbol*    // Запись числового литерала или nullptr
+    {
+        int handle = symbols.find(text);
+        return handle >= 0 && symbols.at(handle).isLiteral() ? &symbols.at(handle) : nullptr;
+    };
+    auto isCommand = [&](size_t index, const char* command) -> bool
+    {
+        return index < postfix.size() && postfix[index].command && postfix[index].text == command;
+    };
+
+    for (size_t i = 0; i < postfix.size(); i++)
+    {
+        const string& token = postfix[i].text;
+        if (returned)
+        {
+            error = "код после return";
+            return false;
+        }
+
+        if (isCommand(i, "DECLARE"))
+        {
+            if (nextDeclaration >= declarationEnds.size() || declarationEnds[nextDeclaration] <= i + 1)
+            {
+                error = "не найден конец объявления";
+                return false;
+            }
+            size_t end = declarationEnds[nextDeclaration++];
+            ValueType type = postfix[i + 1].text == "double" ? ValueType::DOUBLE : ValueType::INT;
+            for (size_t j = i + 2; j < end; j++)
+            {
+                scopes.back()[postfix[j].text] = (int)function.variables.size();
+                function.variables.push_back({ postfix[j].text, type });
+            }
+            i = end - 1;
+        }
+        else if (token == "int" || token == "double")  // Параметр: тип имя PARAM
+        {
+            if (!isCommand(i + 2, "PARAM") || !function.code.empty())
+            {
+                error = "некорректное объявление параметра";
+                return false;
+            }
+            ValueType type = token == "double" ? ValueType::DOUBLE : ValueType::INT;
+            scopes.back()[postfix[i + 1].text] = (int)function.variables.size();
+            function.parameters.push_back((int)function.variables.size());
+            function.variables.push_back({ postfix[i + 1].text, type });
+            i += 2;
+        }
+        else if (isCommand(i + 1, "IMPORT"))   // Импорт: имя модуля IMPORT
+        {
+            if (!function.code.empty() || !function.parameters.empty())
+            {
+                error = "импорт после начала функции";
+                return false;
+            }
+            i++;
+        }
+        else if (token == "{")
+            scopes.emplace_back();
+        else if (token == "}")
+        {
+            if (scopes.size() == 1)
+            {
+                error = "несбалансированный блок";
+                return false;
+            }
+            scopes.pop_back();
+        }
+        else if (token == "=" || isCommand(i, "RETURN"))
+        {
+            // Перед = и RETURN стоит имя переменной - его LOAD превращается в STORE/RETURN
+            ValueType target, value;
+            if (function.code.empty() || function.code.back().op != IrOp::LOAD || !pop(target))
+            {
+                error = "ожидалась переменная перед " + token;
+                return false;
+            }
+            if (token == "=")
+            {
+                if (!pop(value) || value != target)
+                {
+                    error = "несоответствие типов в присваивании";
+                    return false;
+                }
+                function.code.back().op = IrOp::STORE;
+            }
+            else
+            {
+                if (target != function.returnType)
+                {
+                    error = "несоответствие типа возврата";
+                    return false;
+                }
+                function.code.push_back(makeInstr(IrOp::RETURN, target));
+                returned = true;
+            }
+        }
+        else if (token == "+" || token == "-")
+        {
+            ValueType right, left;
+            if (!pop(right) || !pop(left) || left != right)
+            {
+                error = "некорректные операнды операции " + token;
+                return false;
+            }
+            function.code.push_back(makeInstr(token == "+" ? IrOp::ADD : IrOp::SUB, left));
+            typeStack.push_back(left);
+        }
+        else if (token == "itod" || token == "dtoi")
+        {
+            bool toDouble = token == "itod";
+            ValueType arg;
+            if (!pop(arg) || arg != (toDouble ? ValueType::INT : ValueType::DOUBLE))
+            {
+                error = "некорректный аргумент " + token;
+                return false;
+            }
+            ValueType result = toDouble ? ValueType::DOUBLE : ValueType::INT;
+            function.code.push_back(makeInstr(toDouble ? IrOp::ITOD : IrOp::DTOI, result));
+            typeStack.push_back(result);
+        }
+        else if (isCommand(i + 1, "CALL"))
+        {
+            auto callee = imports.find(token);
+            if (callee == imports.end())
+            {
+                error = "вызов неизвестной функции '" + token + "'";
+                return false;
+            }
+            const FunctionSignature& signature = callee->second;
+            if (typeStack.size() < signature.params.size() ||
+                !equal(signature.params.begin(), signature.params.end(), typeStack.end() - signature.params.size()))
+            {
+                error = "некорректные аргументы функции '" + token + "'";
+                return false;
+            }
+            typeStack.resize(typeStack.size() - signature.params.size());
+
+            int index = 0;      // Каждая функция входит в callees один раз
+            while (index < (int)function.callees.size() && function.callees[index].name != token)
+                index++;
+            if (index == (int)function.callees.size())
+                function.callees.push_back(signature);
+            function.code.push_back(makeInstr(IrOp::CALL, signature.returnType, index));
+            typeStack.push_back(signature.returnType);
+            i++;
+        }
+        else if (const Symbol* literal = findLiteral(token))
+        {
+            int index = literal->constant;
+            if (index < 0)
+            {
+                error = "константа " + token + " вне диапазона";
+                return false;
+            }
+            const Constant& constant = symbols.getConstants().at(index);
+            IrInstr instr = makeInstr(constant.type == ValueType::INT ? IrOp::CONST_INT : IrOp::CONST_DOUBLE, constant.type);
+            instr.intValue = constant.intValue;
+            instr.doubleValue = constant.doubleValue;
+            function.code.push_back(instr);
+            typeStack.push_back(constant.type);
+        }
+        else
+        {
+            int var = lookup(token);
+            if (var < 0)
+            {
+                error = "необъявленная переменная '" + token + "'";
+                return false;
+            }
+            function.code.push_back(makeInstr(IrOp::LOAD, function.variables[var].type, var));
+            typeStack.push_back(function.variables[var].type);
+        }
+    }
+
+    if (!returned)
+    {
+        error = "функция не возвращает значение";
+        return false;
+    }
+    return true;
+}
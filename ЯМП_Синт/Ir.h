@@ -0,0 +1,88 @@
+﻿#ifndef IR_H
+#define IR_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+class SymbolTable;
+
+// Промежуточное представление функции для генерации машинного кода.
+// Код - стековый, в порядке постфиксной записи; имена переменных
+// разрешены с учетом вложенных блоков, каждая переменная имеет свой номер.
+
+enum class ValueType { INT, DOUBLE };
+
+struct FunctionSignature    // Функция, экспортируемая модулем
+{
+    string name;
+    ValueType returnType;
+    vector<ValueType> params;
+};
+
+typedef unordered_map<string, FunctionSignature> FunctionTable;     // Импортированные функции по имени
+
+enum class IrOp
+{
+    CONST_INT,      // Положить целую константу
+    CONST_DOUBLE,   // Положить вещественную константу
+    LOAD,           // Положить значение переменной
+    STORE,          // Снять значение и записать в переменную
+    ADD, SUB,       // Снять два операнда, положить результат
+    ITOD, DTOI,     // Преобразование вершины стека
+    CALL,           // Снять аргументы, положить результат функции другого модуля
+    RETURN          // Снять значение и вернуть его из функции
+};
+
+struct IrInstr
+{
+    IrOp op;
+    ValueType type;     // Тип результата (для STORE и RETURN - тип значения)
+    int var;            // Номер переменной для LOAD/STORE, номер вызываемой функции для CALL
+    int32_t intValue;
+    double doubleValue;
+};
+
+struct IrVariable
+{
+    string name;
+    ValueType type;
+};
+
+struct IrFunction
+{
+    string name;
+    ValueType returnType;
+    vector<IrVariable> variables;
+    vector<int> parameters;     // Номера переменных-параметров в порядке объявления
+    vector<FunctionSignature> callees;  // Вызываемые функции других модулей
+    vector<IrInstr> code;
+};
+
+// dtoi отбрасывает дробную часть; вне диапазона int результат - INT32_MIN,
+// как у команды cvttsd2si. Одна и та же семантика у всех способов исполнения.
+inline int32_t truncateToInt32(double value)
+{
+    return (value > -2147483649.0 && value < 2147483648.0) ? (int32_t)value : INT32_MIN;
+}
+
+// Элемент постфиксной записи. Служебные слова (DECLARE, PARAM, IMPORT, CALL, RETURN)
+// помечены явно: имя переменной или модуля в тексте программы может совпасть с ними.
+// Знаки операций, скобки блоков и ключевые слова с именами не совпадают.
+struct PostfixToken
+{
+    string text;
+    bool command;           // Служебное слово записи, а не лексема текста
+};
+
+// Построение IR по постфиксной записи корректной программы.
+// declarationEnds - индексы в postfix, на которых заканчивается каждое объявление DECLARE,
+// imports - функции, вызов которых записан как "имя CALL", значения литералов берутся
+// из пула констант таблицы символов.
+bool buildIr(const vector<PostfixToken>& postfix, const vector<size_t>& declarationEnds, const FunctionTable& imports,
+    const SymbolTable& symbols, const string& functionName, const string& functionType, IrFunction& function, string& error);
+
+#endif
@@ -1,270 +1,585 @@
 ﻿#include "Lexer.h"
+#include "MappedFile.h"
+#include "TextScan.h"
+#include "Trace.h"
 #include <iostream>
+#include <cstdint>
+#include <cstring>
 
-// Конструктор лексера - открывает файл и читает первый символ
-Lexer::Lexer(const string& filename, HashTable* ht)
-    : hashTable(ht), currentLine(1), currentPos(1), useMemoryMode(false), memoryIndex(0)
+// Классы символов - столбцы таблицы переходов
+enum CharClass : uint8_t
 {
-    input.open(filename);
-    if (input.is_open())
-        currentChar = input.get();
-    else
+    CC_ZERO,        // 0
+    CC_DIGIT,       // 1-9
+    CC_LETTER,      // a-z, A-Z
+    CC_UNDERSCORE,  // _
+    CC_DOT,         // .
+    CC_SPACE,       // пробельные символы, кроме перевода строки
+    CC_NEWLINE,     // \n
+    CC_OPERATOR,    // = + - * / , ; ( ) { }
+    CC_OTHER,       // прочие ASCII символы
+    CC_UTF8,        // байты многобайтовых UTF-8 символов
+    CC_COUNT
+};
+
+// Состояния автомата - строки таблицы переходов
+enum LexState : uint8_t
+{
+    S_START,
+    S_NUM_ZERO,     // Прочитан ведущий 0
+    S_NUM_INT,      // Целая часть
+    S_NUM_DOT,      // Точка без дробной части (ошибка, если на ней остановились)
+    S_NUM_FRAC,     // Дробная часть
+    S_NUM_ERROR,    // Ошибочное число: 0 перед цифрой, буква, вторая точка
+    S_IDENT,        // Идентификатор до первой цифры
+    S_IDENT_DIGITS, // Цифровая часть идентификатора
+    S_IDENT_ERROR,  // Буква после цифр в идентификаторе
+    S_ERROR_WORD,   // Ошибочная лексема до пробела или оператора
+    S_OPERATOR,     // Односимвольный оператор или разделитель
+    S_STOP,         // Конец лексемы - символ в нее не входит
+    S_COUNT
+};
+
+struct LexTables
+{
+    uint8_t charClass[256];                 // Класс для каждого байта
+    uint8_t next[S_COUNT][CC_COUNT];        // Таблица переходов
+    TokenType accept[S_COUNT];              // Тип токена при остановке в состоянии
+    TokenType operatorType[256];            // Тип токена для символа-оператора
+};
+
+constexpr LexTables buildLexTables()
+{
+    LexTables t{};
+
+    for (int c = 0; c < 256; ++c)
     {
-        currentChar = EOF;
-        cout << "Ошибка: не удалось открыть файл " << filename << endl;
+        t.charClass[c] = c < 0x80 ? CC_OTHER : CC_UTF8;
+        t.operatorType[c] = TokenType::ERROR;
     }
+    t.charClass[(int)'0'] = CC_ZERO;
+    for (int c = '1'; c <= '9'; ++c)
+        t.charClass[c] = CC_DIGIT;
+    for (int c = 'a'; c <= 'z'; ++c)
+        t.charClass[c] = CC_LETTER;
+    for (int c = 'A'; c <= 'Z'; ++c)
+        t.charClass[c] = CC_LETTER;
+    t.charClass[(int)'_'] = CC_UNDERSCORE;
+    t.charClass[(int)'.'] = CC_DOT;
+    t.charClass[(int)' '] = t.charClass[(int)'\t'] = t.charClass[(int)'\v'] =
+        t.charClass[(int)'\f'] = t.charClass[(int)'\r'] = CC_SPACE;
+    t.charClass[(int)'\n'] = CC_NEWLINE;
+
+    const char operators[] = "=+-*/,;(){}";
+    const TokenType operatorTypes[] =
+    {
+        TokenType::ASSIGN, TokenType::PLUS, TokenType::MINUS, TokenType::MULT, TokenType::DIV,
+        TokenType::COMMA, TokenType::SEMICOLON, TokenType::LPAREN, TokenType::RPAREN,
+        TokenType::LBRACE, TokenType::RBRACE
+    };
+    for (int i = 0; operators[i] != '\0'; ++i)
+    {
+        t.charClass[(unsigned char)operators[i]] = CC_OPERATOR;
+        t.operatorType[(unsigned char)operators[i]] = operatorTypes[i];
+    }
+
+    for (int s = 0; s < S_COUNT; ++s)
+        for (int c = 0; c < CC_COUNT; ++c)
+            t.next[s][c] = S_STOP;
+
+    // Начало лексемы: класс первого символа выбирает ветвь автомата
+    t.next[S_START][CC_ZERO] = S_NUM_ZERO;
+    t.next[S_START][CC_DIGIT] = S_NUM_INT;
+    t.next[S_START][CC_LETTER] = S_IDENT;
+    t.next[S_START][CC_UNDERSCORE] = S_ERROR_WORD;
+    t.next[S_START][CC_DOT] = S_ERROR_WORD;
+    t.next[S_START][CC_OTHER] = S_ERROR_WORD;
+    t.next[S_START][CC_UTF8] = S_ERROR_WORD;       // Не-ASCII буквы не входят в идентификаторы
+    t.next[S_START][CC_OPERATOR] = S_OPERATOR;
+
+    // Числа: ведущий ноль перед цифрой, буква или _ внутри числа и вторая точка - ошибка
+    const uint8_t numberStates[] = { S_NUM_ZERO, S_NUM_INT, S_NUM_DOT, S_NUM_FRAC, S_NUM_ERROR };
+    for (uint8_t s : numberStates)
+    {
+        t.next[s][CC_LETTER] = S_NUM_ERROR;
+        t.next[s][CC_UNDERSCORE] = S_NUM_ERROR;
+        t.next[s][CC_ZERO] = t.next[s][CC_DIGIT] = S_NUM_ERROR;
+        t.next[s][CC_DOT] = S_NUM_ERROR;
+    }
+    t.next[S_NUM_ZERO][CC_DOT] = S_NUM_DOT;
+    t.next[S_NUM_INT][CC_ZERO] = t.next[S_NUM_INT][CC_DIGIT] = S_NUM_INT;
+    t.next[S_NUM_INT][CC_DOT] = S_NUM_DOT;
+    t.next[S_NUM_DOT][CC_ZERO] = t.next[S_NUM_DOT][CC_DIGIT] = S_NUM_FRAC;
+    t.next[S_NUM_FRAC][CC_ZERO] = t.next[S_NUM_FRAC][CC_DIGIT] = S_NUM_FRAC;
+
+    // Идентификаторы: буква после цифровой части - ошибка
+    t.next[S_IDENT][CC_LETTER] = t.next[S_IDENT][CC_UNDERSCORE] = S_IDENT;
+    t.next[S_IDENT][CC_ZERO] = t.next[S_IDENT][CC_DIGIT] = S_IDENT_DIGITS;
+    t.next[S_IDENT_DIGITS][CC_ZERO] = t.next[S_IDENT_DIGITS][CC_DIGIT] =
+        t.next[S_IDENT_DIGITS][CC_UNDERSCORE] = S_IDENT_DIGITS;
+    t.next[S_IDENT_DIGITS][CC_LETTER] = S_IDENT_ERROR;
+    t.next[S_IDENT_ERROR][CC_LETTER] = t.next[S_IDENT_ERROR][CC_UNDERSCORE] =
+        t.next[S_IDENT_ERROR][CC_ZERO] = t.next[S_IDENT_ERROR][CC_DIGIT] = S_IDENT_ERROR;
+
+    // Ошибочная лексема поглощает все до пробела или оператора
+    t.next[S_ERROR_WORD][CC_ZERO] = t.next[S_ERROR_WORD][CC_DIGIT] = t.next[S_ERROR_WORD][CC_LETTER] =
+        t.next[S_ERROR_WORD][CC_UNDERSCORE] = t.next[S_ERROR_WORD][CC_DOT] = t.next[S_ERROR_WORD][CC_OTHER] =
+        t.next[S_ERROR_WORD][CC_UTF8] = S_ERROR_WORD;
+
+    for (int s = 0; s < S_COUNT; ++s)
+        t.accept[s] = TokenType::ERROR;
+    t.accept[S_NUM_ZERO] = TokenType::INT_NUM;
+    t.accept[S_NUM_INT] = TokenType::INT_NUM;
+    t.accept[S_NUM_FRAC] = TokenType::DOUBLE_NUM;
+    t.accept[S_IDENT] = TokenType::ID;
+    t.accept[S_IDENT_DIGITS] = TokenType::ID;
+
+    return t;
+}
+
+static constexpr LexTables LEX_TABLES = buildLexTables();
+
+// Конструктор лексера - разбирает текст, уже прочитанный в память
+Lexer::Lexer(const SourceMap& src, SymbolTable* table)
+    : source(&src), sourcePos(src.getTextStart()), asciiUntil(0), symbolTable(table),
+    memoryTokens(nullptr), memoryIndex(0), memoryEnd(0), useMemoryMode(false), channel(nullptr)
+{
 }
 
 // Новый конструктор для работы с памятью
-Lexer::Lexer(const vector<Token>& tokens, HashTable* ht)
-    : hashTable(ht), memoryTokens(tokens), memoryIndex(0), useMemoryMode(true),
-    currentLine(1), currentPos(1), currentChar(EOF)
+Lexer::Lexer(const TokenStream& tokens, SymbolTable* table)
+    : source(nullptr), sourcePos(0), asciiUntil(0), symbolTable(table),
+    memoryTokens(&tokens), memoryIndex(0), memoryEnd(tokens.size()), useMemoryMode(true), channel(nullptr)
 {
     // Ничего не делаем - все токены уже в памяти
 }
 
-Lexer::~Lexer()
+// Часть потока - за ней лексер выдает конец файла
+Lexer::Lexer(const TokenStream& tokens, SymbolTable* table, size_t begin, size_t end)
+    : source(nullptr), sourcePos(0), asciiUntil(0), symbolTable(table),
+    memoryTokens(&tokens), memoryIndex(begin), memoryEnd(end), useMemoryMode(true), channel(nullptr)
 {
-    if (input.is_open())
-        input.close();              // Закрываем файловый поток
 }
 
-void Lexer::skipWhitespace() // Пропуск пробелов
+// Лексемы текста, поступающего частями, - их выдает StreamLexer в другом потоке
+Lexer::Lexer(TokenChannel& tokens, SymbolTable* table)
+    : source(nullptr), sourcePos(0), asciiUntil(0), symbolTable(table),
+    memoryTokens(nullptr), memoryIndex(0), memoryEnd(0), useMemoryMode(false), channel(&tokens)
 {
-    while (hasMoreTokens())
-    {
-        if (currentChar == '\n')
-        {
-            currentLine++;
-            currentPos = 1;
-            currentChar = input.get();
-        }
-        else if (isspace(currentChar))
-        {
-            currentPos++;
-            currentChar = input.get();
-        }
-        else
-            break;
-    }
 }
 
-char Lexer::getNextChar()           // Получает следующий символ из потока
+Lexer::~Lexer()
 {
-    if (input.eof())
-        return EOF;                 // Достигнут конец файла
-
-    char ch = input.get();
-    if (ch != EOF && ch != '\n')    // Обновляем позицию
-        currentPos++;
+}
 
-    return ch;
+void Lexer::skipWhitespace() // Пропуск пробелов и переводов строк - номера строк здесь не считаются
+{
+    const string& text = source->getText();
+    while (sourcePos < text.size())
+    {
+        uint8_t cls = LEX_TABLES.charClass[(unsigned char)text[sourcePos]];
+        if (cls != CC_SPACE && cls != CC_NEWLINE)
+            break;
+        sourcePos++;
+    }
 }
 
 bool Lexer::hasMoreTokens() const   // Проверяет, есть ли еще символы для обработки
 {
+    if (channel != nullptr)
+        return channel->peek().getType() != TokenType::END_OF_FILE;
     if (useMemoryMode) {
-        return memoryIndex < memoryTokens.size();
+        return memoryIndex < memoryEnd;
     }
-    return currentChar != EOF;
+    return sourcePos < source->getText().size();
 }
 
-Token Lexer::recognizeNumber()
+// Распознавание лексемы, начатой в start, с позиции pos в состоянии state.
+// Возвращает false, если текст кончился раньше лексемы. При final == false это значит,
+// что продолжение текста еще не получено: pos и state сохраняются, и разбор
+// продолжается с них, когда текст дополнится.
+static bool scanLexeme(const char* text, size_t size, size_t start, size_t& pos, uint8_t& state,
+    size_t& asciiUntil, bool final)
 {
-    string value;
-    int startLine = currentLine;
-    int startPos = currentPos;
-    bool hasDot = false;
-    bool hasError = false;
-
-    // Проверка: если число начинается с 0 и следующий символ - цифра, это ошибка
-    if (currentChar == '0' && hasMoreTokens())
+    if (size - start > MAX_LEXEME_LENGTH)   // Лексема кончается не дальше предельной длины
     {
-        char nextChar = input.peek(); // Смотрим следующий символ без чтения
-        if (isdigit(nextChar))
-            hasError = true; // Число начинается с 0 и имеет другие цифры - ошибка
+        size = start + MAX_LEXEME_LENGTH;
+        final = true;
     }
-
-    // Сначала собираем все символы, которые могут быть частью числа или ошибочного идентификатора
-    while (hasMoreTokens() && (isdigit(currentChar) || currentChar == '.' || isalpha(currentChar) || currentChar == '_'))
+    while (pos < size)
     {
-        if (isalpha(currentChar) || currentChar == '_')
-            hasError = true; // Нашли букву или _ - это ошибка
+        if (pos >= asciiUntil)      // Векторно находим, докуда дальше идет чистый ASCII
+            asciiUntil = findNonAscii(text, pos, size);
 
-        if (currentChar == '.')
+        // Быстрый путь по ASCII: один переход по таблице на байт, лексема заканчивается на S_STOP
+        while (pos < asciiUntil)
         {
-            if (hasDot)
-                hasError = true;  // Уже была точка - ошибка
-            hasDot = true;
+            uint8_t next = LEX_TABLES.next[state][LEX_TABLES.charClass[(unsigned char)text[pos]]];
+            if (next == S_STOP)
+                return true;
+            state = next;
+            pos++;
         }
+        if (pos >= size)
+            break;
 
-        value += currentChar;
-        currentChar = getNextChar();
-    }
+        // Медленный путь: проверка многобайтового UTF-8 символа
+        size_t length = utf8SequenceLength(text + pos, size - pos);
+        if (length == 0 && !final && size - pos < 4)    // Символ может быть разрезан между частями текста
+            return false;
+        if (length == 0)
+        {
+            // Некорректная последовательность - отдельный токен ERROR из всех подряд идущих плохих байтов
+            if (pos == start)
+            {
+                while (pos < size && (unsigned char)text[pos] >= 0x80 &&
+                    utf8SequenceLength(text + pos, size - pos) == 0)
+                    pos++;
+                if (!final && size - pos < 4)   // Плохие байты могут продолжиться - разбираем заново
+                {
+                    pos = start;
+                    return false;
+                }
+                state = S_ERROR_WORD;
+            }
+            return true;
+        }
 
-    // Если есть ошибка
-    if (hasError || value.back() == '.')
-        return Token(TokenType::ERROR, value, startLine, startPos);
+        uint8_t next = LEX_TABLES.next[state][CC_UTF8];
+        if (next == S_STOP)
+            return true;
+        state = next;
+        pos += length;
+    }
+    return final;
+}
 
-    if (hasDot)
-        return Token(TokenType::DOUBLE_NUM, value, startLine, startPos);
-    else
-        return Token(TokenType::INT_NUM, value, startLine, startPos);
+static bool isWord(const char* value, size_t length, const char* word, size_t wordLength)
+{
+    return length == wordLength && memcmp(value, word, length) == 0;
 }
 
-Token Lexer::recognizeIdentifierOrKeyword()
+static TokenType lexemeType(const char* value, size_t length, uint8_t state)
 {
-    string value;
-    int startLine = currentLine;
-    int startPos = currentPos;
-    bool foundDigits = false;
-    bool hasError = false;
-
-    // Собираем первый символ
-    value += currentChar;
-    currentChar = getNextChar();
-
-    // Продолжаем собирать остальные символы идентификатора
-    while (hasMoreTokens() && (isalnum(currentChar) || currentChar == '_'))
+    TokenType type = LEX_TABLES.accept[state];
+    if (state == S_OPERATOR)
+        type = LEX_TABLES.operatorType[(unsigned char)value[0]];
+    else if (type == TokenType::ID)     // Проверяем, является ли идентификатор ключевым словом
     {
-        // Если нашли цифру - отмечаем, что началась цифровая часть
-        if (isdigit(currentChar))
-            foundDigits = true;
+        if (isWord(value, length, "return", 6)) type = TokenType::RETURN;
+        else if (isWord(value, length, "int", 3)) type = TokenType::INT;
+        else if (isWord(value, length, "double", 6)) type = TokenType::DOUBLE;
+        else if (isWord(value, length, "itod", 4)) type = TokenType::ITOD;
+        else if (isWord(value, length, "dtoi", 4)) type = TokenType::DTOI;
+        else if (isWord(value, length, "import", 6)) type = TokenType::IMPORT;
+    }
+    return type;
+}
 
-        // Если нашли букву после цифр - это ошибка
-        if (isalpha(currentChar) && foundDigits)
-            hasError = true;
+Token Lexer::scanToken()
+{
+    size_t start = sourcePos;
+    const char* text = source->getText().data();
+
+    uint8_t state = S_START;
+    scanLexeme(text, source->getText().size(), start, sourcePos, state, asciiUntil, true);
+
+    string value(text + start, sourcePos - start);
+    return Token(lexemeType(value.data(), value.size(), state), value, start, source);
+}
 
-        value += currentChar;
-        currentChar = getNextChar();
+Token Lexer::getNextToken()
+{
+    if (channel != nullptr)
+    {
+        // Таблица заполняется в потоке разбора - в порядке лексем, как при readAll
+        Token token = channel->pop();
+        if (token.getType() != TokenType::END_OF_FILE)
+            token.setSymbol(symbolTable->intern(token));
+        return token;
+    }
+    if (useMemoryMode) {
+        // Режим памяти - собираем токен из потока
+        if (memoryIndex < memoryEnd) {
+            return memoryTokens->tokenAt(memoryIndex++);
+        }
+        return memoryTokens->endAt(memoryEnd);
     }
 
-    // Если есть буквы после цифр - возвращаем ERROR
-    if (hasError)
-        return Token(TokenType::ERROR, value, startLine, startPos);
+    skipWhitespace();
+
+    if (!hasMoreTokens())
+        return Token(TokenType::END_OF_FILE, "", sourcePos, source);
 
-    // Проверяем, является ли идентификатор ключевым словом
-    if (value == "return") return Token(TokenType::RETURN, value, startLine, startPos);
-    if (value == "int") return Token(TokenType::INT, value, startLine, startPos);
-    if (value == "double") return Token(TokenType::DOUBLE, value, startLine, startPos);
-    if (value == "itod") return Token(TokenType::ITOD, value, startLine, startPos);
-    if (value == "dtoi") return Token(TokenType::DTOI, value, startLine, startPos);
+    Token token = scanToken();
+    token.setSymbol(symbolTable->intern(token));
 
-    return Token(TokenType::ID, value, startLine, startPos);
+    return token;
 }
 
-// Вспомогательная функция для проверки, является ли символ оператором или разделителем
-bool Lexer::isOperatorOrDelimiter(char ch) const
+Token Lexer::peekNextToken()
 {
-    return ch == '=' || ch == '+' || ch == '-' || ch == '*' || ch == '/' ||
-        ch == ',' || ch == ';' || ch == '(' || ch == ')' ||
-        ch == '{' || ch == '}' || ch == EOF;
+    if (channel != nullptr)
+        return channel->peek();
+    if (useMemoryMode) {
+        // Режим памяти
+        if (memoryIndex < memoryEnd) {
+            return memoryTokens->tokenAt(memoryIndex);
+        }
+        return memoryTokens->endAt(memoryEnd);
+    }
+    // Сохраняем текущее состояние
+    size_t oldPos = sourcePos;
+    size_t oldAsciiUntil = asciiUntil;
+
+    // Получаем следующий токен - без записи в таблицу, иначе он будет учтен дважды
+    skipWhitespace();
+    Token nextToken = hasMoreTokens() ? scanToken() : Token(TokenType::END_OF_FILE, "", sourcePos, source);
+
+    // Восстанавливаем состояние
+    sourcePos = oldPos;
+    asciiUntil = oldAsciiUntil;
+
+    return nextToken;
 }
 
-Token Lexer::recognizeErrorIdentifier()
+TokenType Lexer::peekNextType()
 {
-    string value;
-    int startLine = currentLine;
-    int startPos = currentPos;
-
-    // Собираем символы ошибочного идентификатора
-    value += currentChar; // первый символ
-    currentChar = getNextChar();
+    if (channel != nullptr)
+        return channel->peek().getType();
+    if (useMemoryMode)  // Читается только массив типов
+        return memoryIndex < memoryEnd ? memoryTokens->typeAt(memoryIndex) : TokenType::END_OF_FILE;
+    return peekNextToken().getType();
+}
 
-    // Продолжаем собирать, пока идут любые символы кроме пробелов и известных операторов
-    while (hasMoreTokens() && !isspace(currentChar) && !isOperatorOrDelimiter(currentChar))
+void Lexer::readAll(TokenStream& tokens)
+{
+    TRACE_SCOPE("Lexer");
+    while (true)
     {
-        value += currentChar;
-        currentChar = getNextChar();
+        skipWhitespace();
+        if (!hasMoreTokens())
+            break;
+
+        Token token = scanToken();
+        int symbol = symbolTable->intern(token);
+        tokens.append(token.getType(), token.getOffset(), token.getValue().size(), symbol);
     }
+}
 
-    return Token(TokenType::ERROR, value, startLine, startPos);
+StreamLexer::StreamLexer()
+    : scanPos(0), scanState(S_START), asciiUntil(0), line(1), column(1), bomChecked(false)
+{
 }
 
-Token Lexer::recognizeOperator()
+void StreamLexer::feed(const char* data, size_t size, vector<Token>& tokens)
 {
-    int startLine = currentLine;
-    int startPos = currentPos;
-    char ch = currentChar;
-    currentChar = getNextChar();
+    pending.append(data, size);
+    scan(false, tokens);
+}
+
+void StreamLexer::finish(vector<Token>& tokens)
+{
+    scan(true, tokens);
+}
 
-    switch (ch) // Определяем тип оператора по символу
+void StreamLexer::advance(const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; )
     {
-    case '=': return Token(TokenType::ASSIGN, "=", startLine, startPos);
-    case '+': return Token(TokenType::PLUS, "+", startLine, startPos);
-    case '-': return Token(TokenType::MINUS, "-", startLine, startPos);
-    case '*': return Token(TokenType::MULT, "*", startLine, startPos);
-    case '/': return Token(TokenType::DIV, "/", startLine, startPos);
-    case ',': return Token(TokenType::COMMA, ",", startLine, startPos);
-    case ';': return Token(TokenType::SEMICOLON, ";", startLine, startPos);
-    case '(': return Token(TokenType::LPAREN, "(", startLine, startPos);
-    case ')': return Token(TokenType::RPAREN, ")", startLine, startPos);
-    case '{': return Token(TokenType::LBRACE, "{", startLine, startPos);
-    case '}': return Token(TokenType::RBRACE, "}", startLine, startPos);
-    case EOF: return Token(TokenType::END_OF_FILE, "", startLine, startPos);
-    default:
-        return Token(TokenType::ERROR, std::string(1, ch), startLine, startPos); // Неизвестный символ - ошибка
+        if (data[i] == '\n')
+        {
+            line++;
+            column = 1;
+            i++;
+            continue;
+        }
+        // Многобайтовый символ - одна позиция; каждый байт некорректной последовательности - тоже одна
+        size_t length = utf8SequenceLength(data + i, size - i);
+        i += length != 0 ? length : 1;
+        column++;
     }
 }
 
-Token Lexer::getNextToken()
+void StreamLexer::scan(bool final, vector<Token>& tokens)
 {
-    if (useMemoryMode) {
-        // Режим памяти - берем токены из вектора
-        if (memoryIndex < memoryTokens.size()) {
-            return memoryTokens[memoryIndex++];
-        }
-        return Token(TokenType::END_OF_FILE, "", 0, 0);
+    static const char BOM[] = "\xEF\xBB\xBF";
+    if (!bomChecked)
+    {
+        if (!final && pending.size() < 3 && pending.compare(0, string::npos, BOM, pending.size()) == 0)
+            return;     // Пока неизвестно, метка ли это
+        if (pending.compare(0, 3, BOM) == 0)
+            pending.erase(0, 3);
+        bomChecked = true;
     }
 
-    skipWhitespace();
+    const char* text = pending.data();
+    size_t size = pending.size();
+    size_t start = 0;   // Начало незаконченной лексемы
+    while (true)
+    {
+        if (scanPos == start)   // Новая лексема: пропускаем пробелы и переводы строк
+        {
+            size_t spaces = start;
+            while (spaces < size)
+            {
+                uint8_t cls = LEX_TABLES.charClass[(unsigned char)text[spaces]];
+                if (cls != CC_SPACE && cls != CC_NEWLINE)
+                    break;
+                spaces++;
+            }
+            advance(text + start, spaces - start);
+            start = scanPos = spaces;
+            if (start >= size)
+                break;
+        }
+        if (!scanLexeme(text, size, start, scanPos, scanState, asciiUntil, final))
+            break;      // Продолжение лексемы - в следующей части текста
+
+        string value(text + start, scanPos - start);
+        tokens.push_back(Token(lexemeType(value.data(), value.size(), scanState), value, line, column));
+        advance(text + start, scanPos - start);
+        start = scanPos;
+        scanState = S_START;
+    }
 
-    if (!hasMoreTokens())
-        return Token(TokenType::END_OF_FILE, "", currentLine, currentPos);
+    // Прочитанное отбрасываем, смещения хвоста - от его начала
+    pending.erase(0, start);
+    scanPos -= start;
+    asciiUntil = scanPos;
+}
 
-    Token token;
+LexemeScanner::LexemeScanner(const char* source, size_t sourceSize)
+    : text(source), size(sourceSize), base(0), pos(0), asciiUntil(0), line(1), lineStart(0), keepFrom(UINT64_MAX),
+    window(nullptr), readFailed(false)
+{
+    if (size >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0)    // Метка порядка байтов UTF-8
+        pos = 3;
+    lineStart = pos;
+}
 
-    if (isdigit(currentChar))
-        token = recognizeNumber();              // Число
-    else if (isalpha(currentChar))
-        token = recognizeIdentifierOrKeyword(); // Идентификатор или ключевое слово
-    else if (currentChar == '_' || !isOperatorOrDelimiter(currentChar))
-        token = recognizeErrorIdentifier();     // Ошибочный идентификатор
-    else
-        token = recognizeOperator();            // Оператор или разделитель
+LexemeScanner::LexemeScanner(MappedWindow& file)
+    : text(nullptr), size(0), base(0), pos(0), asciiUntil(0), line(1), lineStart(0), keepFrom(UINT64_MAX),
+    window(&file), readFailed(false)
+{
+    if (!window->map(0, WINDOW_SIZE))
+        readFailed = true;
+    text = window->getData();
+    size = window->getSize();
+    if (size >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0)
+        pos = 3;
+    lineStart = pos;
+}
 
-    if (token.getType() != TokenType::END_OF_FILE)
-        hashTable->insert(token);
+bool LexemeScanner::atEnd() const
+{
+    return window == nullptr || readFailed || base + size >= window->getFileSize();
+}
 
-    return token;
+bool LexemeScanner::slide(uint64_t from)
+{
+    if (atEnd())
+        return false;
+
+    // Окно растет, если две последние лексемы в него не помещаются
+    uint64_t start = min(keepFrom, from);
+    size_t length = max(WINDOW_SIZE, (size_t)(base + size - start) * 2);
+    uint64_t position = base + pos;
+    if (!window->map(start, length))
+    {
+        readFailed = true;
+        size = 0;
+        return false;
+    }
+    text = window->getData();
+    size = window->getSize();
+    base = start;
+    pos = (size_t)(position - base);
+    asciiUntil = pos;
+    return true;
 }
 
-Token Lexer::peekNextToken()
+Lexeme LexemeScanner::next()
 {
-    if (useMemoryMode) {
-        // Режим памяти
-        if (memoryIndex < memoryTokens.size()) {
-            return memoryTokens[memoryIndex];
+    while (true)    // Пробелы и переводы строк, на краю окна - со сдвигом окна
+    {
+        while (pos < size)
+        {
+            uint8_t cls = LEX_TABLES.charClass[(unsigned char)text[pos]];
+            if (cls == CC_NEWLINE)
+            {
+                line++;
+                lineStart = base + pos + 1;
+            }
+            else if (cls != CC_SPACE)
+                break;
+            pos++;
         }
-        return Token(TokenType::END_OF_FILE, "", 0, 0);
+        if (pos < size || !slide(base + pos))
+            break;
     }
-    // Сохраняем текущее состояние
-    int oldLine = currentLine;
-    int oldPos = currentPos;
-    char oldCurrentChar = currentChar;
-    streampos oldFilePos = input.tellg();
-    // streampos - специальный тип данных в C++ для хранения позиции в потоке
-    // tellg() - "tell get position" - возвращает текущую позицию чтения в потоке
+    if (pos >= size)
+        return { TokenType::END_OF_FILE, base + pos, 0, line, lineStart };
+
+    while (true)
+    {
+        size_t start = pos;
+        uint8_t state = S_START;
+        if (scanLexeme(text, size, start, pos, state, asciiUntil, atEnd()))
+        {
+            keepFrom = base + start;
+            return { lexemeType(text + start, pos - start, state), base + start, pos - start, line, lineStart };
+        }
+        // Лексема дошла до края окна - разбираем ее заново с начала в сдвинутом окне
+        uint64_t lexemeStart = base + start;
+        pos = start;
+        if (!slide(lexemeStart))
+            return { TokenType::END_OF_FILE, base + pos, 0, line, lineStart };
+    }
+}
 
-    // Получаем следующий токен
-    Token nextToken = getNextToken();
+string_view LexemeScanner::textOf(const Lexeme& lexeme) const
+{
+    return string_view(text + (size_t)(lexeme.offset - base), lexeme.length);
+}
 
-    // Восстанавливаем состояние
-    currentLine = oldLine;
-    currentPos = oldPos;
-    currentChar = oldCurrentChar;
-    input.seekg(oldFilePos);
-    // seekg() - "seek get position" - перемещает указатель чтения на заданную позицию
+int64_t LexemeScanner::columnOf(const Lexeme& lexeme)
+{
+    // Многобайтовый символ - одна позиция; каждый байт некорректной последовательности - тоже одна
+    uint64_t savedBase = base;
+    size_t savedSize = size;
+    int64_t column = 1;
+    uint64_t from = lexeme.lineStart;
+    while (from < lexeme.offset)
+    {
+        if (from < base || from >= base + size || (from + 4 > base + size && !atEnd()))
+        {
+            // Начало строки вне окна (только для файла) - окно переносится на него
+            if (window == nullptr || !window->map(from, WINDOW_SIZE))
+                break;
+            text = window->getData();
+            base = from;
+            size = window->getSize();
+        }
+        size_t i = (size_t)(from - base);
+        size_t end = (size_t)min<uint64_t>(lexeme.offset - base, size);
+        while (i < end && (i + 4 <= size || atEnd()))
+        {
+            size_t length = utf8SequenceLength(text + i, size - i);
+            i += length != 0 ? length : 1;
+            column++;
+        }
+        from = base + i;
+    }
 
-    return nextToken;
-}
\ No newline at end of file
+    if (window != nullptr && base != savedBase)    // Возвращаем окно, в котором идет просмотр
+    {
+        if (window->map(savedBase, savedSize))
+            text = window->getData();
+        else
+            readFailed = true;
+        base = savedBase;
+        size = savedSize;
+    }
+    return column;
+}
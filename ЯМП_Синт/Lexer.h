@@ -2,38 +2,116 @@
 #define LEXER_H
 
 #include "Token.h"
-#include "HashTable.h"
+#include "SymbolTable.h"
+#include "SourceMap.h"
+#include "TokenStream.h"
+#include "TokenChannel.h"
 #include <vector>
+#include <string_view>
+
+class MappedWindow;
 
 class Lexer
 {
 private:
-    ifstream input;
-    int currentLine;    //   
-    int currentPos;     //    
-    char currentChar;   //   
-    HashTable* hashTable;       //   -   
+    const SourceMap* source;    //   (   - nullptr)
+    size_t sourcePos;   //     
+    size_t asciiUntil;  //  [sourcePos, asciiUntil)  ASCII
+    SymbolTable* symbolTable;   //  ,    
 
-    vector<Token> memoryTokens;
+    const TokenStream* memoryTokens;    //     
     size_t memoryIndex;
+    size_t memoryEnd;           //    
     bool useMemoryMode;
+    TokenChannel* channel;      //   ,   ( nullptr)
 
     void skipWhitespace();      //   
-    char getNextChar();         //   
-    Token recognizeNumber();    //  
-    Token recognizeIdentifierOrKeyword();   //     
-    Token recognizeOperator();  //  
-    Token recognizeErrorIdentifier(); //  
-    bool isOperatorOrDelimiter(char c) const;
+    Token scanToken();          //       
 
 public:
-    Lexer(const string& filename, HashTable* ht);
-    Lexer(const vector<Token>& tokens, HashTable* ht);
+    Lexer(const SourceMap& src, SymbolTable* table);
+    Lexer(const TokenStream& tokens, SymbolTable* table);
+    Lexer(const TokenStream& tokens, SymbolTable* table, size_t begin, size_t end);    //   [begin, end)
+    Lexer(TokenChannel& tokens, SymbolTable* table);    //    -   
     ~Lexer();
 
     Token getNextToken();       //   -   
     Token peekNextToken();      //     
+    TokenType peekNextType();   //     -    
+    void readAll(TokenStream& tokens);  //       (  )
     bool hasMoreTokens() const; //    
+
+    const TokenStream* getTokenStream() const { return memoryTokens; }  //   ,  nullptr
+    size_t getTokenIndex() const { return memoryIndex; }    //    
+    void seek(size_t index) { memoryIndex = index; }        //    
+};
+
+struct Lexeme               //    :     
+{
+    TokenType type;
+    uint64_t offset;
+    size_t length;
+    int64_t line;
+    uint64_t lineStart;     //     -    
+};
+
+//        -   ,   Lexer,
+//   ,     .      .
+//  -    ,      :
+//        ,    ,
+//       WINDOW_SIZE   (   ).
+class LexemeScanner
+{
+private:
+    const char* text;       //   :  [base, base + size)
+    size_t size;
+    uint64_t base;
+    size_t pos;
+    size_t asciiUntil;
+    int64_t line;
+    uint64_t lineStart;
+    uint64_t keepFrom;      //     -     
+    MappedWindow* window;   //     - nullptr
+    bool readFailed;
+
+    bool atEnd() const;                 //      
+    bool slide(uint64_t from);          //   min(keepFrom, from)   
+
+public:
+    static constexpr size_t WINDOW_SIZE = 16 * 1024 * 1024;
+
+    LexemeScanner(const char* source, size_t sourceSize);  //      
+    explicit LexemeScanner(MappedWindow& file);
+
+    Lexeme next();          //    - END_OF_FILE
+    string_view textOf(const Lexeme& lexeme) const;    //      
+    int64_t columnOf(const Lexeme& lexeme);     //      UTF-8 ( 1)
+    bool failed() const { return readFailed; }  //    -  
+};
+
+//  ,   (push-).   
+// :      ,    .
+//        ,     SourceMap.
+class StreamLexer
+{
+private:
+    string pending;     //   
+    size_t scanPos;     //   pending    
+    uint8_t scanState;  //    scanPos
+    size_t asciiUntil;
+    int64_t line;       //   pending
+    int64_t column;
+    bool bomChecked;    //        
+
+    void scan(bool final, vector<Token>& tokens);
+    void advance(const char* data, size_t size);    //  line  column   
+
+public:
+    StreamLexer();
+
+    void feed(const char* data, size_t size, vector<Token>& tokens);   //    tokens
+    void finish(vector<Token>& tokens);                                 //  :  
+    Token endOfText() const { return Token(TokenType::END_OF_FILE, "", line, column); }    //  finish
 };
 
 #endif
\ No newline at end of file
@@ -1,47 +1,394 @@
-#include "Lexer.h"
-#include "HashTable.h"
-#include "Parser.h"
+#include "Compiler.h"
+#include "BuildScheduler.h"
+#include "SourceMap.h"
+#include "ResultCache.h"
+#include "AsmEmitter.h"
+#include "BatchEvaluator.h"
+#include "Bytecode.h"
+#include "Validator.h"
+#include "MappedFile.h"
+#include "Trace.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <locale>
+#include <filesystem>
+#include <thread>
 
 using namespace std;
 
+//        -     
+string importsKey(const string& source, const vector<string>& modulePath)
+{
+    string key;
+    for (const string& module : scanImports(source))
+    {
+        string content = "<>";
+        for (const string& directory : modulePath)
+            if (SourceMap::readFile((filesystem::path(directory) / InterfaceLibrary::fileName(module)).string(), content))
+                break;
+        key += " import=" + module + ":" + to_string(ResultCache::hashContent(content));
+    }
+    return key;
+}
+
+//  :    -    ,
+//        
+bool runBatch(const IrFunction& program, const string& inputFile, const string& outputFile, string& error)
+{
+    BatchEvaluator evaluator(program);
+    size_t paramCount = evaluator.parameterCount();
+
+    ifstream input(inputFile);
+    if (!input.is_open())
+    {
+        error = "    " + inputFile;
+        return false;
+    }
+    input.imbue(locale::classic());
+
+    vector<vector<int32_t>> intColumns(paramCount);     //   ,
+    vector<vector<double>> doubleColumns(paramCount);   //    
+    size_t rows = 0;
+    string line;
+    while (getline(input, line))
+    {
+        if (line.find_first_not_of(" \t\r") == string::npos)
+            continue;
+        istringstream values(line);
+        values.imbue(locale::classic());
+        for (size_t p = 0; p < paramCount; p++)
+        {
+            bool ok;
+            if (evaluator.parameterType(p) == ValueType::INT)
+            {
+                int32_t value;
+                ok = (bool)(values >> value);
+                intColumns[p].push_back(value);
+            }
+            else
+            {
+                double value;
+                ok = (bool)(values >> value);
+                doubleColumns[p].push_back(value);
+            }
+            if (!ok)
+            {
+                error = " " + to_string(rows + 1) + ":  : " + to_string(paramCount);
+                return false;
+            }
+        }
+        if (!(values >> ws).eof())
+        {
+            error = " " + to_string(rows + 1) + ":  ,  : " + to_string(paramCount);
+            return false;
+        }
+        rows++;
+    }
+
+    vector<BatchColumn> columns;
+    for (size_t p = 0; p < paramCount; p++)
+        columns.push_back({ evaluator.parameterType(p),
+            evaluator.parameterType(p) == ValueType::INT ? (const void*)intColumns[p].data() : (const void*)doubleColumns[p].data() });
+
+    bool isInt = evaluator.getResultType() == ValueType::INT;
+    vector<int32_t> intResults(isInt ? rows : 0);
+    vector<double> doubleResults(isInt ? 0 : rows);
+    if (!evaluator.evaluate(columns, rows, isInt ? (void*)intResults.data() : (void*)doubleResults.data(), error))
+        return false;
+
+    ofstream output(outputFile);
+    output.imbue(locale::classic());
+    output.precision(17);   //      
+    for (size_t r = 0; r < rows; r++)
+    {
+        if (isInt)
+            output << intResults[r] << "\n";
+        else
+            output << doubleResults[r] << "\n";
+    }
+    return true;
+}
+
+// Push-:      chunkSize ,    
+bool streamFile(const string& inputFile, size_t chunkSize, const string& treeFormat, InterfaceLibrary* interfaces,
+    bool needIr, const ResourceLimits& limits, CompileResult& result)
+{
+    StreamCompiler compiler(treeFormat, interfaces, needIr, limits);
+    ifstream input(inputFile, ios::binary);
+    bool opened = input.is_open();
+    vector<char> chunk(chunkSize);
+    while (input)
+    {
+        input.read(chunk.data(), chunk.size());
+        compiler.feed(chunk.data(), (size_t)input.gcount());
+    }
+    compiler.finish(result);
+    return opened;
+}
+
+//   -:       
+bool runBytecode(const string& bytecodeFile, const vector<string>& values, string& error)
+{
+    BytecodeFile bytecode;
+    {
+        TRACE_SCOPE("load");
+        if (!bytecode.open(bytecodeFile, error))
+            return false;
+    }
+    if (values.size() != bytecode.parameterCount())
+    {
+        error = " : " + to_string(bytecode.parameterCount());
+        return false;
+    }
+
+    vector<Constant> arguments;
+    for (size_t p = 0; p < values.size(); p++)
+    {
+        istringstream value(values[p]);
+        value.imbue(locale::classic());
+        Constant argument = { bytecode.parameterType(p), 0, 0.0 };
+        bool ok = argument.type == ValueType::INT ? (bool)(value >> argument.intValue) : (bool)(value >> argument.doubleValue);
+        if (!ok || !(value >> ws).eof())
+        {
+            error = " " + to_string(p + 1) + "    ";
+            return false;
+        }
+        arguments.push_back(argument);
+    }
+
+    Constant result;
+    {
+        TRACE_SCOPE("execute");
+        if (!bytecode.execute(arguments, result, error))
+            return false;
+    }
+    ostringstream text;
+    text.imbue(locale::classic());
+    text.precision(17);
+    if (result.type == ValueType::INT)
+        text << result.intValue;
+    else
+        text << result.doubleValue;
+    cout << bytecode.getName() << " = " << text.str() << endl;
+    return true;
+}
+
+void writeTrace(const string& traceFile)
+{
+    if (traceFile.empty())
+        return;
+    string error;
+    if (Trace::write(traceFile, error))
+        cout << ": " << traceFile << endl;
+    else
+        cout << "  : " << error << endl;
+}
+
 int main(int argc, char* argv[])
 {
     setlocale(LC_ALL, "Russian");
     string inputFile = "input.txt";
     string outputFile = "output.txt";
+    string cacheDir = ".analyzer_cache";
+    string treeFormat = "text";     //   : text, json  none
+    string asmFile;                 //   x86-64 (--emit-asm)
+    string asmSymbol;               //     ,   -   
+    string batchInput, batchOutput; //    (--batch)
+    string bytecodeFile;            //  -   (--emit-bytecode)
+    string execFile;                //  -    (--exec)
+    vector<string> execValues;      //    --exec
+    string buildDirectory;          //    (--build)
+    vector<string> modulePath;      //     import (--module-path)
+    unsigned jobs = thread::hardware_concurrency();
+    string traceFile;               //     Chrome trace (--trace)
+    size_t streamChunk = 0;         //     push- (--stream), 0 -   
+    bool checkOnly = false;         //   ,   (--check)
+    bool useCache = true;
+    ResourceLimits limits;          //   (--limit-*),    
 
-    ofstream output(outputFile);
-    HashTable hashTable;
-    HashTable declaredVarsTable;
+    for (int i = 1; i < argc; ++i)  //    
+    {
+        string arg = argv[i];
+        if (arg == "--no-cache")
+            useCache = false;
+        else if (arg == "--cache-dir" && i + 1 < argc)
+            cacheDir = argv[++i];
+        else if (arg == "--tree" && i + 1 < argc)
+            treeFormat = argv[++i];
+        else if (arg == "--emit-asm" && i + 1 < argc)
+            asmFile = argv[++i];
+        else if (arg == "--asm-symbol" && i + 1 < argc)
+            asmSymbol = argv[++i];
+        else if (arg == "--batch" && i + 2 < argc)
+        {
+            batchInput = argv[++i];
+            batchOutput = argv[++i];
+        }
+        else if (arg == "--build" && i + 1 < argc)
+            buildDirectory = argv[++i];
+        else if (arg == "--module-path" && i + 1 < argc)
+            modulePath.push_back(argv[++i]);
+        else if (arg == "--jobs" && i + 1 < argc)
+            jobs = (unsigned)atoi(argv[++i]);
+        else if (arg == "--trace" && i + 1 < argc)
+            traceFile = argv[++i];
+        else if (arg == "--stream" && i + 1 < argc)
+            streamChunk = (size_t)atoll(argv[++i]);
+        else if (arg == "--check")
+            checkOnly = true;
+        else if (arg == "--limit-time" && i + 1 < argc)
+            limits.seconds = atof(argv[++i]);
+        else if (arg == "--limit-tokens" && i + 1 < argc)
+            limits.tokens = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--limit-depth" && i + 1 < argc)
+            limits.depth = (unsigned)atoi(argv[++i]);
+        else if (arg == "--limit-symbols" && i + 1 < argc)
+            limits.symbols = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--limit-memory" && i + 1 < argc)
+            limits.bytes = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--emit-bytecode" && i + 1 < argc)
+            bytecodeFile = argv[++i];
+        else if (arg == "--exec" && i + 1 < argc)   //   -  
+        {
+            execFile = argv[++i];
+            execValues.assign(argv + i + 1, argv + argc);
+            break;
+        }
+    }
+    if (!traceFile.empty())
+        Trace::enable();
+
+    if (treeFormat != "text" && treeFormat != "json" && treeFormat != "none")
+    {
+        cout << ":    " << treeFormat << ",  text" << endl;
+        treeFormat = "text";
+    }
+
+    if (!execFile.empty())
+    {
+        string execError;
+        bool executed = runBytecode(execFile, execValues, execError);
+        if (!executed)
+            cout << "-  : " << execError << endl;
+        writeTrace(traceFile);
+        return executed ? 0 : 1;
+    }
+
+    if (!buildDirectory.empty())    //       
+    {
+        BuildScheduler scheduler(buildDirectory, modulePath, treeFormat, !asmFile.empty(), jobs);
+        bool built = scheduler.run(cout);
+        cout << " : " << (built ? "" : "") << endl;
+        writeTrace(traceFile);
+        return built ? 0 : 1;
+    }
+
+    //   import     ,   --module-path
+    string inputDirectory = filesystem::path(inputFile).parent_path().string();
+    modulePath.insert(modulePath.begin(), inputDirectory.empty() ? "." : inputDirectory);
 
-    //        
-    vector<Token> allTokens;
+    TraceFile traceInput(inputFile);
+
+    if (checkOnly)  //     :  output.txt  
     {
-        Lexer fileLexer(inputFile, &hashTable);
-        while (fileLexer.hasMoreTokens())
+        MappedWindow file;  //     
+        if (!file.open(inputFile))
         {
-            Token token = fileLexer.getNextToken();
-            if (token.getType() == TokenType::END_OF_FILE)
-                break;
-            allTokens.push_back(token);
+            cout << ":     " << inputFile << endl;
+            return 1;
         }
+        InterfaceLibrary interfaces(modulePath);
+        Validator validator(&interfaces);
+        ResourceBudget budget(limits);
+        if (limits.any())
+            validator.setBudget(&budget);
+        string checkError;
+        bool valid = validator.validate(file, checkError);
+        cout << ": " << (valid ? " " : checkError) << endl;
+        writeTrace(traceFile);
+        return valid ? 0 : 1;
     }
 
-    //  -
-    hashTable.printToFile(output);
-    output << "\n";
+    //    -   
+    //  push-     -  ,   
+    string source;
+    bool sourceRead = streamChunk != 0 || SourceMap::readFile(inputFile, source);
+    if (!sourceRead)
+        cout << ":     " << inputFile << endl;
+
+    bool needIr = !asmFile.empty() || !batchInput.empty() || !bytecodeFile.empty();
+    if (needIr || streamChunk != 0)     //     -      
+        useCache = false;
+    if (limits.any())   //       -    
+        useCache = false;
+
+    ResultCache cache(useCache && sourceRead ? cacheDir : "");
+    useCache = useCache && sourceRead && cache.isEnabled();
+    string cacheOptions = useCache ? "tree=" + treeFormat + importsKey(source, modulePath) : string();
+    uint64_t cacheKey = useCache ? ResultCache::makeKey(source, cacheOptions) : 0;
+
+    CachedResult result;
+    CompileResult compiled;
+    IrFunction& program = compiled.program;
+    string& irError = compiled.irError;
+    if (!useCache || !cache.lookup(cacheKey, source, cacheOptions, result))   //  -   
+    {
+        InterfaceLibrary interfaces(modulePath);
+        if (streamChunk == 0)
+            compileSource(source, treeFormat, &interfaces, needIr, compiled, max(1u, jobs), StringInterner::global(), limits);
+        else if (!streamFile(inputFile, streamChunk, treeFormat, &interfaces, needIr, limits, compiled))
+            cout << ":     " << inputFile << endl;
+        result.syntaxCorrect = compiled.syntaxCorrect;
+        result.output = compiled.report;
 
-    //      
-    Lexer memoryLexer(allTokens, &hashTable);
-    Parser parser(memoryLexer, output, &declaredVarsTable);
-    bool syntaxCorrect = parser.parse();
+        if (useCache)
+            cache.store(cacheKey, source, cacheOptions, result);
+    }
 
-    output.close();
+    {
+        TRACE_SCOPE("output");
+        ofstream output(outputFile);
+        output << result.output;
+    }
 
     cout << " .  : " << outputFile << endl;
-    cout << " : " << (syntaxCorrect ? "" : "") << endl;
+    cout << " : " << (result.syntaxCorrect ? "" : "") << endl;
+
+    if (!asmFile.empty())   //   
+    {
+        ostringstream assembly;
+        string asmError = irError;
+        if (asmError.empty())
+            AsmEmitter(program).emit(asmSymbol.empty() ? program.name : asmSymbol, assembly, asmError);
+        if (asmError.empty())
+        {
+            ofstream asmOutput(asmFile, ios::binary);
+            asmOutput << assembly.str();
+            cout << " x86-64: " << asmFile << endl;
+        }
+        else
+            cout << "  : " << asmError << endl;
+    }
+
+    if (!bytecodeFile.empty())
+    {
+        string bytecodeError = irError;
+        if (bytecodeError.empty() && BytecodeFile::write(bytecodeFile, program, bytecodeError))
+            cout << "-: " << bytecodeFile << endl;
+        else
+            cout << "-  : " << bytecodeError << endl;
+    }
+
+    if (!batchInput.empty())
+    {
+        string batchError = irError;
+        if (batchError.empty() && runBatch(program, batchInput, batchOutput, batchError))
+            cout << " : " << batchOutput << endl;
+        else
+            cout << "   : " << batchError << endl;
+    }
 
+    writeTrace(traceFile);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,261 @@
+﻿#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : data(nullptr), size(0)
+#ifdef _WIN32
+    , fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedWindow::~MappedWindow()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const string& path)
+{
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)  // Пустой файл отобразить нельзя
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const char*)view;
+    size = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+    if (fileHandle != nullptr)
+        CloseHandle(fileHandle);
+    data = nullptr;
+    size = 0;
+    fileHandle = mappingHandle = nullptr;
+}
+
+MappedWindow::MappedWindow()
+    : data(nullptr), size(0), offset(0), view(nullptr), viewSize(0), fileSize(0),
+    fileHandle(nullptr), mappingHandle(nullptr)
+{
+}
+
+bool MappedWindow::open(const string& path)
+{
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = nullptr;
+    if (length.QuadPart != 0)   // Пустой файл отобразить нельзя - окно у него всегда пустое
+    {
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            CloseHandle(file);
+            return false;
+        }
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    fileSize = (uint64_t)length.QuadPart;
+    return true;
+}
+
+bool MappedWindow::map(uint64_t from, size_t length)
+{
+    unmap();
+    if (from >= fileSize)
+        return from == fileSize;
+    if (length > fileSize - from)
+        length = (size_t)(fileSize - from);
+
+    SYSTEM_INFO system;
+    GetSystemInfo(&system);
+    uint64_t start = from - from % system.dwAllocationGranularity;  // Начало отображения выровнено
+    size_t mapped = (size_t)(from - start) + length;
+    void* mappedView = MapViewOfFile(mappingHandle, FILE_MAP_READ, (DWORD)(start >> 32), (DWORD)start, mapped);
+    if (mappedView == nullptr)
+        return false;
+
+    view = mappedView;
+    viewSize = mapped;
+    data = (const char*)view + (from - start);
+    size = length;
+    offset = from;
+    return true;
+}
+
+void MappedWindow::unmap()
+{
+    if (view != nullptr)
+        UnmapViewOfFile(view);
+    view = nullptr;
+    viewSize = 0;
+    data = nullptr;
+    size = 0;
+}
+
+void MappedWindow::close()
+{
+    unmap();
+    if (mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+    if (fileHandle != nullptr)
+        CloseHandle(fileHandle);
+    fileHandle = mappingHandle = nullptr;
+    offset = fileSize = 0;
+}
+
+#else
+
+bool MappedFile::open(const string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)     // Пустой файл отобразить нельзя
+    {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // Отображение остается действительным и без дескриптора
+    if (view == MAP_FAILED)
+        return false;
+
+    data = (const char*)view;
+    size = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data != nullptr)
+        munmap((void*)data, size);
+    data = nullptr;
+    size = 0;
+}
+
+MappedWindow::MappedWindow()
+    : data(nullptr), size(0), offset(0), view(nullptr), viewSize(0), fileSize(0), descriptor(-1)
+{
+}
+
+bool MappedWindow::open(const string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    descriptor = fd;
+    fileSize = (uint64_t)info.st_size;
+    return true;
+}
+
+bool MappedWindow::map(uint64_t from, size_t length)
+{
+    unmap();
+    if (from >= fileSize)
+        return from == fileSize;
+    if (length > fileSize - from)
+        length = (size_t)(fileSize - from);
+
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = from - from % page;    // Смещение отображения кратно размеру страницы
+    size_t mapped = (size_t)(from - start) + length;
+    void* mappedView = mmap(nullptr, mapped, PROT_READ, MAP_PRIVATE, descriptor, (off_t)start);
+    if (mappedView == MAP_FAILED)
+        return false;
+    madvise(mappedView, mapped, MADV_SEQUENTIAL);   // Окно читается подряд - система читает вперед
+
+    view = mappedView;
+    viewSize = mapped;
+    data = (const char*)view + (from - start);
+    size = length;
+    offset = from;
+    return true;
+}
+
+void MappedWindow::unmap()
+{
+    if (view != nullptr)
+        munmap(view, viewSize);
+    view = nullptr;
+    viewSize = 0;
+    data = nullptr;
+    size = 0;
+}
+
+void MappedWindow::close()
+{
+    unmap();
+    if (descriptor >= 0)
+        ::close(descriptor);
+    descriptor = -1;
+    offset = fileSize = 0;
+}
+
+#endif
@@ -0,0 +1,73 @@
+﻿#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Файл, отображенный в память только для чтения (mmap / MapViewOfFile).
+// Содержимое не копируется: страницы подгружаются системой при первом обращении.
+class MappedFile
+{
+private:
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;       // HANDLE файла
+    void* mappingHandle;    // HANDLE отображения
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& path);      // false - файл не найден или не отображается
+    void close();
+
+    const char* getData() const { return data; }
+    size_t getSize() const { return size; }
+    bool isOpen() const { return data != nullptr; }
+};
+
+// Скользящее окно по файлу любого размера: отображена только часть [offset, offset + size),
+// поэтому в памяти процесса файл занимает не больше окна. Смещения 64-битные
+// и в 32-битной сборке, где файл больше 4 ГБ целиком не отображается.
+class MappedWindow
+{
+private:
+    const char* data;       // Начало запрошенной части
+    size_t size;
+    uint64_t offset;
+    void* view;             // Отображение начинается с границы страницы, до offset
+    size_t viewSize;
+    uint64_t fileSize;
+#ifdef _WIN32
+    void* fileHandle;       // HANDLE файла
+    void* mappingHandle;    // HANDLE отображения, у пустого файла - nullptr
+#else
+    int descriptor;
+#endif
+
+    void unmap();
+
+public:
+    MappedWindow();
+    ~MappedWindow();
+    MappedWindow(const MappedWindow&) = delete;
+    MappedWindow& operator=(const MappedWindow&) = delete;
+
+    bool open(const string& path);      // Окно пока пустое; пустой файл тоже открывается
+    void close();
+    bool map(uint64_t from, size_t length); // Окно на [from, from + length), по концу файла обрезается
+
+    const char* getData() const { return data; }
+    size_t getSize() const { return size; }
+    uint64_t getOffset() const { return offset; }
+    uint64_t getFileSize() const { return fileSize; }
+};
+
+#endif
@@ -1,25 +1,51 @@
 ﻿#include "Parser.h"
+#include "Trace.h"
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <type_traits>
 
-Parser::Parser(Lexer& l, ofstream& out, HashTable* varsTable)
+// Меньше операторов на поток - выигрыш меньше затрат на запуск потока и слияние
+static const size_t PARALLEL_STATEMENTS_PER_TASK = 4096;
+
+template <class TreeOutput>
+BasicParser<TreeOutput>::BasicParser(Lexer& l, ostream& out, SymbolTable* table, InterfaceLibrary* library)
     : lexer(l),
     output(out),
-    declaredVariables(varsTable),
-    lastValidToken(TokenType::END_OF_FILE, "", 1, 1), 
-    currentToken(TokenType::END_OF_FILE, "", 1, 1),  
-    lastProcessedToken(TokenType::END_OF_FILE, "", 1, 1) 
+    tree(out),
+    currentToken(TokenType::END_OF_FILE, "", 1, 1),
+    lastProcessedToken(TokenType::END_OF_FILE, "", 1, 1),
+    lastValidToken(TokenType::END_OF_FILE, "", 1, 1),
+    symbols(table),
+    interfaces(library),
+    blockDepth(0),
+    parseThreads(1),
+    parallelScanEnd(0),
+    deferChecks(true),
+    dataflowLog(nullptr),
+    budget(nullptr),
+    nesting(0),
+    stack(),
+    steps(0),
+    aborted(false)
 {
+    currentTypes.reset(&currentExpression);
     advance();
 }
 
-void Parser::advance()  // Переход к следующему токену
+template <class TreeOutput>
+void BasicParser<TreeOutput>::advance()  // Переход к следующему токену
 {
     if (currentToken.getType() != TokenType::END_OF_FILE)
         lastValidToken = currentToken;  // Сохраняем текущий токен как последний валидный, если он не END_OF_FILE
     currentToken = lexer.getNextToken();
+    if (budget != nullptr && (++steps & (ResourceBudget::CHECK_INTERVAL - 1)) == 0)
+        budget->checkTime();
 }
 
-bool Parser::match(TokenType expectedType, const string& errorMsg)  // Проверка соответствия текущего токена ожидаемому типу
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::match(TokenType expectedType, const string& errorMsg)  // Проверка соответствия текущего токена ожидаемому типу
 {
     if (currentToken.getType() == expectedType)
     {
@@ -33,30 +59,47 @@ bool Parser::match(TokenType expectedType, const string& errorMsg)  // Пров
     }
 }
 
-void Parser::error(const string& message)   // Добавление ошибки в список ошибок
+template <class TreeOutput>
+void BasicParser<TreeOutput>::error(const string& message)   // Добавление ошибки в список ошибок
 {
     string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
         to_string(currentToken.getPosition()) + ": " + message;
     errors.push_back(errorMsg);
 }
 
-bool Parser::parse()
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::parse()
 {
     try
     {
         clearDeclaredVariables();
+        semantic.clear();
         postfixCode.clear();
+        declarationEnds.clear();
         currentFunctionType.clear();
         currentFunctionName.clear();
-
-        output << "=== ДЕРЕВО РАЗБОРА ===" << endl;
+        parameterTypes.clear();
+        importedModules.clear();
+        importedFunctions.clear();
+        dataflow.clear();
+        parallelScanEnd = 0;
+        stack = StackLimit();   // Разбор может идти не в том потоке, где создан анализатор
+
+        tree.header();
         function(); // Начинаем разбор с функции
+        tree.finish();
+        runSemanticChecks();
 
         generatePostfix();  // Генерация и вывод постфиксной записи
 
         if (currentToken.getType() != TokenType::END_OF_FILE && errors.empty()) // Проверяем, что достигнут конец файла и нет ошибок
             error("ожидался конец файла");
     }
+    catch (const BudgetExceeded& exceeded)  // Разбор прерван - ошибка в месте, где он остановился
+    {
+        error(exceeded.what());
+        aborted = true;
+    }
     catch (...)
     {
         error("критическая ошибка во время разбора");
@@ -69,6 +112,19 @@ bool Parser::parse()
             output << err << endl;
     }
 
+    // Предупреждения не влияют на результат; после ошибок разбор восстанавливался - их не выводим
+    warnings.clear();
+    if (errors.empty())
+    {
+        warnings = dataflow.finish();
+        if (!warnings.empty())
+        {
+            output << endl << "=== ПРЕДУПРЕЖДЕНИЯ ===" << endl;
+            for (const auto& warning : warnings)
+                output << warning << endl;
+        }
+    }
+
     output << endl << "=== РЕЗУЛЬТАТ АНАЛИЗА ===" << endl;
     if (errors.empty())
         output << "Программа корректна!" << endl;
@@ -78,31 +134,46 @@ bool Parser::parse()
     return errors.empty();
 }
 
-// Function → Begin Descriptions Operators End
-void Parser::function()
+// Function → Imports Begin Descriptions Operators End
+template <class TreeOutput>
+void BasicParser<TreeOutput>::function()
 {
-    output << "Function" << endl;
+    TRACE_SCOPE("Parser::function");
+    tree << "Function" << endl;
+
+    // Imports → Import Imports | ε
+    if (predict(NonTerminal::IMPORTS, currentToken.getType()) == Production::IMPORTS_LIST)
+    {
+        tree << "  Imports" << endl;
+        imports();
+    }
 
     // Begin → Type FunctionName() {
-    output << "  Begin" << endl;
+    tree << "  Begin" << endl;
     if (!begin())
         return;
 
     // Descriptions → Descr | Descr Descriptions
-    output << "  Descriptions" << endl;
-    descriptions();
+    tree << "  Descriptions" << endl;
+    {
+        TRACE_SCOPE("descriptions");
+        descriptions();
+    }
 
     // Operators → Op | Op Operators
-    output << "  Operators" << endl;
-    operators();
+    tree << "  Operators" << endl;
+    {
+        TRACE_SCOPE("operators");
+        operators();
+    }
 
     if (currentToken.getType() == TokenType::RBRACE)    // Если есть закрывающая скобка, но нет return - это ошибка
     {
-        output << "  End" << endl;
-        output << "    return <отсутствует>" << endl;
-        output << "    Id: <отсутствует>" << endl;
-        output << "    ; <отсутствует>" << endl;
-        output << "    }" << endl;
+        tree << "  End" << endl;
+        tree << "    return <отсутствует>" << endl;
+        tree << "    Id: <отсутствует>" << endl;
+        tree << "    ; <отсутствует>" << endl;
+        tree << "    }" << endl;
         
         string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
             to_string(currentToken.getPosition()) + ": ожидался return";
@@ -113,137 +184,256 @@ void Parser::function()
     else
     {
         // End → return Id ; }
-        output << "  End" << endl;
+        tree << "  End" << endl;
         end();
     }
 }
 
-// Begin → Type FunctionName() {
-bool Parser::begin()
+template <class TreeOutput>
+void BasicParser<TreeOutput>::imports()
+{
+    while (predict(NonTerminal::IMPORTS, currentToken.getType()) == Production::IMPORTS_LIST)
+        importModule();
+}
+
+// Import → import Id ;
+// Функции модуля берутся из его интерфейса (.ifc), текст модуля не разбирается
+template <class TreeOutput>
+void BasicParser<TreeOutput>::importModule()
+{
+    tree << "    Import" << endl;
+    tree << "      import" << endl;
+    advance();  // пропускаем import
+
+    tree << "      Id: ";
+    if (currentToken.getType() != TokenType::ID)
+    {
+        tree << "<ожидается имя модуля>" << endl;
+        error("ожидалось имя модуля");
+        if (currentToken.getType() == TokenType::SEMICOLON)
+            advance();
+        return;
+    }
+
+    string module = currentToken.getValue();
+    if (find(importedModules.begin(), importedModules.end(), module) != importedModules.end())
+        tree << module << " <повторный импорт>" << endl;
+    else
+    {
+        tree << module << endl;
+        importedModules.push_back(module);
+        string loadError = "импорт модулей недоступен";
+        const InterfaceFile* ifc = interfaces != nullptr ? interfaces->load(module, loadError) : nullptr;
+        if (ifc == nullptr)
+            error(loadError);
+        for (size_t i = 0; ifc != nullptr && i < ifc->functionCount(); i++)
+        {
+            FunctionSignature signature;
+            if (!ifc->function(i, signature))
+            {
+                error("интерфейс модуля '" + module + "' поврежден");
+                break;
+            }
+            if (!importedFunctions.emplace(signature.name, signature).second)
+                error("функция '" + signature.name + "' импортирована из нескольких модулей");
+        }
+        addToPostfix(module);
+        addCommand("IMPORT");
+    }
+    advance();
+
+    tree << "      ;" << endl;
+    match(TokenType::SEMICOLON, "ожидалась ; после имени модуля");
+}
+
+// Begin → Type FunctionName( Params ) {
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::begin()
 {
     // Type
-    output << "    Type: ";
-    if (currentToken.getType() != TokenType::INT && currentToken.getType() != TokenType::DOUBLE)
+    tree << "    Type: ";
+    if (!inSet(firstSet(NonTerminal::TYPE), currentToken.getType()))
     {
-        output << "<некорректный тип '" << currentToken.getValue() << "'>" << endl;
+        tree << "<некорректный тип '" << currentToken.getValue() << "'>" << endl;
         error("некорректный тип функции '" + currentToken.getValue() + "', ожидался int или double");
         advance(); // пропускаем некорректный тип
 
-        output << "    FunctionName: ";
+        tree << "    FunctionName: ";
         if (currentToken.getType() == TokenType::ID)
         {
-            output << currentToken.getValue() << endl;
+            tree << currentToken.getValue() << endl;
             match(TokenType::ID, "ожидалось имя функции");
         }
         else
-            output << "<ожидается идентификатор>" << endl;
+            tree << "<ожидается идентификатор>" << endl;
     }
     else
     {
         string typeName = (currentToken.getType() == TokenType::INT) ? "int" : "double";
-        output << typeName << endl;
+        tree << typeName << endl;
         currentFunctionType = typeName;
         advance();
 
         // FunctionName → Id
-        output << "    FunctionName: ";
+        tree << "    FunctionName: ";
         if (currentToken.getType() == TokenType::ID)
         {
-            output << currentToken.getValue() << endl;
+            tree << currentToken.getValue() << endl;
             currentFunctionName = currentToken.getValue();  // Сохраняем имя функции
             match(TokenType::ID, "ожидалось имя функции");
         }
         else
         {
-            output << "<ожидается идентификатор>" << endl;
+            tree << "<ожидается идентификатор>" << endl;
             error("ожидалось имя функции");
         }
     }
 
     // Обработка открывающейся скобки
-    output << "    (";
+    tree << "    (";
     if (currentToken.getType() == TokenType::LPAREN)
     {
-        output << endl;
+        tree << endl;
         match(TokenType::LPAREN, "ожидалась (");
     }
     else
     {
-        output << " <отсутствует>" << endl;
+        tree << " <отсутствует>" << endl;
         error("ожидалась (");
     }
 
+    if (predict(NonTerminal::PARAMS, currentToken.getType()) == Production::PARAMS_LIST ||
+        currentToken.getType() == TokenType::ID)    // Параметр без типа - ошибку сообщит param()
+        params();
+
     // Обработка закрывающейся скобки
-    output << "    )";
+    tree << "    )";
     if (currentToken.getType() == TokenType::RPAREN)
     {
-        output << endl;
+        tree << endl;
         match(TokenType::RPAREN, "ожидалась )");
     }
     else
     {
-        output << " <отсутствует>" << endl;
+        tree << " <отсутствует>" << endl;
         error("ожидалась )");
     }
 
     // Обработка открывающейся фигурной скобки
-    output << "    {";
+    tree << "    {";
     if (currentToken.getType() == TokenType::LBRACE)
     {
-        output << endl;
+        tree << endl;
         match(TokenType::LBRACE, "ожидалась {");
     }
     else
     {
-        output << " <отсутствует>" << endl;
+        tree << " <отсутствует>" << endl;
         error("ожидалась {");
     }
 
     return true; // Всегда true, чтобы продолжить разбор
 }
 
+// Params → Param ParamsTail, ParamsTail → , Param ParamsTail | ε
+template <class TreeOutput>
+void BasicParser<TreeOutput>::params()
+{
+    tree << "    Params" << endl;
+    param();
+    while (predict(NonTerminal::PARAMS_TAIL, currentToken.getType()) == Production::PARAMS_TAIL_COMMA)
+    {
+        tree << "      ," << endl;
+        advance();
+        param();
+    }
+}
+
+// Param → Type Id. Параметр - переменная функции, объявленная до тела
+template <class TreeOutput>
+void BasicParser<TreeOutput>::param()
+{
+    tree << "      Param" << endl;
+    tree << "        Type: ";
+    string typeName;
+    if (inSet(firstSet(NonTerminal::TYPE), currentToken.getType()))
+    {
+        typeName = (currentToken.getType() == TokenType::INT) ? "int" : "double";
+        tree << typeName << endl;
+        advance();
+    }
+    else
+    {
+        tree << "<ожидается тип>" << endl;
+        error("ожидался тип параметра");
+    }
+
+    tree << "        Id: ";
+    if (currentToken.getType() != TokenType::ID)
+    {
+        tree << "<ожидается идентификатор>" << endl;
+        error("ожидалось имя параметра");
+        return;
+    }
+    tree << currentToken.getValue() << endl;
+    if (typeName.empty())
+        addDeclaredVariable(currentToken);
+    else
+    {
+        addDeclaredVariableWithType(currentToken, typeName == "int" ? SymbolType::INT : SymbolType::DOUBLE);
+        assignVariable(currentToken);   // Значение параметра задает вызывающий
+        parameterTypes.push_back(typeName == "int" ? ValueType::INT : ValueType::DOUBLE);
+        addToPostfix(typeName);
+        addToPostfix(currentToken.getValue());
+        addCommand("PARAM");
+    }
+    advance();
+}
+
 // End → return Id ; }
-bool Parser::end()
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::end()
 {
-    output << "    return" << endl;
+    tree << "    return" << endl;
     if (!match(TokenType::RETURN, "ожидался return"))   // Проверяем наличие ключевого слова return
     {
-        output << "    Id: <ожидается идентификатор>" << endl;
-        output << "    ;<ожидалась ;>" << endl;
-        output << "    }<ожидалась }>" << endl;
+        tree << "    Id: <ожидается идентификатор>" << endl;
+        tree << "    ;<ожидалась ;>" << endl;
+        tree << "    }<ожидалась }>" << endl;
         return false;
     }
 
-    output << "    Id: ";
+    tree << "    Id: ";
     if (currentToken.getType() == TokenType::ID)    // Проверяем тип текущего токена
     {
         string returnVar = currentToken.getValue();
-        output << returnVar << endl;
-        checkFunctionReturnType(returnVar); // Проверяем, объявлена ли переменная returnVar
+        tree << returnVar << endl;
+        checkFunctionReturnType(currentToken); // Проверяем, объявлена ли переменная returnVar
+        useVariable(currentToken);
 
         Token idToken = currentToken;   // Сохраняем токен идентификатора ДО проверки
 
         if (!match(TokenType::ID, "ожидался идентификатор после return"))   // Проверяем и пропускаем идентификатор
         {
-            output << "    ;<ожидалась ;>" << endl;
-            output << "    }<ожидалась }>" << endl;
+            tree << "    ;<ожидалась ;>" << endl;
+            tree << "    }<ожидалась }>" << endl;
             return false;
         }
 
         addToPostfix(returnVar);    // Добавляем переменную в постфиксную запись
-        addToPostfix("RETURN");     // Добавляем операцию RETURN
+        addCommand("RETURN");       // Добавляем операцию RETURN
 
-        output << "    ;";
+        tree << "    ;";
         if (currentToken.getType() == TokenType::SEMICOLON) // Проверяем наличие точки с запятой
         {
-            output << endl;
+            tree << endl;
             advance();
         }
         else
         {
-            output << " <отсутствует>" << endl;
-            int errorLine = idToken.getLine();  // Вычисляем позицию для ошибки после идентификатора
-            int errorPosition = idToken.getPosition() + idToken.getValue().length();
+            tree << " <отсутствует>" << endl;
+            int64_t errorLine = idToken.getLine();  // Вычисляем позицию для ошибки после идентификатора
+            int64_t errorPosition = idToken.getEndPosition();
             string errorMsg = "строка " + to_string(errorLine) +
                 ", позиция " + to_string(errorPosition) + ": ожидалась ;";
             errors.push_back(errorMsg);
@@ -252,18 +442,18 @@ bool Parser::end()
     else if (currentToken.getType() == TokenType::SEMICOLON)
     {
         // Если после return сразу точка с запятой
-        output << "<отсутствует>" << endl;
+        tree << "<отсутствует>" << endl;
         string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
             to_string(currentToken.getPosition()) + ": ожидался идентификатор после return";
         errors.push_back(errorMsg);
 
-        output << "    ;" << endl;
+        tree << "    ;" << endl;
         advance();
     }
     else
     {
         // Если нет ни идентификатора, ни точки с запятой
-        output << "<отсутствует>" << endl;
+        tree << "<отсутствует>" << endl;
         string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
             to_string(currentToken.getPosition()) + ": ожидался идентификатор после return";
         errors.push_back(errorMsg);
@@ -271,29 +461,29 @@ bool Parser::end()
         skipToSemicolonOrBrace();   // Пропускаем до точки с запятой или закрывающей скобки
         if (currentToken.getType() == TokenType::SEMICOLON) // Если нашли точку с запятой, выводим ее в дерево
         {
-            output << "    ;" << endl;
+            tree << "    ;" << endl;
             advance();
         }
     }
 
-    output << "    }";
+    tree << "    }";
 
     // Сохраняем последний обработанный токен перед проверкой закрывающей скобки
     Token lastTokenBeforeBrace = currentToken;
 
     if (currentToken.getType() == TokenType::RBRACE)    // Проверяем наличие закрывающейся фигурной скобки
     {
-        output << endl;
+        tree << endl;
         advance();
     }
     else
     {
-        output << " <отсутствует>" << endl;
-        int errorLine, errorPosition;   // Вычисляем позицию для ошибки закрывающей скобки
+        tree << " <отсутствует>" << endl;
+        int64_t errorLine, errorPosition;   // Вычисляем позицию для ошибки закрывающей скобки
 
         // Используем lastValidToken для получения корректных координат
         errorLine = lastValidToken.getLine();
-        errorPosition = lastValidToken.getPosition() + lastValidToken.getValue().length();
+        errorPosition = lastValidToken.getEndPosition();
 
         string errorMsg = "строка " + to_string(errorLine) +
             ", позиция " + to_string(errorPosition) + ": ожидалась }";
@@ -303,14 +493,11 @@ bool Parser::end()
     return true;
 }
 
-void Parser::skipToSemicolonOrBrace()   // Пропуск токенов до точки с запятой или закрывающейся фигурной скобки
+template <class TreeOutput>
+void BasicParser<TreeOutput>::skipToSemicolonOrBrace()   // Пропуск токенов до точки с запятой или закрывающейся фигурной скобки
 {
-    while (currentToken.getType() != TokenType::SEMICOLON &&
-        currentToken.getType() != TokenType::RBRACE &&
-        currentToken.getType() != TokenType::END_OF_FILE)
-    {
+    while (!inSet(SYNC_END, currentToken.getType()))
         advance();
-    }
 
     // Если нашли точку с запятой, пропускаем ее, это позволяет продолжить разбор со следующего оператора
     if (currentToken.getType() == TokenType::SEMICOLON)
@@ -318,32 +505,30 @@ void Parser::skipToSemicolonOrBrace()   // Пропуск токенов до т
 }
 
 // Descriptions → Descr | Descr Descriptions
-void Parser::descriptions()
+template <class TreeOutput>
+void BasicParser<TreeOutput>::descriptions()
 {
     // Обрабатываем все объявления - как с типами, так и без типов
-    while (currentToken.getType() == TokenType::INT ||
-        currentToken.getType() == TokenType::DOUBLE ||
-        (currentToken.getType() == TokenType::ID &&
-            (lexer.peekNextToken().getType() == TokenType::COMMA ||
-                lexer.peekNextToken().getType() == TokenType::SEMICOLON)))
+    while (predict(NonTerminal::DESCRIPTIONS, currentToken.getType()) == Production::DESCRIPTIONS_LIST ||
+        descrRecovery() == DescrRecovery::WITHOUT_TYPE)
     {
         if (currentToken.getType() == TokenType::ID)    // Обработка объявлений без типа
         {
-            output << "    Descr" << endl;
-            output << "      Type: <отсутствует>" << endl;
+            tree << blockIndent << "    Descr" << endl;
+            tree << blockIndent << "      Type: <отсутствует>" << endl;
 
             string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                 to_string(currentToken.getPosition()) + ": ожидался тип (int или double) перед '" +
                 currentToken.getValue() + "'";
             errors.push_back(errorMsg);
 
-            output << "      VarList" << endl;
+            tree << blockIndent << "      VarList" << endl;
 
-            output << "        Id: " << currentToken.getValue() << endl; // Обрабатываем первый идентификатор
-            addDeclaredVariable(currentToken.getValue());   // Добавляем переменную без типа в список переменных
+            tree << blockIndent << "        Id: " << currentToken.getValue() << endl; // Обрабатываем первый идентификатор
+            addDeclaredVariable(currentToken);   // Добавляем переменную без типа в список переменных
             advance(); // Пропускаем идентификатор
 
-            int initialLine = currentToken.getLine();
+            int64_t initialLine = currentToken.getLine();
 
             // Обработка дополнительных переменных через запятую
             while (currentToken.getType() == TokenType::COMMA ||
@@ -351,10 +536,11 @@ void Parser::descriptions()
             {
                 if (currentToken.getType() == TokenType::COMMA)
                 {
-                    output << "        ," << endl;
+                    tree << blockIndent << "        ," << endl;
                     match(TokenType::COMMA, "ожидалась ,");
 
-                    output << "        Id: " << (currentToken.getType() == TokenType::ID ? currentToken.getValue() : "<ожидается идентификатор>") << endl;
+                    if (TreeOutput::enabled)    // Без дерева условие и строка-аргумент не вычисляются
+                        tree << blockIndent << "        Id: " << (currentToken.getType() == TokenType::ID ? currentToken.getValue() : "<ожидается идентификатор>") << endl;
 
                     if (currentToken.getType() == TokenType::ID)
                     {
@@ -364,15 +550,15 @@ void Parser::descriptions()
                             currentToken.getValue() + "'";
                         errors.push_back(varErrorMsg);
 
-                        addDeclaredVariable(currentToken.getValue());   // Добавляем переменную
+                        addDeclaredVariable(currentToken);   // Добавляем переменную
                         advance();
                     }
                 }
                 else if (currentToken.getType() == TokenType::ID)
                 {
                     // Обработка идентификатора без запятой
-                    output << "        , <отсутствует>" << endl;
-                    output << "        Id: " << currentToken.getValue() << endl;
+                    tree << blockIndent << "        , <отсутствует>" << endl;
+                    tree << blockIndent << "        Id: " << currentToken.getValue() << endl;
 
                     string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                         to_string(currentToken.getPosition()) + ": отсутствует ',' между переменными";
@@ -383,12 +569,12 @@ void Parser::descriptions()
                         currentToken.getValue() + "'";
                     errors.push_back(typeErrorMsg);
 
-                    addDeclaredVariable(currentToken.getValue());   // Добавляем переменную
+                    addDeclaredVariable(currentToken);   // Добавляем переменную
                     advance();
                 }
             }
 
-            output << "      ;" << endl;
+            tree << blockIndent << "      ;" << endl;
             if (currentToken.getType() == TokenType::SEMICOLON)
                 advance();
             else
@@ -398,72 +584,80 @@ void Parser::descriptions()
             descr();    // Обычные объявления с типом
     }
 
-    if (currentToken.getType() == TokenType::ID)  // Обработка случая с неизвестным типом
+    if (descrRecovery() == DescrRecovery::UNKNOWN_TYPE)    // Обработка случая с неизвестным типом
     {
-        Token nextToken = lexer.peekNextToken();    // Заглядываем вперед на следующий токен, чтобы определить контекст
-        if (nextToken.getType() == TokenType::ID)   // Если следующий токен - ID, это объявление с неизвестным типом
-        {
-            output << "    Descr" << endl;
-            output << "      Type: <неизвестный тип '" << currentToken.getValue() << "'>" << endl;
-            string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
-                to_string(currentToken.getPosition()) + ": неизвестный тип '" +
-                currentToken.getValue() + "'";
-            errors.push_back(errorMsg);
+        tree << blockIndent << "    Descr" << endl;
+        tree << blockIndent << "      Type: <неизвестный тип '" << currentToken.getValue() << "'>" << endl;
+        string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
+            to_string(currentToken.getPosition()) + ": неизвестный тип '" +
+            currentToken.getValue() + "'";
+        errors.push_back(errorMsg);
 
-            advance(); // пропускаем неизвестный тип
-            output << "      VarList" << endl;
-            processVariableListForUnknownType();
+        advance(); // пропускаем неизвестный тип
+        tree << blockIndent << "      VarList" << endl;
+        processVariableListForUnknownType();
 
-            output << "      ;" << endl;
-            if (currentToken.getType() == TokenType::SEMICOLON) // Если точка с запятой
-                advance();  // Пропускаем точку с запятой
-            else
-                skipToSemicolon();  // Пропускаем до точки с запятой
-        }
+        tree << blockIndent << "      ;" << endl;
+        if (currentToken.getType() == TokenType::SEMICOLON) // Если точка с запятой
+            advance();  // Пропускаем точку с запятой
+        else
+            skipToSemicolon();  // Пропускаем до точки с запятой
     }
 }
 
+// Ветвь восстановления для Id на месте типа - по второму токену (Grammar.h)
+template <class TreeOutput>
+DescrRecovery BasicParser<TreeOutput>::descrRecovery()
+{
+    if (currentToken.getType() != TokenType::ID)
+        return DescrRecovery::NONE;
+    return predictDescrRecovery(lexer.peekNextType());
+}
+
 // Descr → Type VarList ;
-void Parser::descr()
+template <class TreeOutput>
+void BasicParser<TreeOutput>::descr()
 {
-    output << "    Descr" << endl;
-    output << "      Type: ";
+    tree << blockIndent << "    Descr" << endl;
+    tree << blockIndent << "      Type: ";
 
-    string currentType;
-    if (currentToken.getType() == TokenType::INT || currentToken.getType() == TokenType::DOUBLE) // Тип
+    SymbolType currentType = SymbolType::UNTYPED;
+    if (inSet(firstSet(NonTerminal::TYPE), currentToken.getType())) // Тип
     {
         string typeName = (currentToken.getType() == TokenType::INT) ? "int" : "double";
-        output << typeName << endl;
-        currentType = typeName;
+        tree << typeName << endl;
+        currentType = (currentToken.getType() == TokenType::INT) ? SymbolType::INT : SymbolType::DOUBLE;
 
-        addToPostfix("DECLARE");
+        addCommand("DECLARE");
         addToPostfix(typeName);
     }
     else
     {
-        output << "<ожидается тип>" << endl;
-        currentType = ""; // Пустой тип при ошибке
+        tree << "<ожидается тип>" << endl;
+        currentType = SymbolType::UNTYPED; // Тип неизвестен при ошибке
     }
 
     type();     // Вызываем метод разбора типа (проверяет и пропускает токен типа)
 
-    output << "      VarList" << endl;
+    tree << blockIndent << "      VarList" << endl;
     lastProcessedToken = currentToken;  // Сохраняем последний обработанный токен
     varlist(currentType);  // Разбираем список переменных
+    if (currentType != SymbolType::UNTYPED)
+        declarationEnds.push_back(postfixCode.size());  // Явная граница объявления для построения IR
 
-    output << "      ;";
+    tree << blockIndent << "      ;";
     if (currentToken.getType() == TokenType::SEMICOLON) // Проверяем наличие точки с запятой
     {
-        output << endl;
+        tree << endl;
         advance();
     }
     else
     {
-        output << " <ожидалась ;>" << endl;
+        tree << " <ожидалась ;>" << endl;
 
         // Вычисляем позицию после последнего идентификатора в списке переменных
-        int errorLine = lastProcessedToken.getLine();
-        int errorPosition = lastProcessedToken.getPosition() + lastProcessedToken.getValue().length();
+        int64_t errorLine = lastProcessedToken.getLine();
+        int64_t errorPosition = lastProcessedToken.getEndPosition();
         string errorMsg = "строка " + to_string(errorLine) +
             ", позиция " + to_string(errorPosition) + ": ожидалась ;";
         errors.push_back(errorMsg);
@@ -471,26 +665,35 @@ void Parser::descr()
 }
 
 // Type → int | double
-void Parser::type()
+template <class TreeOutput>
+void BasicParser<TreeOutput>::type()
 {
-    if (currentToken.getType() == TokenType::INT)           // Если токен int
+    switch (predict(NonTerminal::TYPE, currentToken.getType()))
+    {
+    case Production::TYPE_INT:                              // Если токен int
         match(TokenType::INT, "ожидался int");              // Проверяем и пропускаем
-    else if (currentToken.getType() == TokenType::DOUBLE)   // Если токен double
+        break;
+    case Production::TYPE_DOUBLE:                           // Если токен double
         match(TokenType::DOUBLE, "ожидался double");        // Проверяем и пропускаем
-    else
+        break;
+    default:
         error("ожидался тип (int или double)");             // Добавляем ошибку
+        break;
+    }
 }
 
 // VarList → Id | Id , VarList      
-void Parser::varlist(const string& varType)
+template <class TreeOutput>
+void BasicParser<TreeOutput>::varlist(SymbolType varType)
 {
-    output << "        Id: " << (currentToken.getType() == TokenType::ID ? currentToken.getValue() : "<ожидается идентификатор>") << endl;
+    if (TreeOutput::enabled)
+        tree << blockIndent << "        Id: " << (currentToken.getType() == TokenType::ID ? currentToken.getValue() : "<ожидается идентификатор>") << endl;
 
     lastProcessedToken = currentToken;  // Сохраняем текущий токен для возможного вычисления позиции ошибки
 
     if (currentToken.getType() == TokenType::ID)    // Обрабатываем первый идентификатор в списке
     {
-        addDeclaredVariableWithType(currentToken.getValue(), varType);  // Добавляем переменную с типом
+        addDeclaredVariableWithType(currentToken, varType);  // Добавляем переменную с типом
         addToPostfix(currentToken.getValue());  // Добавляем переменную для постфиксной записи
         advance(); // Пропускаем идентификатор
     }
@@ -498,7 +701,7 @@ void Parser::varlist(const string& varType)
     {
         if (currentToken.getType() == TokenType::COMMA)
         {
-            output << "        , <неожиданная запятая>" << endl;
+            tree << blockIndent << "        , <неожиданная запятая>" << endl;
             string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                 to_string(currentToken.getPosition()) + ": неожиданная запятая перед идентификатором";
             errors.push_back(errorMsg);
@@ -507,13 +710,13 @@ void Parser::varlist(const string& varType)
             // Пытаемся обработать следующий идентификатор
             if (currentToken.getType() == TokenType::ID)
             {
-                output << "        Id: " << currentToken.getValue() << endl;
-                addDeclaredVariableWithType(currentToken.getValue(), varType);
+                tree << blockIndent << "        Id: " << currentToken.getValue() << endl;
+                addDeclaredVariableWithType(currentToken, varType);
                 advance();
             }
             else
             {
-                output << "        Id: <ожидается идентификатор>" << endl;
+                tree << blockIndent << "        Id: <ожидается идентификатор>" << endl;
                 if (!match(TokenType::ID, "ожидался идентификатор после ,"))
                 {
                     // Восстанавливаемся - пропускаем до точки с запятой
@@ -533,7 +736,7 @@ void Parser::varlist(const string& varType)
         }
     }
 
-    int initialLine = lastProcessedToken.getLine();
+    int64_t initialLine = lastProcessedToken.getLine();
 
     // Обработка дополнительных переменных через запятую
     while (currentToken.getType() == TokenType::COMMA ||
@@ -541,15 +744,16 @@ void Parser::varlist(const string& varType)
     {
         if (currentToken.getType() == TokenType::COMMA)
         {
-            output << "        ," << endl;
+            tree << blockIndent << "        ," << endl;
             match(TokenType::COMMA, "ожидалась ,");
             lastProcessedToken = currentToken;  // Сохраняем позицию после запятой
 
-            output << "        Id: " << (currentToken.getType() == TokenType::ID ? currentToken.getValue() : "<ожидается идентификатор>") << endl;
+            if (TreeOutput::enabled)
+                tree << blockIndent << "        Id: " << (currentToken.getType() == TokenType::ID ? currentToken.getValue() : "<ожидается идентификатор>") << endl;
 
             if (currentToken.getType() == TokenType::ID)
             {
-                addDeclaredVariableWithType(currentToken.getValue(), varType);  // Добавляем все последующие переменные
+                addDeclaredVariableWithType(currentToken, varType);  // Добавляем все последующие переменные
                 addToPostfix(currentToken.getValue());
                 advance();
             }
@@ -561,8 +765,8 @@ void Parser::varlist(const string& varType)
         }
         else if (currentToken.getType() == TokenType::ID)   // Если идентификатор без запятой
         {
-            output << "        , <отсутствует>" << endl;
-            output << "        Id: " << currentToken.getValue() << endl;
+            tree << blockIndent << "        , <отсутствует>" << endl;
+            tree << blockIndent << "        Id: " << currentToken.getValue() << endl;
 
             Token errorToken = currentToken;
             string errorMsg = "строка " + to_string(errorToken.getLine()) + ", позиция " +
@@ -570,7 +774,7 @@ void Parser::varlist(const string& varType)
             errors.push_back(errorMsg);
 
             lastProcessedToken = currentToken;
-            addDeclaredVariableWithType(currentToken.getValue(), varType);
+            addDeclaredVariableWithType(currentToken, varType);
             addToPostfix(currentToken.getValue());
             advance();  // Пропускаем идентификатор
         }
@@ -578,17 +782,9 @@ void Parser::varlist(const string& varType)
 
     if (currentToken.getLine() == initialLine) // Неправильный разделитель
     {
-        while (currentToken.getLine() == initialLine &&
-            currentToken.getType() != TokenType::COMMA &&
-            currentToken.getType() != TokenType::SEMICOLON &&
-            currentToken.getType() != TokenType::END_OF_FILE &&
-            currentToken.getType() != TokenType::INT &&
-            currentToken.getType() != TokenType::DOUBLE &&
-            currentToken.getType() != TokenType::RETURN &&
-            currentToken.getType() != TokenType::RBRACE &&
-            currentToken.getType() != TokenType::ID)
+        while (currentToken.getLine() == initialLine && !inSet(SYNC_VARLIST, currentToken.getType()))
         {
-            output << "        <неверный разделитель '" << currentToken.getValue() << "'>" << endl;
+            tree << blockIndent << "        <неверный разделитель '" << currentToken.getValue() << "'>" << endl;
 
             string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                 to_string(currentToken.getPosition()) + ": ожидалась ',' вместо '" + currentToken.getValue() + "'";
@@ -599,8 +795,8 @@ void Parser::varlist(const string& varType)
             // Если после разделителя идет идентификатор, обрабатываем его
             if (currentToken.getType() == TokenType::ID)
             {
-                output << "        Id: " << currentToken.getValue() << endl;
-                addDeclaredVariableWithType(currentToken.getValue(), varType);
+                tree << blockIndent << "        Id: " << currentToken.getValue() << endl;
+                addDeclaredVariableWithType(currentToken, varType);
                 advance();
                 continue;   // Продолжаем обработку возможных следующих переменных
             }
@@ -609,25 +805,32 @@ void Parser::varlist(const string& varType)
 }
 
 // Operators → Op | Op Operators
-void Parser::operators()
+// Op → Id = Expr ; | Block
+template <class TreeOutput>
+void BasicParser<TreeOutput>::operators()
 {
-    while (currentToken.getType() == TokenType::ID &&   // Обрабатываем все операторы присваивания
-        currentToken.getType() != TokenType::END_OF_FILE &&
-        currentToken.getType() != TokenType::RETURN &&
-        currentToken.getType() != TokenType::RBRACE)
+    NestingGuard level(nesting, budget, stack);
+    // Обрабатываем все операторы присваивания и блоки
+    while (predict(NonTerminal::OPERATORS, currentToken.getType()) == Production::OPERATORS_LIST)
     {
-        // Сохраняем текущий идентификатор и заглядываем на следующий токен для анализа контекста
-        Token idToken = currentToken;
-        Token nextToken = lexer.peekNextToken();
+        if (blockDepth == 0 && parallelStatements())
+            continue;
+
+        if (predict(NonTerminal::OP, currentToken.getType()) == Production::OP_BLOCK) // Вложенный блок со своей областью видимости
+        {
+            tree << blockIndent << "    Block" << endl;
+            block();
+            continue;
+        }
 
-        output << "    Op" << endl;
+        tree << blockIndent << "    Op" << endl;
         op();   // Разбираем оператор присваивания
     }
 
     // Обработка ошибочных объявлений переменных после операторов
-    while (currentToken.getType() == TokenType::INT || currentToken.getType() == TokenType::DOUBLE)
+    while (inSet(firstSet(NonTerminal::DESCR), currentToken.getType()))
     {
-        output << "    Descr <ошибка: объявления после операторов>" << endl;
+        tree << blockIndent << "    Descr <ошибка: объявления после операторов>" << endl;
         string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
             to_string(currentToken.getPosition()) + ": объявление переменных после операторов";
         errors.push_back(errorMsg);
@@ -641,8 +844,8 @@ void Parser::operators()
     // Обработка случая когда есть =, но нет левой части
     if (currentToken.getType() == TokenType::ASSIGN)
     {
-        output << "    Op" << endl;
-        output << "      Id: <отсутствует>" << endl;
+        tree << blockIndent << "    Op" << endl;
+        tree << blockIndent << "      Id: <отсутствует>" << endl;
 
         Token errorToken = currentToken;
         string errorMsg = "строка " + to_string(errorToken.getLine()) + ", позиция " +
@@ -651,11 +854,11 @@ void Parser::operators()
 
         advance();
 
-        output << "      =" << endl;
-        output << "      Expr" << endl;
-        expr(3);
+        tree << blockIndent << "      =" << endl;
+        tree << blockIndent << "      Expr" << endl;
+        expr(3 + 2 * blockDepth);
 
-        output << "      ;" << endl;
+        tree << blockIndent << "      ;" << endl;
         if (currentToken.getType() == TokenType::SEMICOLON)
             advance();
         else
@@ -663,12 +866,161 @@ void Parser::operators()
     }
 }
 
-void Parser::op()
+// Операторы верхнего уровня до ближайшего блока, объявления или return делятся по ';'
+// на фрагменты, и каждый фрагмент разбирается отдельным парсером в своем потоке.
+// Объявлений внутри нет, поэтому таблица символов только читается. Дерево, постфикс
+// и события потока данных фрагментов сливаются в порядке текста. Если хоть в одном
+// фрагменте есть ошибка, результат отбрасывается и операторы разбираются
+// последовательно - диагностика всегда та же, что без потоков.
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::parallelStatements()
 {
-    string varName = currentToken.getValue();
-    output << "      Id: " << varName << endl;
+    const TokenStream* stream = lexer.getTokenStream();
+    if (parseThreads < 2 || stream == nullptr || currentToken.getType() != TokenType::ID ||
+        lexer.getTokenIndex() <= parallelScanEnd)
+        return false;
+    size_t start = lexer.getTokenIndex() - 1;   // Номер currentToken в потоке
+
+    vector<size_t> ends;    // Номер токена за каждой ';'
+    size_t scan = start;
+    for (; scan < stream->size(); scan++)
+    {
+        TokenType type = stream->typeAt(scan);
+        if (type == TokenType::SEMICOLON)
+            ends.push_back(scan + 1);
+        else if (type == TokenType::LBRACE || type == TokenType::RBRACE || type == TokenType::INT ||
+            type == TokenType::DOUBLE || type == TokenType::RETURN)
+            break;
+    }
+    parallelScanEnd = scan;
+    size_t tasks = min<size_t>(parseThreads, ends.size() / PARALLEL_STATEMENTS_PER_TASK);
+    if (tasks < 2)
+        return false;
 
-    if (!isVariableDeclared(varName))   // Объявлена ли переменная в левой части присваивания
+    TRACE_SCOPE("parallel operators");
+    typedef typename conditional<TreeOutput::enabled, TextTreeOutput, NullTreeOutput>::type FragmentTree;
+    struct Fragment
+    {
+        ostringstream tree;
+        vector<PostfixToken> postfix;
+        vector<DataflowEvent> dataflow;
+        bool correct = false;
+    };
+    vector<Fragment> fragments(tasks);
+
+    uint32_t traceFile = Trace::getCurrentFile();
+    auto parseFragment = [&](size_t k)
+    {
+        TraceFile file(traceFile);
+        TRACE_SCOPE("operators fragment");
+        Fragment& fragment = fragments[k];
+        size_t from = k == 0 ? start : ends[ends.size() * k / tasks - 1];
+        size_t to = ends[ends.size() * (k + 1) / tasks - 1];
+
+        Lexer fragmentLexer(*stream, symbols, from, to);
+        BasicParser<FragmentTree> parser(fragmentLexer, fragment.tree, symbols, interfaces);
+        parser.importedFunctions = importedFunctions;
+        parser.deferChecks = false;     // Фрагменты уже разбираются параллельно
+        parser.dataflowLog = &fragment.dataflow;
+        parser.budget = budget;
+        parser.nesting = nesting;
+        try
+        {
+            while (parser.currentToken.getType() == TokenType::ID && parser.errors.empty())
+            {
+                parser.tree << parser.blockIndent << "    Op" << endl;
+                parser.op();
+            }
+            fragment.correct = parser.errors.empty() && parser.currentToken.getType() == TokenType::END_OF_FILE;
+            fragment.postfix = move(parser.postfixCode);
+        }
+        catch (...)     // Например, превышен бюджет - последовательный разбор сообщит об этом сам
+        {
+            fragment.correct = false;
+        }
+    };
+
+    vector<thread> workers;
+    for (size_t k = 1; k < tasks; k++)
+        workers.emplace_back(parseFragment, k);
+    parseFragment(0);
+    for (auto& worker : workers)
+        worker.join();
+
+    for (const Fragment& fragment : fragments)
+        if (!fragment.correct)
+            return false;
+
+    for (Fragment& fragment : fragments)
+    {
+        if (TreeOutput::enabled)    // Построчно - JSON-дерево определяет узел по строке
+        {
+            string text = fragment.tree.str();
+            for (size_t lineStart = 0; lineStart < text.size();)
+            {
+                size_t lineEnd = min(text.find('\n', lineStart), text.size());
+                tree << text.substr(lineStart, lineEnd - lineStart) << endl;
+                lineStart = lineEnd + 1;
+            }
+        }
+        postfixCode.insert(postfixCode.end(), make_move_iterator(fragment.postfix.begin()),
+            make_move_iterator(fragment.postfix.end()));
+        dataflow.replay(fragment.dataflow);
+    }
+
+    lexer.seek(ends.back() - 1);    // Последняя ';' становится последним разобранным токеном
+    currentToken = lexer.getNextToken();
+    advance();
+    return true;
+}
+
+// Block → { Descriptions Operators }
+template <class TreeOutput>
+void BasicParser<TreeOutput>::block()
+{
+    tree << blockIndent << "      {" << endl;
+    advance();  // Пропускаем {
+    addToPostfix("{");
+
+    runSemanticChecks();                // Проверки до блока видят таблицу без его объявлений
+    symbols->enterScope();    // Объявления блока затеняют внешние и исчезают при выходе из него
+    blockDepth++;
+    blockIndent.level += 2;
+
+    tree << blockIndent << "  Descriptions" << endl;
+    descriptions();
+
+    tree << blockIndent << "  Operators" << endl;
+    operators();
+
+    blockDepth--;
+    blockIndent.level -= 2;
+    symbols->exitScope();
+
+    tree << blockIndent << "      }";
+    if (currentToken.getType() == TokenType::RBRACE)
+    {
+        tree << endl;
+        advance();
+    }
+    else
+    {
+        tree << " <отсутствует>" << endl;
+        string errorMsg = "строка " + to_string(lastValidToken.getLine()) + ", позиция " +
+            to_string(lastValidToken.getEndPosition()) + ": ожидалась }";
+        errors.push_back(errorMsg);
+    }
+    addToPostfix("}");
+}
+
+template <class TreeOutput>
+void BasicParser<TreeOutput>::op()
+{
+    Token varToken = currentToken;
+    string varName = varToken.getValue();
+    tree << blockIndent << "      Id: " << varName << endl;
+
+    if (!isVariableDeclared(varToken))   // Объявлена ли переменная в левой части присваивания
     {
         string errorMsg = "строка " + to_string(currentToken.getLine()) +
             ": использование необъявленной переменной '" + varName + "'";
@@ -678,29 +1030,26 @@ void Parser::op()
     if (!match(TokenType::ID, "ожидался идентификатор"))
         return;
 
+    semantic.archiveExpression(currentExpression);
     currentExpression.clear();
+    currentTypes.reset(&currentExpression);
 
     if (currentToken.getType() != TokenType::ASSIGN)    // Проверяем наличие оператора присваивания
     {
-        output << "      = <отсутствует>" << endl;
+        tree << blockIndent << "      = <отсутствует>" << endl;
         string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
             to_string(currentToken.getPosition()) + ": ожидался = после идентификатора";
         errors.push_back(errorMsg);
 
         // Продолжаем разбор выражения даже без =
-        if (currentToken.getType() == TokenType::ID ||
-            currentToken.getType() == TokenType::INT_NUM ||
-            currentToken.getType() == TokenType::DOUBLE_NUM ||
-            currentToken.getType() == TokenType::LPAREN ||
-            currentToken.getType() == TokenType::ITOD ||
-            currentToken.getType() == TokenType::DTOI)
+        if (inSet(firstSet(NonTerminal::EXPR), currentToken.getType()))
         {
-            output << "      Expr" << endl;
-            expr(4);
+            tree << blockIndent << "      Expr" << endl;
+            expr(4 + 2 * blockDepth);
 
             // Семантическая проверка типов
-            string exprType = getExpressionType();
-            checkAssignmentType(varName, exprType); // Проверяем типы в присваивании
+            checkAssignmentType(varToken);   // Проверяем типы в присваивании
+            assignVariable(varToken);        // Правая часть уже прочитана
 
             addToPostfix(varName);  // Добавляем переменную (левую часть)
             addToPostfix("=");      // Добавляем операцию присваивания
@@ -708,17 +1057,17 @@ void Parser::op()
 
             lastProcessedToken = currentToken;  // Сохраняем последний токен выражения для вычисления позиции ошибки
 
-            output << "      ;";
+            tree << blockIndent << "      ;";
             if (currentToken.getType() == TokenType::SEMICOLON)
             {
-                output << endl;
+                tree << endl;
                 advance();
             }
             else
             {
-                output << " <ожидалась ;>" << endl;
-                int errorLine = lastProcessedToken.getLine();
-                int errorPosition = lastProcessedToken.getPosition() + lastProcessedToken.getValue().length();
+                tree << " <ожидалась ;>" << endl;
+                int64_t errorLine = lastProcessedToken.getLine();
+                int64_t errorPosition = lastProcessedToken.getEndPosition();
                 string errorMsg = "строка " + to_string(errorLine) +
                     ", позиция " + to_string(errorPosition) + ": ожидалась ;";
                 errors.push_back(errorMsg);
@@ -726,26 +1075,27 @@ void Parser::op()
         }
         else    // Невозможно разобрать выражение - пропускаем до точки с запятой
         {
-            output << "      ; <ожидалась ;>" << endl;
+            tree << blockIndent << "      ; <ожидалась ;>" << endl;
             skipToSemicolon();
         }
     }
     else
     {
-        output << "      =" << endl;
+        tree << blockIndent << "      =" << endl;
         if (!match(TokenType::ASSIGN, "ожидался ="))
             return;
 
-        output << "      Expr" << endl;
+        tree << blockIndent << "      Expr" << endl;
 
         currentExpression.clear();
+        currentTypes.reset(&currentExpression);
         Token lastTokenBeforeExpr = currentToken;   // Сохраняем последний токен перед разбором выражения
 
-        expr(4);    // Разбор выражения
+        expr(4 + 2 * blockDepth);    // Разбор выражения
 
         while (currentToken.getType() == TokenType::RPAREN)     // Обработка всех лишних ')'
         {
-            output << "        ) <лишняя>" << endl;
+            tree << blockIndent << "        ) <лишняя>" << endl;
             string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                 to_string(currentToken.getPosition()) + ": лишняя закрывающаяся скобка";
             errors.push_back(errorMsg);
@@ -753,8 +1103,8 @@ void Parser::op()
         }
 
         // Семантическая проверка типов
-        string exprType = getExpressionType();
-        checkAssignmentType(varName, exprType);
+        checkAssignmentType(varToken);
+        assignVariable(varToken);   // Правая часть уже прочитана
 
         addToPostfix(varName);
         addToPostfix("=");
@@ -763,9 +1113,9 @@ void Parser::op()
         // Проверяем переход на новую строку после выражения
         if (currentToken.getLine() != lastTokenBeforeExpr.getLine())
         {
-            output << "      ; <отсутствует>" << endl;
-            int errorLine = lastValidToken.getLine();
-            int errorPosition = lastValidToken.getPosition() + lastValidToken.getValue().length(); // Позиция последнего токена + длина
+            tree << blockIndent << "      ; <отсутствует>" << endl;
+            int64_t errorLine = lastValidToken.getLine();
+            int64_t errorPosition = lastValidToken.getEndPosition(); // Позиция последнего токена + длина
 
             string errorMsg = "строка " + to_string(errorLine) +
                 ", позиция " + to_string(errorPosition) + ": ожидалась ;";
@@ -774,8 +1124,8 @@ void Parser::op()
         else if (currentToken.getType() != TokenType::SEMICOLON)
         {
             // Остались на той же строке, но нет точки с запятой
-            output << "      ; <отсутствует>" << endl;
-            int errorPosition = currentToken.getPosition() + currentToken.getValue().length();
+            tree << blockIndent << "      ; <отсутствует>" << endl;
+            int64_t errorPosition = currentToken.getEndPosition();
             string errorMsg = "строка " + to_string(currentToken.getLine()) +
                 ", позиция " + to_string(errorPosition) + ": ожидалась ;";
             errors.push_back(errorMsg);
@@ -783,76 +1133,96 @@ void Parser::op()
         }
         else
         {
-            output << "      ;" << endl;
+            tree << blockIndent << "      ;" << endl;
             advance();
         }
     }
 }
 
 // Expr → SimpleExpr | SimpleExpr + Expr | SimpleExpr - Expr
-void Parser::expr(int indentLevel)
+// Правая рекурсия грамматики разбирается циклом. Дерево то же, что при рекурсии, а операции
+// цепочки левоассоциативны: каждая попадает в запись сразу за своим правым операндом,
+// так что a - b - c - это "a b - c -", и код по записи вычисляет (a - b) - c.
+template <class TreeOutput>
+void BasicParser<TreeOutput>::expr(int indentLevel)
 {
-    string indent = string(indentLevel * 2, ' ');
-
-    output << indent << "SimpleExpr" << endl;   // Разбираем простое выражение
-    simpleExpr(indentLevel + 1);
-
-    string leftType = getExpressionType();  // Получаем тип левого операнда
-    if (currentToken.getType() == TokenType::PLUS || currentToken.getType() == TokenType::MINUS)
+    struct PendingOperation
     {
-        string op = currentToken.getValue();
-        // Поддерживаемые операции: сложение и вычитание
-        output << indent << currentToken.getValue() << endl;
-        advance();  // Пропускаем оператор
+        string op;
+        int symbol;
+        size_t leftPrefix;  // Левый операнд - часть выражения до этой длины
+        bool supported;     // Умножение и деление только попадают в запись, без проверки типов
+    };
+    PendingOperation pending = { "", -1, 0, false };
+    bool waiting = false;   // Операция pending ждет правый операнд
+
+    NestingGuard level(nesting, budget, stack);   // Скобки и вызовы - уровень вложенности, цепочка + и - - нет
+    for (;; indentLevel++)
+    {
+        Indent indent(indentLevel);
 
-        output << indent << "Expr" << endl;
-        expr(indentLevel + 1);  // Рекурсивно разбираем выражение
+        tree << indent << "SimpleExpr" << endl;   // Разбираем простое выражение
+        simpleExpr(indentLevel + 1);
 
-        string rightType = getExpressionType(); // Получаем тип правого операнда
-        checkBinaryOperationTypes(leftType, rightType, op); // Проверяем совместимость типов в операции
-        addToPostfix(op);                       // Добавляем операцию после операндов
-        currentExpression.push_back(op);        // Собираем текущее выражение
-    }
-    else if (currentToken.getType() == TokenType::MULT || currentToken.getType() == TokenType::DIV)
-    {
-        string op = currentToken.getValue();
-        // Неподдерживаемые операции: умножение и деление
-        output << indent << currentToken.getValue() << " <неподдерживаемая операция>" << endl;
-        string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
-            to_string(currentToken.getPosition()) + ": операция '" + currentToken.getValue() + "' не поддерживается";
-        errors.push_back(errorMsg);
-        advance();
+        if (waiting)    // Правый операнд разобран - операция завершается
+        {
+            if (pending.supported)
+                checkBinaryOperationTypes(pending.op, pending.leftPrefix);  // Проверяем совместимость типов в операции
+            addToPostfix(pending.op);                       // Добавляем операцию после операндов
+            currentExpression.push_back(pending.symbol);    // Собираем текущее выражение
+            waiting = false;
+        }
 
-        output << indent << "Expr" << endl;
-        expr(indentLevel + 1);
-        addToPostfix(op);
-        currentExpression.push_back(op);
+        size_t leftPrefix = currentExpression.size();   // Левый операнд - уже вычисленная часть цепочки
+        Production tail = predict(NonTerminal::EXPR_TAIL, currentToken.getType());
+        if (tail == Production::EXPR_TAIL_PLUS || tail == Production::EXPR_TAIL_MINUS)
+        {
+            // Поддерживаемые операции: сложение и вычитание
+            tree << indent << currentToken.getValue() << endl;
+            pending = { currentToken.getValue(), currentToken.getSymbol(), leftPrefix, true };
+        }
+        else if (currentToken.getType() == TokenType::MULT || currentToken.getType() == TokenType::DIV)
+        {
+            // Неподдерживаемые операции: умножение и деление
+            tree << indent << currentToken.getValue() << " <неподдерживаемая операция>" << endl;
+            string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
+                to_string(currentToken.getPosition()) + ": операция '" + currentToken.getValue() + "' не поддерживается";
+            errors.push_back(errorMsg);
+            pending = { currentToken.getValue(), currentToken.getSymbol(), leftPrefix, false };
+        }
+        else
+            break;
+        waiting = true;
+        advance();  // Пропускаем оператор
+
+        tree << indent << "Expr" << endl;   // Правый операнд - следующее звено цепочки
     }
 }
 
 // SimpleExpr → Id | Const | ( Expr ) | itod ( Expr ) | dtoi ( Expr )
-void Parser::simpleExpr(int indentLevel)
+template <class TreeOutput>
+void BasicParser<TreeOutput>::simpleExpr(int indentLevel)
 {
-    string indent = string(indentLevel * 2, ' ');
+    Indent indent(indentLevel);
 
-    switch (currentToken.getType())
+    switch (predict(NonTerminal::SIMPLE_EXPR, currentToken.getType()))
     {
-    case TokenType::ID:
+    case Production::SIMPLE_ID:
     {
         string identifierName = currentToken.getValue();
-        output << indent << "Id: " << identifierName;
+        tree << indent << "Id: " << identifierName;
 
         // Проверяем, является ли это вызовом функции (следующий токен - '(')
-        Token nextToken = lexer.peekNextToken();
-        if (nextToken.getType() == TokenType::LPAREN)
+        if (lexer.peekNextType() == TokenType::LPAREN && importedFunctions.count(identifierName) != 0)
+            callImported(identifierName, indentLevel);
+        else if (lexer.peekNextType() == TokenType::LPAREN)
         {
             // Это вызов функции
-            output << " <вызов функции>" << endl;
+            tree << " <вызов функции>" << endl;
             string currentFunctionCall = identifierName;    // Сохраняем имя функции для последующей проверки
-            if (identifierName == "itod")
-                currentExpression.push_back("itod");
-            else if (identifierName == "dtoi")
-                currentExpression.push_back("dtoi");
+            int functionSymbol = currentToken.getSymbol();
+            if (identifierName == "itod" || identifierName == "dtoi")
+                currentExpression.push_back(functionSymbol);
             else
             {
                 string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
@@ -863,23 +1233,22 @@ void Parser::simpleExpr(int indentLevel)
 
             advance(); // пропускаем имя функции
 
-            output << indent << "(" << endl;
+            tree << indent << "(" << endl;
             match(TokenType::LPAREN, "ожидалась ( после " + identifierName);
 
-            output << indent << "Expr" << endl;
+            tree << indent << "Expr" << endl;
             expr(indentLevel + 1);
 
-            string argType = getExpressionType();
-            checkFunctionArgumentType(currentFunctionCall, argType);    // Проверяем соответствие типа аргумента
-            currentExpression.push_back(currentFunctionCall);           // Добавляем вызов функции в текущее выражение
+            checkFunctionArgumentType(currentFunctionCall); // Проверяем соответствие типа аргумента
+            currentExpression.push_back(functionSymbol);           // Добавляем вызов функции в текущее выражение
 
-            output << indent << ")" << endl;
+            tree << indent << ")" << endl;
             if (!match(TokenType::RPAREN, "ожидалась ) после выражения в " + identifierName))
             {
                 // Обработка лишних скобок
                 while (currentToken.getType() == TokenType::RPAREN)
                 {
-                    output << indent << ") <лишняя>" << endl;
+                    tree << indent << ") <лишняя>" << endl;
                     string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                         to_string(currentToken.getPosition()) + ": лишняя закрывающаяся скобка";
                     errors.push_back(errorMsg);
@@ -891,49 +1260,56 @@ void Parser::simpleExpr(int indentLevel)
         else
         {
             // Это обычная переменная
-            output << (isVariableDeclared(identifierName) ? "" : " <необъявленная переменная>") << endl;
-            if (!isVariableDeclared(identifierName))    // Проверка объявления переменной
+            if (TreeOutput::enabled)
+                tree << (isVariableDeclared(currentToken) ? "" : " <необъявленная переменная>") << endl;
+            if (!isVariableDeclared(currentToken))    // Проверка объявления переменной
             {
                 string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                     to_string(currentToken.getPosition()) + ": использование необъявленной переменной '" +
                     identifierName + "' в выражении";
                 errors.push_back(errorMsg);
             }
+            else
+                useVariable(currentToken);
             addToPostfix(identifierName);                   // Добавляем имя переменной в постфиксную запись 
-            currentExpression.push_back(identifierName);    // Добавляем имя переменной в currentExpression
+            currentExpression.push_back(currentToken.getSymbol());    // Добавляем имя переменной в currentExpression
             match(TokenType::ID, "ожидался идентификатор");
         }
         break;
     }
 
-    case TokenType::INT_NUM:
-        output << indent << "Const: " << currentToken.getValue() << " (int)" << endl;
+    case Production::SIMPLE_INT:
+        tree << indent << "Const: " << currentToken.getValue() << " (int)" << endl;
+        if (symbols->at(currentToken.getSymbol()).constant < 0)    // Значение разобрано лексером при добавлении в таблицу
+            error("константа " + currentToken.getValue() + " вне диапазона int");
         addToPostfix(currentToken.getValue());
-        currentExpression.push_back(currentToken.getValue());
+        currentExpression.push_back(currentToken.getSymbol());
         advance();
         break;
 
-    case TokenType::DOUBLE_NUM:
-        output << indent << "Const: " << currentToken.getValue() << " (double)" << endl;
+    case Production::SIMPLE_DOUBLE:
+        tree << indent << "Const: " << currentToken.getValue() << " (double)" << endl;
+        if (symbols->at(currentToken.getSymbol()).constant < 0)    // Значение разобрано лексером при добавлении в таблицу
+            error("константа " + currentToken.getValue() + " вне диапазона double");
         addToPostfix(currentToken.getValue());
-        currentExpression.push_back(currentToken.getValue());
+        currentExpression.push_back(currentToken.getSymbol());
         advance();
         break;
 
-    case TokenType::LPAREN:
-        output << indent << "(" << endl;
+    case Production::SIMPLE_PARENS:
+        tree << indent << "(" << endl;
         match(TokenType::LPAREN, "ожидалась (");
 
-        output << indent << "Expr" << endl;
+        tree << indent << "Expr" << endl;
         expr(indentLevel + 1);
 
-        output << indent << ")" << endl;
+        tree << indent << ")" << endl;
         if (!match(TokenType::RPAREN, "ожидалась )"))
         {
             // Проверяем лишние закрывающие скобки
             while (currentToken.getType() == TokenType::RPAREN)
             {
-                output << indent << ") <лишняя>" << endl;
+                tree << indent << ") <лишняя>" << endl;
                 string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                     to_string(currentToken.getPosition()) + ": лишняя закрывающаяся скобка";
                 errors.push_back(errorMsg);
@@ -942,32 +1318,32 @@ void Parser::simpleExpr(int indentLevel)
         }
         break;
 
-    case TokenType::ITOD:
-    case TokenType::DTOI:
+    case Production::SIMPLE_ITOD:
+    case Production::SIMPLE_DTOI:
     {
         // Определяем имя функции преобразования типа
         string funcName = (currentToken.getType() == TokenType::ITOD) ? "itod" : "dtoi";
-        output << indent << funcName << endl;
+        int functionSymbol = currentToken.getSymbol();
+        tree << indent << funcName << endl;
 
         advance();
 
-        output << indent << "(" << endl;
+        tree << indent << "(" << endl;
         if (!match(TokenType::LPAREN, "ожидалась ( после " + funcName))
             return;
 
-        output << indent << "Expr" << endl; // Разбираем выражение внутри скобок
+        tree << indent << "Expr" << endl; // Разбираем выражение внутри скобок
         expr(indentLevel + 1);
 
-        string argType = getExpressionType();
-        checkFunctionArgumentType(funcName, argType);   // Проверяем соответствие типа аргумента
-        currentExpression.push_back(funcName);  // Добавляем вызов функции в текущее выражение
+        checkFunctionArgumentType(funcName);    // Проверяем соответствие типа аргумента
+        currentExpression.push_back(functionSymbol);  // Добавляем вызов функции в текущее выражение
 
-        output << indent << ")" << endl;
+        tree << indent << ")" << endl;
         if (!match(TokenType::RPAREN, "ожидалась ) после выражения в " + funcName))
         {
             while (currentToken.getType() == TokenType::RPAREN) // Обрабатываем лишние закрывающие скобки
             {
-                output << indent << ") <лишняя>" << endl;
+                tree << indent << ") <лишняя>" << endl;
                 string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                     to_string(currentToken.getPosition()) + ": лишняя закрывающаяся скобка";
                 errors.push_back(errorMsg);
@@ -979,18 +1355,71 @@ void Parser::simpleExpr(int indentLevel)
     }
 
     default:
-        output << indent << "<неожиданный токен '" << currentToken.getValue() << "'>" << endl;
+        tree << indent << "<неожиданный токен '" << currentToken.getValue() << "'>" << endl;
         error("ожидалось простое выражение");
         break;
     }
 }
 
-void Parser::skipToSemicolon()  // Пропуск токенов до точки с запятой или других значимых разделителей
+// Id ( Args ): Args → Expr ArgsTail | ε, ArgsTail → , Expr ArgsTail | ε
+// В постфиксной записи вызов - аргументы, затем "имя CALL"
+template <class TreeOutput>
+void BasicParser<TreeOutput>::callImported(const string& funcName, int indentLevel)
 {
-    while (currentToken.getType() != TokenType::SEMICOLON &&
-        currentToken.getType() != TokenType::RETURN &&
-        currentToken.getType() != TokenType::RBRACE &&
-        currentToken.getType() != TokenType::END_OF_FILE)
+    Indent indent(indentLevel);
+    size_t expected = importedFunctions.at(funcName).params.size();
+    int functionSymbol = currentToken.getSymbol();
+    tree << " <вызов функции модуля>" << endl;
+    advance();  // пропускаем имя функции
+
+    tree << indent << "(" << endl;
+    match(TokenType::LPAREN, "ожидалась ( после " + funcName);
+
+    size_t argCount = 0;
+    if (predict(NonTerminal::ARGS, currentToken.getType()) == Production::ARGS_LIST)
+    {
+        while (true)
+        {
+            tree << indent << "Expr" << endl;
+            expr(indentLevel + 1);
+
+            CheckEvent event = { CheckKind::CALL_ARGUMENT, funcName };    // Тип аргумента проверяется по сигнатуре
+            event.argument = argCount++;
+            semanticCheck(event);
+
+            if (predict(NonTerminal::ARGS_TAIL, currentToken.getType()) != Production::ARGS_TAIL_COMMA)
+                break;
+            tree << indent << "," << endl;
+            advance();
+        }
+    }
+    if (argCount != expected)
+        error("функция '" + funcName + "' ожидает аргументов: " + to_string(expected) +
+            ", передано: " + to_string(argCount));
+
+    tree << indent << ")" << endl;
+    if (!match(TokenType::RPAREN, "ожидалась ) после аргументов " + funcName))
+    {
+        while (currentToken.getType() == TokenType::RPAREN)
+        {
+            tree << indent << ") <лишняя>" << endl;
+            string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
+                to_string(currentToken.getPosition()) + ": лишняя закрывающаяся скобка";
+            errors.push_back(errorMsg);
+            advance();
+        }
+    }
+
+    addToPostfix(funcName);
+    addCommand("CALL");
+    currentExpression.push_back(functionSymbol);
+    currentExpression.push_back(CALL_MARKER);
+}
+
+template <class TreeOutput>
+void BasicParser<TreeOutput>::skipToSemicolon()  // Пропуск токенов до точки с запятой или других значимых разделителей
+{
+    while (!inSet(SYNC_STATEMENT, currentToken.getType()))
     {
         if (currentToken.getType() == TokenType::RPAREN)    // Пропускаем лишние закрывающиеся скобки
         {
@@ -1007,47 +1436,45 @@ void Parser::skipToSemicolon()  // Пропуск токенов до точки
         advance();
 }
 
-void Parser::showErroneousDescription() // Метод для отображения ошибочного объявления в дереве
+template <class TreeOutput>
+void BasicParser<TreeOutput>::showErroneousDescription() // Метод для отображения ошибочного объявления в дереве
 {
-    output << "      Type: ";
+    tree << blockIndent << "      Type: ";
 
-    if (currentToken.getType() == TokenType::INT || currentToken.getType() == TokenType::DOUBLE)
+    if (inSet(firstSet(NonTerminal::TYPE), currentToken.getType()))
     {
         // Определяем имя типа и выводим с сообщением об ошибке
         string typeName = (currentToken.getType() == TokenType::INT) ? "int" : "double";
-        output << typeName << " <ошибка: после операторов>" << endl;
+        tree << typeName << " <ошибка: после операторов>" << endl;
         advance();
     }
     else
-        output << "<ожидается тип>" << endl;
+        tree << "<ожидается тип>" << endl;
 
-    output << "      VarList" << endl;
+    tree << blockIndent << "      VarList" << endl;
 
     // Полностью обрабатываем список переменных ошибочного объявления
     bool firstVariable = true;
-    while (currentToken.getType() != TokenType::SEMICOLON &&
-        currentToken.getType() != TokenType::END_OF_FILE &&
-        currentToken.getType() != TokenType::RETURN &&
-        currentToken.getType() != TokenType::RBRACE)
+    while (!inSet(SYNC_STATEMENT, currentToken.getType()))
     {
         if (currentToken.getType() == TokenType::ID)    // Обработка идентификатора переменной
         {
             if (!firstVariable)
-                output << "        ," << endl;  // Выводим запятую перед каждой последующей переменной
-            output << "        Id: " << currentToken.getValue() << " <ошибка: после операторов>" << endl;
-            addDeclaredVariable(currentToken.getValue());
+                tree << blockIndent << "        ," << endl;  // Выводим запятую перед каждой последующей переменной
+            tree << blockIndent << "        Id: " << currentToken.getValue() << " <ошибка: после операторов>" << endl;
+            addDeclaredVariable(currentToken);
             advance();              // Пропускаем идентификатор
             firstVariable = false;  // Следующая переменная не будет первой
         }
         else if (currentToken.getType() == TokenType::COMMA)    // Обработка запятой
         {
-            output << "        ," << endl;
+            tree << blockIndent << "        ," << endl;
             advance();  // Пропускаем запятую
 
             if (currentToken.getType() == TokenType::ID)    // Если после запятой идет идентификатор
             {
-                output << "        Id: " << currentToken.getValue() << " <ошибка: после операторов>" << endl;
-                addDeclaredVariable(currentToken.getValue());
+                tree << blockIndent << "        Id: " << currentToken.getValue() << " <ошибка: после операторов>" << endl;
+                addDeclaredVariable(currentToken);
                 advance();
             }
         }
@@ -1055,17 +1482,18 @@ void Parser::showErroneousDescription() // Метод для отображен
             advance();  // Пропускаем непонятные токены
     }
 
-    output << "      ;" << endl;
+    tree << blockIndent << "      ;" << endl;
     if (currentToken.getType() == TokenType::SEMICOLON) // Пропускаем точку с запятой, если есть
         advance();
 }
 
-void Parser::processVariableListForUnknownType()    // Обработка переменных с неизвестным типом
+template <class TreeOutput>
+void BasicParser<TreeOutput>::processVariableListForUnknownType()    // Обработка переменных с неизвестным типом
 {
     if (currentToken.getType() == TokenType::ID)    // Обрабатываем первую переменную
     {
-        output << "        Id: " << currentToken.getValue() << endl;
-        addDeclaredVariable(currentToken.getValue());
+        tree << blockIndent << "        Id: " << currentToken.getValue() << endl;
+        addDeclaredVariable(currentToken);
         addToPostfix(currentToken.getValue());
         advance();  // Пропускаем идентификатор
     }
@@ -1075,7 +1503,7 @@ void Parser::processVariableListForUnknownType()    // Обработка пер
             return;
     }
 
-    int initialLine = currentToken.getLine();
+    int64_t initialLine = currentToken.getLine();
 
     // Обрабатываем остальные переменные через запятую
     while (currentToken.getType() == TokenType::COMMA ||
@@ -1083,13 +1511,13 @@ void Parser::processVariableListForUnknownType()    // Обработка пер
     {
         if (currentToken.getType() == TokenType::COMMA)
         {
-            output << "        ," << endl;
+            tree << blockIndent << "        ," << endl;
             match(TokenType::COMMA, "ожидалась ,");
 
             if (currentToken.getType() == TokenType::ID)
             {
-                output << "        Id: " << currentToken.getValue() << endl;
-                addDeclaredVariable(currentToken.getValue());
+                tree << blockIndent << "        Id: " << currentToken.getValue() << endl;
+                addDeclaredVariable(currentToken);
                 addToPostfix(currentToken.getValue());
                 advance();
             }
@@ -1101,15 +1529,15 @@ void Parser::processVariableListForUnknownType()    // Обработка пер
         }
         else if (currentToken.getType() == TokenType::ID)   // Если идентификатор без запятой
         {
-            output << "        , <отсутствует>" << endl;
-            output << "        Id: " << currentToken.getValue() << endl;
+            tree << blockIndent << "        , <отсутствует>" << endl;
+            tree << blockIndent << "        Id: " << currentToken.getValue() << endl;
 
             Token errorToken = currentToken;
             string errorMsg = "строка " + to_string(errorToken.getLine()) + ", позиция " +
                 to_string(errorToken.getPosition()) + ": отсутствует ',' между переменными";
             errors.push_back(errorMsg);
 
-            addDeclaredVariable(currentToken.getValue());
+            addDeclaredVariable(currentToken);
             addToPostfix(currentToken.getValue());
             advance();  // Пропускаем идентификатор
         }
@@ -1118,17 +1546,9 @@ void Parser::processVariableListForUnknownType()    // Обработка пер
     // Обработка неправильных разделителей
     if (currentToken.getLine() == initialLine)
     {
-        while (currentToken.getLine() == initialLine &&
-            currentToken.getType() != TokenType::COMMA &&
-            currentToken.getType() != TokenType::SEMICOLON &&
-            currentToken.getType() != TokenType::END_OF_FILE &&
-            currentToken.getType() != TokenType::INT &&
-            currentToken.getType() != TokenType::DOUBLE &&
-            currentToken.getType() != TokenType::RETURN &&
-            currentToken.getType() != TokenType::RBRACE &&
-            currentToken.getType() != TokenType::ID)
+        while (currentToken.getLine() == initialLine && !inSet(SYNC_VARLIST, currentToken.getType()))
         {
-            output << "        <неверный разделитель '" << currentToken.getValue() << "'>" << endl;
+            tree << blockIndent << "        <неверный разделитель '" << currentToken.getValue() << "'>" << endl;
             string errorMsg = "строка " + to_string(currentToken.getLine()) + ", позиция " +
                 to_string(currentToken.getPosition()) + ": ожидалась ',' вместо '" + currentToken.getValue() + "'";
             errors.push_back(errorMsg);
@@ -1137,121 +1557,76 @@ void Parser::processVariableListForUnknownType()    // Обработка пер
     }
 }
 
-void Parser::addDeclaredVariable(const string& varName) // Используется для добавления переменных при ошибочных объявлениях
+template <class TreeOutput>
+void BasicParser<TreeOutput>::addDeclaredVariable(const Token& name) // Используется для добавления переменных при ошибочных объявлениях
 {
-    // Создаем токен для переменной
-    Token varToken(TokenType::ID, varName, currentToken.getLine(), currentToken.getPosition());
-
-    if (declaredVariables->contains(varName))   // Проверяем, не объявлена ли переменная ранее
-    {
-        string errorMsg = "строка " + to_string(currentToken.getLine()) +
-            ": повторное объявление переменной '" + varName + "'";
-        errors.push_back(errorMsg);
-    }
-    else
-        declaredVariables->insert(varToken);    // Если переменная не объявлена - добавляем в таблицу
+    addDeclaredVariableWithType(name, SymbolType::UNTYPED);
 }
 
-void Parser::addDeclaredVariableWithType(const string& varName, const string& type) // Используется для добавления переменных, у которых известен тип (int, double)
+template <class TreeOutput>
+void BasicParser<TreeOutput>::addDeclaredVariableWithType(const Token& name, SymbolType type) // Используется для добавления переменных, у которых известен тип (int, double)
 {
-    // Создаем токен для переменной
-    Token varToken(TokenType::ID, varName, currentToken.getLine(), currentToken.getPosition());
+    runSemanticChecks();    // Отложенные проверки должны видеть таблицу до этого объявления
 
-    if (declaredVariables->contains(varName))   // Проверяем, не объявлена ли переменная ранее
+    if (symbols->isDeclaredInCurrentScope(name.getSymbol()))   // Проверяем, не объявлена ли переменная ранее в этом блоке
     {
-        string errorMsg = "строка " + to_string(currentToken.getLine()) +
-            ": повторное объявление переменной '" + varName + "'";
+        string errorMsg = "строка " + to_string(name.getLine()) +
+            ": повторное объявление переменной '" + name.getValue() + "'";
         errors.push_back(errorMsg);
     }
     else
-        declaredVariables->insertWithType(varToken, type);
+    {
+        Declaration& declaration = symbols->declare(name.getSymbol(), type, name.getLine(), name.getPosition());
+        if (declaration.slot < 0)
+            declaration.slot = dataflow.declare(name.getValue(), name.getLine(), name.getPosition());
+    }
 }
 
-// Операнды(переменные, константы) помещаются в стек
-// Операции и функции извлекают операнды из стека, вычисляют тип результата и помещают его обратно
-// В конце в стеке остается тип всего выражения
-string Parser::getExpressionType()  // Определение типа выражения
+template <class TreeOutput>
+void BasicParser<TreeOutput>::semanticCheck(CheckEvent event)
 {
-    if (currentExpression.empty())  // Если текущее выражение пустое, возвращаем неизвестный тип
-        return "unknown";
+    event.prefix = currentExpression.size();
+    event.line = currentToken.getLine();
+    event.errorSlot = errors.size();
 
-    stack<string> typeStack;    // Стек для хранения типов операндов
-
-    for (const auto& token : currentExpression) // Проходим по всем токенам в текущем выражении
+    // Операторы верхнего уровня только читают таблицу - их проверки откладываются.
+    // Внутри блоков таблица меняется при входе и выходе, там проверяем сразу.
+    if (blockDepth == 0 && deferChecks)
     {
-        string tokenType = getVariableType(token);
-        if (!tokenType.empty())                 // Если токен является объявленной переменной
-            typeStack.push(tokenType);
-        else if (isdigit(token[0]))                             // Если токен начинается с цифры - это числовая константа
-        {
-            if (token.find('.') != string::npos) // Проверяем, содержит ли константа точку
-                typeStack.push("double");
-            else
-                typeStack.push("int");
-        }
-        else if (token == "itod")   // Функция itod: берет int из стека, возвращает double
-        {
-            if (!typeStack.empty()) // Для функции должен быть хотя бы один аргумент в стеке
-            {
-                string argType = typeStack.top();   // Извлекаем тип аргумента из вершины стека
-                typeStack.pop();                    // Удаляем аргумент из стека
-                typeStack.push("double");           // Функция itod возвращает double
-            }
-        }
-        else if (token == "dtoi")   // Функция dtoi: берет double из стека, возвращает int
-        {
-            if (!typeStack.empty()) // Для функции должен быть хотя бы один аргумент в стеке
-            {
-                string argType = typeStack.top();   // Извлекаем тип аргумента из вершины стека
-                typeStack.pop();                    // Удаляем аргумент из стека
-                typeStack.push("int");              // Функция dtoi возвращает int
-            }
-        }
-        else if (token == "+" || token == "-") // Если токен - операция сложения или вычитания
-        {
-            if (typeStack.size() >= 2)          // Нужно как минимум два операнда в стеке
-            {
-                string type2 = typeStack.top(); // Правый операнд
-                typeStack.pop();
-                string type1 = typeStack.top(); // Левый операнд
-                typeStack.pop();
-
-                if (type1 == "double" || type2 == "double") // Если хотя бы один операнд имеет тип double, результат - double
-                    typeStack.push("double");
-                else
-                    typeStack.push("int");
-            }
-        }
+        semantic.defer(event);
+        return;
     }
-
-    // Если после обработки всех токенов стек пуст, возвращаем "unknown"
-    // Иначе возвращаем тип результата, оставшийся в вершине стека
-    return typeStack.empty() ? "unknown" : typeStack.top();
+    string diagnostic = SemanticPass::check(event, currentTypes, *symbols, importedFunctions);
+    if (!diagnostic.empty())
+        errors.push_back(diagnostic);
 }
 
-void Parser::checkAssignmentType(const string& varName, const string& exprType) // Проверка соответствия типов в операции присваивания
+template <class TreeOutput>
+void BasicParser<TreeOutput>::runSemanticChecks()
 {
-    string varType = getVariableType(varName);
-    if (varType.empty())
-        return; // Переменная не найдена
+    if (!semantic.hasPending())
+        return;
+    TRACE_SCOPE("typecheck");
+    semantic.run(currentExpression, *symbols, importedFunctions, errors, parseThreads);
+}
 
-    // Сравниваем тип переменной (левая часть присваивания) с типом выражения (правая часть присваивания)
-    if (varType != exprType)
-    {
-        string errorMsg = "строка " + to_string(currentToken.getLine()) +
-            ": несоответствие типов в присваивании '" + varName +
-            "' (" + varType + ") = выражение (" + exprType + ")";
-        errors.push_back(errorMsg);
-    }
+template <class TreeOutput>
+void BasicParser<TreeOutput>::checkAssignmentType(const Token& varToken) // Проверка соответствия типов в операции присваивания
+{
+    CheckEvent event = { CheckKind::ASSIGNMENT, varToken.getValue() };
+    event.symbol = varToken.getSymbol();
+    semanticCheck(event);
 }
 
-void Parser::checkFunctionReturnType(const string& returnVar)
+template <class TreeOutput>
+void BasicParser<TreeOutput>::checkFunctionReturnType(const Token& returnVar)
 {
-    string returnType = getVariableType(returnVar);
+    const Declaration* declaration = symbols->lookup(returnVar.getSymbol());
+    string returnType = declaration != nullptr ? SymbolTable::typeName(declaration->type) : "";
     if (returnType.empty())
     {
         string errorMsg = "строка " + to_string(currentToken.getLine()) +
-            ": переменная возврата '" + returnVar + "' не объявлена";
+            ": переменная возврата '" + returnVar.getValue() + "' не объявлена";
         errors.push_back(errorMsg);
         return;
     }
@@ -1265,23 +1640,54 @@ void Parser::checkFunctionReturnType(const string& returnVar)
     }
 }
 
-void Parser::processFunctionCall(const string& funcName)    // Проверка вызова функции на корректность имени
+template <class TreeOutput>
+void BasicParser<TreeOutput>::addToPostfix(const string& token)  // Добавление токена в постфиксную запись
 {
-    if (funcName != "itod" && funcName != "dtoi")   // Проверяем, является ли имя функции одним из разрешенных
+    postfixCode.push_back({ token, false });
+}
+
+template <class TreeOutput>
+void BasicParser<TreeOutput>::addCommand(const char* command)
+{
+    postfixCode.push_back({ command, true });
+}
+
+template <class TreeOutput>
+vector<string> BasicParser<TreeOutput>::getPostfix() const
+{
+    vector<string> commands;
+    commands.reserve(postfixCode.size());
+    for (const PostfixToken& token : postfixCode)
+        commands.push_back(token.text);
+    return commands;
+}
+
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::buildIr(IrFunction& function, string& error) const
+{
+    if (!errors.empty())
     {
-        string errorMsg = "строка " + to_string(currentToken.getLine()) +
-            ": вызов неизвестной функции '" + funcName + "'";
-        errors.push_back(errorMsg);
+        error = "программа содержит ошибки";
+        return false;
     }
+    return ::buildIr(postfixCode, declarationEnds, importedFunctions, *symbols, currentFunctionName, currentFunctionType, function, error);
 }
 
-void Parser::addToPostfix(const string& token)  // Добавление токена в постфиксную запись
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::getExport(FunctionSignature& signature) const
 {
-    postfixCode.push_back(token);
+    if (!errors.empty() || currentFunctionName.empty())
+        return false;
+    signature.name = currentFunctionName;
+    signature.returnType = currentFunctionType == "double" ? ValueType::DOUBLE : ValueType::INT;
+    signature.params = parameterTypes;
+    return true;
 }
 
-void Parser::generatePostfix()
+template <class TreeOutput>
+void BasicParser<TreeOutput>::generatePostfix()
 {
+    TRACE_SCOPE("generatePostfix");
     output << endl << "=== ПОСТФИКСНАЯ ЗАПИСЬ ===" << endl;
 
     if (postfixCode.empty())
@@ -1298,12 +1704,15 @@ void Parser::generatePostfix()
     vector<string> currentLine; // Вектор для накопления токенов текущей строки вывода
     bool inDeclaration = false; // Флаг, указывающий, что мы находимся внутри объявления переменных
     int varCount = 0;           // Счетчик переменных в текущем объявлении
+    size_t nextDeclaration = 0; // Номер следующего объявления в declarationEnds
+    size_t declarationEnd = 0;  // Индекс в postfixCode за концом текущего объявления
 
     for (size_t i = 0; i < postfixCode.size(); ++i)
     {
-        const string& token = postfixCode[i];   // Получаем текущий токен по индексу
+        const string& token = postfixCode[i].text;  // Получаем текущий токен по индексу
+        bool command = postfixCode[i].command;      // Служебное слово, а не имя из текста
 
-        if (token == "DECLARE") // Проверяем, является ли токен началом объявления
+        if (command && token == "DECLARE") // Проверяем, является ли токен началом объявления
         {
             if (!currentLine.empty())   // Если уже накопили какую-то строку, выводим ее
             {
@@ -1325,6 +1734,14 @@ void Parser::generatePostfix()
 
             inDeclaration = true;   // Начинаем новое объявление
             varCount = 0;
+            declarationEnd = nextDeclaration < declarationEnds.size() ? declarationEnds[nextDeclaration++] : i + 1;
+        }
+        else if (token == "{" || token == "}")  // Границы блока выводятся отдельной строкой
+        {
+            for (size_t j = 0; j < currentLine.size(); ++j)
+                output << currentLine[j] << " ";
+            output << token << endl;
+            currentLine.clear();
         }
         else if (inDeclaration) // Если находимся внутри объявления
         {
@@ -1336,33 +1753,26 @@ void Parser::generatePostfix()
                 varCount++; // Увеличиваем счетчик переменных
             }
 
-            if (i + 1 < postfixCode.size()) // Проверяем, не закончилось ли объявление
+            // Граница объявления известна из разбора: по следующему токену ее не отличить
+            // от выражения, которое начинается с имени переменной
+            if (i + 1 < postfixCode.size() && i + 1 >= declarationEnd)
             {
-                string nextToken = postfixCode[i + 1];
-                // Объявление считается законченным, если следующий токен:
-                // 1. Новое DECLARE (начало следующего объявления)
-                // 2. RETURN (конец функции)
-                // 3. "=" (начало операции присваивания)
-                // 4. Число (начало выражения)
-                if (nextToken == "DECLARE" || nextToken == "RETURN" || nextToken == "=" || isdigit(nextToken[0]))
-                {
-                    currentLine.push_back(to_string(varCount + 1));
-                    currentLine.push_back("DECL");
+                currentLine.push_back(to_string(varCount + 1));
+                currentLine.push_back("DECL");
 
-                    for (size_t j = 0; j < currentLine.size(); ++j) // Вывод завершенного объявления
-                    {
-                        output << currentLine[j];
-                        if (j < currentLine.size() - 1)
-                            output << " ";
-                    }
-                    output << endl;
-                    currentLine.clear();
-                    inDeclaration = false;
-                    varCount = 0;
+                for (size_t j = 0; j < currentLine.size(); ++j) // Вывод завершенного объявления
+                {
+                    output << currentLine[j];
+                    if (j < currentLine.size() - 1)
+                        output << " ";
                 }
+                output << endl;
+                currentLine.clear();
+                inDeclaration = false;
+                varCount = 0;
             }
         }
-        else if (token == "=" || token == "RETURN")
+        else if (token == "=" || (command && (token == "RETURN" || token == "PARAM" || token == "IMPORT")))
         {
             currentLine.push_back(token);   // Добавляем завершающий токен операции к строке
             for (size_t j = 0; j < currentLine.size(); ++j) // Вывод завершенной операции
@@ -1396,53 +1806,64 @@ void Parser::generatePostfix()
     }
 }
 
-void Parser::completeExpression()   // Завершение обработки текущего выражения
+template <class TreeOutput>
+void BasicParser<TreeOutput>::completeExpression()   // Завершение обработки текущего выражения
 {
+    semantic.archiveExpression(currentExpression);  // Отложенным проверкам выражение еще нужно
     currentExpression.clear();
+    currentTypes.reset(&currentExpression);
+}
+
+template <class TreeOutput>
+bool BasicParser<TreeOutput>::isVariableDeclared(const Token& name)  // Проверка, была ли переменная объявлена ранее
+{
+    return symbols->isDeclared(name.getSymbol());
 }
 
-bool Parser::isVariableDeclared(const string& varName)  // Проверка, была ли переменная объявлена ранее
+template <class TreeOutput>
+void BasicParser<TreeOutput>::useVariable(const Token& name)
 {
-    return declaredVariables->contains(varName);
+    const Declaration* declaration = symbols->lookup(name.getSymbol());
+    if (declaration != nullptr && dataflowLog != nullptr)
+        dataflowLog->push_back({ declaration->slot, name.getLine(), name.getPosition(), false });
+    else if (declaration != nullptr)
+        dataflow.use(declaration->slot, name.getLine(), name.getPosition());
 }
 
-void Parser::clearDeclaredVariables()   // Очистка данных
+template <class TreeOutput>
+void BasicParser<TreeOutput>::assignVariable(const Token& name)
 {
-    declaredVariables->clear();
+    const Declaration* declaration = symbols->lookup(name.getSymbol());
+    if (declaration != nullptr && dataflowLog != nullptr)
+        dataflowLog->push_back({ declaration->slot, 0, 0, true });
+    else if (declaration != nullptr)
+        dataflow.assign(declaration->slot);
+}
+
+template <class TreeOutput>
+void BasicParser<TreeOutput>::clearDeclaredVariables()   // Очистка данных
+{
+    symbols->clearDeclarations();
 }
 
 // Проверка соответствия типа аргумента, передаваемого в функцию преобразования
-void Parser::checkFunctionArgumentType(const string& funcName, const string& argType)
+template <class TreeOutput>
+void BasicParser<TreeOutput>::checkFunctionArgumentType(const string& funcName)
 {
-    if (funcName == "itod")     // Проверяем, является ли функция функцией itod
-    {
-        if (argType != "int")   // Функция itod ожидает аргумент типа int
-        {
-            string errorMsg = "строка " + to_string(currentToken.getLine()) +
-                ": функция 'itod' ожидает аргумент типа 'int', получен '" + argType + "'";
-            errors.push_back(errorMsg);
-        }
-    }
-    else if (funcName == "dtoi")
-    {
-        if (argType != "double")
-        {
-            string errorMsg = "строка " + to_string(currentToken.getLine()) +
-                ": функция 'dtoi' ожидает аргумент типа 'double', получен '" + argType + "'";
-            errors.push_back(errorMsg);
-        }
-    }
+    CheckEvent event = { CheckKind::FUNCTION_ARGUMENT, funcName };
+    semanticCheck(event);
 }
 
 // Проверка совместимости типов операндов в бинарной операции
-void Parser::checkBinaryOperationTypes(const string& leftType, const string& rightType, const string& op)
+template <class TreeOutput>
+void BasicParser<TreeOutput>::checkBinaryOperationTypes(const string& op, size_t leftPrefix)
 {
-    // Если типы разные - это неявное преобразование
-    if (leftType != rightType && leftType != "unknown" && rightType != "unknown")
-    {
-        string errorMsg = "строка " + to_string(currentToken.getLine()) +
-            ": неявное преобразование типов в операции '" + op +
-            "' между " + leftType + " и " + rightType;
-        errors.push_back(errorMsg);
-    }
-}
\ No newline at end of file
+    CheckEvent event = { CheckKind::BINARY_OPERATION, op };
+    event.leftPrefix = leftPrefix;
+    semanticCheck(event);
+}
+
+// Явное инстанцирование для всех политик вывода дерева
+template class BasicParser<TextTreeOutput>;
+template class BasicParser<JsonTreeOutput>;
+template class BasicParser<NullTreeOutput>;
\ No newline at end of file
@@ -2,7 +2,14 @@
 #define PARSER_H
 
 #include "Lexer.h"
-#include "HashTable.h"
+#include "SymbolTable.h"
+#include "Grammar.h"
+#include "TreeOutput.h"
+#include "SemanticPass.h"
+#include "Ir.h"
+#include "Interface.h"
+#include "Dataflow.h"
+#include "ResourceBudget.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -11,27 +18,38 @@
 
 using namespace std;
 
-class Parser {
+//  TreeOutput -     (. TreeOutput.h).
+//  ,        output.
+template <class TreeOutput>
+class BasicParser {
 private:
     Lexer& lexer;
-    ofstream& output;
+    ostream& output;
+    TreeOutput tree;        //   
     Token currentToken;
     Token lastProcessedToken;
     Token lastValidToken; 
     vector<string> errors;
-    HashTable* declaredVariables;
+    vector<string> warnings;    //   
+    SymbolTable* symbols;   //     -    
+    InterfaceLibrary* interfaces;   //    import (nullptr -  )
 
     void advance();
     bool match(TokenType expectedType, const string& errorMsg);
     void error(const string& message);
 
     void function();
+    void imports();
+    void importModule();
+    void callImported(const string& funcName, int indentLevel);
     void descriptions();
+    DescrRecovery descrRecovery();  //    Id   
     void operators();
     void descr();
-    void varlist(const string& varType = "");
+    void varlist(SymbolType varType = SymbolType::UNTYPED);
     void type();
     void op();
+    void block();
     void expr(int indentLevel = 0);
     void simpleExpr(int indentLevel = 0);
     void skipToSemicolon();
@@ -39,41 +57,80 @@ private:
     void showErroneousDescription();
     void processVariableListForUnknownType();
     bool begin();
+    void params();
+    void param();
     bool end();
 
     Token peekNextToken() { return lexer.peekNextToken(); }
 
-    void addDeclaredVariable(const string& name); //      .
-    bool isVariableDeclared(const string& name); // ,     .
+    void addDeclaredVariable(const Token& name); //      .
+    bool isVariableDeclared(const Token& name); // ,     .
     void clearDeclaredVariables();
+    void useVariable(const Token& name);       //    -    
+    void assignVariable(const Token& name);    //  
 
     //    
     string currentFunctionType;         //   
     string currentFunctionName;         //   
-    vector<string> postfixCode;         //  
-    vector<string> currentExpression;   //    
+    vector<PostfixToken> postfixCode;   //  
+    vector<size_t> declarationEnds;     //   postfixCode,    
+    Expression currentExpression;       //    
+    vector<ValueType> parameterTypes;   //    -   
+    vector<string> importedModules;     //    import
+    FunctionTable importedFunctions;    //   
+    int blockDepth;                     //    { }
+    Indent blockIndent;                 //     
+    SemanticPass semantic;              //      
+    PrefixTypes currentTypes;           //   currentExpression -    
+    DataflowPass dataflow;              //      
+
+    //       
+    unsigned parseThreads;              //      (1 -  )
+    size_t parallelScanEnd;             //         
+    bool deferChecks;                   //     (   )
+    vector<DataflowEvent>* dataflowLog; // :    -   
+
+    const ResourceBudget* budget;       //   (nullptr -  )
+    unsigned nesting;                   //  :    
+    StackLimit stack;                   //     ,   
+    uint64_t steps;                     //   -     CHECK_INTERVAL
+    bool aborted;                       //  :  
+
+    bool parallelStatements();          //      return    
+
+    template <class> friend class BasicParser;  //      
+
+    void semanticCheck(CheckEvent event);   //     
+    void runSemanticChecks();               //      
 
 public:
-    Parser(Lexer& l, ofstream& out, HashTable* varsTable);
+    BasicParser(Lexer& l, ostream& out, SymbolTable* table, InterfaceLibrary* library = nullptr);
     bool parse();
+    void setParseThreads(unsigned threads) { parseThreads = threads; }
+    void setBudget(const ResourceBudget* analysisBudget) { budget = analysisBudget; }
 
     //    
-    void addDeclaredVariableWithType(const string& varName, const string& type);
+    void addDeclaredVariableWithType(const Token& name, SymbolType type);
     void generatePostfix();
-    string getExpressionType();
-    void checkAssignmentType(const string& varName, const string& exprType);
-    void checkFunctionReturnType(const string& returnVar);
-    void processFunctionCall(const string& funcName);
+    void checkAssignmentType(const Token& varToken);
+    void checkFunctionReturnType(const Token& returnVar);
     void completeExpression();
-    void checkFunctionArgumentType(const string& funcName, const string& argType);
-    void checkBinaryOperationTypes(const string& leftType, const string& rightType, const string& op);
+    void checkFunctionArgumentType(const string& funcName);
+    void checkBinaryOperationTypes(const string& op, size_t leftPrefix);
 
     //      
     void addToPostfix(const string& token);
-    string getVariableType(const string& varName) const
-    {
-        return declaredVariables->getVariableType(varName);
-    }
+    void addCommand(const char* command);   //   : DECLARE, PARAM, IMPORT, CALL, RETURN
+    bool buildIr(IrFunction& function, string& error) const;   // IR     
+    bool getExport(FunctionSignature& signature) const;         //    
+
+    //     -  
+    const vector<string>& getErrors() const { return errors; }
+    const vector<string>& getWarnings() const { return warnings; }
+    vector<string> getPostfix() const;  //     
+    bool isAborted() const { return aborted; }
 };
 
+typedef BasicParser<TextTreeOutput> Parser;     //   -    
+
 #endif
\ No newline at end of file
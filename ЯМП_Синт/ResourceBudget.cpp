@@ -0,0 +1,105 @@
+﻿#include "ResourceBudget.h"
+#include <sstream>
+#include <locale>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#endif
+
+ResourceBudget::ResourceBudget(const ResourceLimits& budgetLimits)
+    : limits(budgetLimits), tokens(0), symbols(0), fixedBytes(0), symbolBytes(0), tokenBytes(0)
+{
+    if (limits.seconds > 0)
+        deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(limits.seconds));
+    nextCheck = limits.tokens != 0 ? min(CHECK_INTERVAL, limits.tokens + 1) : CHECK_INTERVAL;
+}
+
+void ResourceBudget::exceeded(const string& what, const string& limit) const
+{
+    throw BudgetExceeded("анализ прерван: " + what + " (" + limit + ")");
+}
+
+void ResourceBudget::checkpoint()
+{
+    if (limits.tokens != 0 && tokens > limits.tokens)
+        exceeded("превышено число лексем", to_string(limits.tokens));
+    checkTime();
+    if (limits.bytes != 0 && usedBytes() > limits.bytes)
+        exceeded("превышен объем памяти", to_string(limits.bytes) + " байт");
+
+    nextCheck = tokens + CHECK_INTERVAL;
+    if (limits.tokens != 0)
+        nextCheck = min(nextCheck, limits.tokens + 1);
+}
+
+void ResourceBudget::charge(uint64_t bytes)
+{
+    fixedBytes += bytes;
+    if (limits.bytes != 0 && usedBytes() > limits.bytes)
+        exceeded("превышен объем памяти", to_string(limits.bytes) + " байт");
+}
+
+void ResourceBudget::addSymbol(size_t bytes)
+{
+    symbols++;
+    symbolBytes += bytes;
+    if (limits.symbols != 0 && symbols > limits.symbols)
+        exceeded("превышено число различных лексем", to_string(limits.symbols));
+    if (limits.bytes != 0 && usedBytes() > limits.bytes)
+        exceeded("превышен объем памяти", to_string(limits.bytes) + " байт");
+}
+
+// Нижняя граница стека текущего потока или 0, если ее не узнать. Запрос дорогой
+// (для главного потока glibc читает /proc/self/maps), а граница не меняется - один раз на поток.
+static uintptr_t queryStackLow()
+{
+    uintptr_t low = 0;
+#ifdef _WIN32
+    ULONG_PTR stackLow, stackHigh;
+    GetCurrentThreadStackLimits(&stackLow, &stackHigh);
+    low = stackLow;
+#elif defined(__linux__)
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) == 0)
+    {
+        void* address;
+        size_t size;
+        if (pthread_attr_getstack(&attributes, &address, &size) == 0)
+            low = (uintptr_t)address;
+        pthread_attr_destroy(&attributes);
+    }
+#endif
+    return low;
+}
+
+StackLimit::StackLimit()
+{
+    thread_local uintptr_t threadStackLow = queryStackLow();
+    char frame;
+    uintptr_t top = (uintptr_t)&frame;
+    uintptr_t low = threadStackLow;
+    if (low == 0 || low >= top)
+        low = top > UNKNOWN_STACK ? top - UNKNOWN_STACK : 0;
+    floor = top - low > RESERVE ? low + RESERVE : top;  // Стека почти нет - глубже не идем вовсе
+}
+
+void StackLimit::exceeded(unsigned depth)
+{
+    throw BudgetExceeded("анализ прерван: превышена глубина вложенности (" + to_string(depth) +
+        ", предел стека потока)");
+}
+
+void ResourceBudget::checkTime() const
+{
+    if (limits.seconds > 0 && chrono::steady_clock::now() > deadline)
+    {
+        ostringstream seconds;
+        seconds.imbue(locale::classic());
+        seconds << limits.seconds << " с";
+        exceeded("превышено время анализа", seconds.str());
+    }
+}
@@ -0,0 +1,125 @@
+﻿#ifndef RESOURCEBUDGET_H
+#define RESOURCEBUDGET_H
+
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+struct ResourceLimits       // Ограничения одного анализа; 0 - без ограничения
+{
+    double seconds;         // Время анализа от создания бюджета
+    uint64_t tokens;        // Лексем в тексте
+    unsigned depth;         // Глубина вложенности разбора: блоки, скобки и вызовы
+    uint64_t symbols;       // Различных лексем (записей таблицы символов)
+    uint64_t bytes;         // Память под текст, поток токенов и таблицу символов
+
+    ResourceLimits() : seconds(0), tokens(0), depth(0), symbols(0), bytes(0) {}
+
+    bool any() const { return seconds > 0 || tokens != 0 || depth != 0 || symbols != 0 || bytes != 0; }
+};
+
+class BudgetExceeded : public runtime_error     // Анализ прерван: текст - диагностика для отчета
+{
+public:
+    explicit BudgetExceeded(const string& message) : runtime_error(message) {}
+};
+
+// Бюджет одного анализа текста, которому нельзя доверять. Счетчики лексем и символов
+// меняет только поток, читающий лексемы (через таблицу символов), поэтому они не атомарные.
+// На каждую лексему - одно сравнение с ближайшей контрольной точкой; время и память
+// проверяются в контрольных точках раз в CHECK_INTERVAL лексем. Разбор проверяет время
+// с той же частотой по своему счетчику - так его могут проверять и потоки фрагментов.
+// При превышении бросается BudgetExceeded; разбор ловит его и завершается с ошибкой.
+// Память считается по тому, что растет с текстом: сам текст, поток токенов, записи и тексты
+// лексем. Постфиксная запись пропорциональна числу лексем, дерево - числу лексем и глубине;
+// они ограничены через эти пределы.
+class ResourceBudget
+{
+private:
+    ResourceLimits limits;
+    chrono::steady_clock::time_point deadline;
+    uint64_t tokens;
+    uint64_t nextCheck;     // Номер лексемы следующей контрольной точки
+    uint64_t symbols;
+    uint64_t fixedBytes;    // Текст и прочее, учтенное через charge
+    uint64_t symbolBytes;
+    size_t tokenBytes;      // Память потока токенов на одну лексему
+
+    void checkpoint();
+    [[noreturn]] void exceeded(const string& what, const string& limit) const;
+
+public:
+    static constexpr uint64_t CHECK_INTERVAL = 4096;   // Степень двойки - для проверки маской
+
+    explicit ResourceBudget(const ResourceLimits& budgetLimits);
+
+    const ResourceLimits& getLimits() const { return limits; }
+    uint64_t usedBytes() const { return fixedBytes + tokens * tokenBytes + symbolBytes; }
+
+    void setTokenBytes(size_t bytes) { tokenBytes = bytes; }
+    void charge(uint64_t bytes);                // Память, не связанная с отдельными лексемами
+
+    void countToken()                           // Очередная лексема текста
+    {
+        if (++tokens >= nextCheck)
+            checkpoint();
+    }
+    void addSymbol(size_t bytes);               // Новая различная лексема и ее память
+    void checkTime() const;                     // Можно вызывать из любого потока
+    void checkDepth(unsigned depth) const
+    {
+        if (limits.depth != 0 && depth > limits.depth)
+            exceeded("превышена глубина вложенности", to_string(limits.depth));
+    }
+};
+
+// Предел рекурсии по стеку потока - действует всегда, даже без ограничений анализа.
+// Граница берется из настоящего стека того потока, где создан объект (главный поток,
+// поток фрагмента, поток вызывающей программы; в MSVC это обычно 1 МБ), а проверяется
+// по адресу текущего кадра - так учитывается реальный размер кадров каждой политики
+// дерева и каждой сборки, а не оценка. Запас RESERVE остается на вывод ошибки и раскрутку.
+class StackLimit
+{
+private:
+    uintptr_t floor;        // Адрес, ниже которого рекурсия не опускается (стек растет вниз)
+
+public:
+    static const size_t RESERVE = 128 * 1024;
+    static const size_t UNKNOWN_STACK = 512 * 1024;    // Если границу стека узнать нельзя
+
+    StackLimit();
+
+    void check(unsigned depth) const
+    {
+        char frame;
+        if ((uintptr_t)&frame < floor)
+            exceeded(depth);
+    }
+    [[noreturn]] static void exceeded(unsigned depth);
+};
+
+// Уровень рекурсии на время разбора конструкции. Превышение проверяется до входа,
+// так что прерванный разбор не оставляет счетчик увеличенным.
+class NestingGuard
+{
+private:
+    unsigned& depth;
+
+public:
+    NestingGuard(unsigned& counter, const ResourceBudget* budget, const StackLimit& stack) : depth(counter)
+    {
+        stack.check(depth + 1);
+        if (budget != nullptr)
+            budget->checkDepth(depth + 1);
+        depth++;
+    }
+    ~NestingGuard() { depth--; }
+
+    NestingGuard(const NestingGuard&) = delete;
+    NestingGuard& operator=(const NestingGuard&) = delete;
+};
+
+#endif
@@ -0,0 +1,176 @@
+﻿#include "ResultCache.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static const char* const CACHE_MAGIC = "ANALIZATOR-CACHE";  // Сигнатура в начале файла кеша
+
+ResultCache::ResultCache(const string& dir) : directory(dir), enabled(true)
+{
+    error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec)
+        enabled = false;    // Без каталога работаем без кеша
+}
+
+uint64_t ResultCache::hashContent(const string& content)
+{
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;     // Мультипликативная константа (золотое сечение)
+    uint64_t hash = content.size() * multiplier;
+    const char* data = content.data();
+    size_t size = content.size();
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8)   // Основной цикл - по 8 байт за шаг
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = ((hash << 5) | (hash >> 59)) ^ word;
+        hash *= multiplier;
+    }
+
+    uint64_t tail = 0;              // Оставшиеся 0..7 байт
+    memcpy(&tail, data + i, size - i);
+    hash = ((hash << 5) | (hash >> 59)) ^ tail;
+    hash *= multiplier;
+
+    hash ^= hash >> 32;             // Перемешивание, чтобы все биты зависели от входа
+    hash *= multiplier;
+    return hash ^ (hash >> 29);
+}
+
+// Путь к исполняемому файлу текущего процесса, пустой - если система его не сообщает
+static string executablePath()
+{
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    return length > 0 && length < MAX_PATH ? string(path, length) : string();
+#elif defined(__linux__)
+    return "/proc/self/exe";
+#else
+    return string();
+#endif
+}
+
+const string& ResultCache::analyzerVersion()
+{
+    static const string version = []
+    {
+        MappedFile image;
+        string path = executablePath();
+        uint64_t hash = !path.empty() && image.open(path)
+            ? hashContent(string(image.getData(), image.getSize()))
+            : hashContent(__DATE__ " " __TIME__);   // Образ недоступен - хотя бы время сборки этого файла
+        ostringstream text;
+        text << hex << hash;
+        return text.str();
+    }();
+    return version;
+}
+
+uint64_t ResultCache::makeKey(const string& content, const string& options)
+{
+    uint64_t key = hashContent(content);
+    key ^= hashContent(analyzerVersion() + '\n' + options) + 0x9E3779B97F4A7C15ull + (key << 6) + (key >> 2);
+    return key;
+}
+
+string ResultCache::pathForKey(uint64_t key) const
+{
+    ostringstream name;
+    name << hex;
+    name.width(16);
+    name.fill('0');
+    name << key;
+    return (fs::path(directory) / (name.str() + ".cache")).string();
+}
+
+// Читает из file ровно expected.size() байт и сравнивает с expected
+static bool readSame(ifstream& file, const string& expected)
+{
+    string stored(expected.size(), '\0');
+    return (expected.empty() || file.read(&stored[0], stored.size())) && stored == expected;
+}
+
+bool ResultCache::lookup(uint64_t key, const string& content, const string& options, CachedResult& result) const
+{
+    if (!enabled)
+        return false;
+
+    ifstream file(pathForKey(key), ios::binary);
+    if (!file.is_open())
+        return false;   // Промах
+
+    // Заголовок: сигнатура, версия, ключ, итог анализа, длины опций, входа и отчета
+    string magic, version;
+    uint64_t storedKey = 0;
+    int correct = 0;
+    size_t optionsSize = 0, contentSize = 0, size = 0;
+    file >> magic >> version >> hex >> storedKey >> dec >> correct >> optionsSize >> contentSize >> size;
+    if (!file || magic != CACHE_MAGIC || version != analyzerVersion() || storedKey != key)
+        return false;   // Чужой или поврежденный файл считаем промахом
+    if (optionsSize != options.size() || contentSize != content.size())
+        return false;   // Коллизия хеша: другой вход с тем же ключом
+    file.get();         // Перевод строки после заголовка
+    if (!readSame(file, options) || !readSame(file, content))
+        return false;
+
+    string output(size, '\0');
+    if (size > 0 && !file.read(&output[0], size))
+        return false;   // Файл обрезан
+
+    result.syntaxCorrect = correct != 0;
+    result.output = move(output);
+    return true;
+}
+
+void ResultCache::store(uint64_t key, const string& content, const string& options, const CachedResult& result) const
+{
+    if (!enabled)
+        return;
+
+    // Сначала пишем во временный файл с уникальным именем, затем атомарно переименовываем.
+    // Так параллельные процессы и потоки никогда не видят частично записанный файл.
+    static atomic<unsigned> counter(0);
+    string finalPath = pathForKey(key);
+    ostringstream tempName;
+    tempName << finalPath << ".tmp." << hash<thread::id>()(this_thread::get_id()) << "."
+        << chrono::steady_clock::now().time_since_epoch().count() << "." << counter++;
+    string tempPath = tempName.str();
+
+    {
+        ofstream file(tempPath, ios::binary | ios::trunc);
+        if (!file.is_open())
+            return;
+        file << CACHE_MAGIC << " " << analyzerVersion() << " " << hex << key << dec << " "
+            << (result.syntaxCorrect ? 1 : 0) << " " << options.size() << " " << content.size() << " "
+            << result.output.size() << "\n";
+        file.write(options.data(), options.size());
+        file.write(content.data(), content.size());
+        file.write(result.output.data(), result.output.size());
+        if (!file)
+        {
+            file.close();
+            error_code ec;
+            fs::remove(tempPath, ec);
+            return;
+        }
+    }
+
+    error_code ec;
+    fs::rename(tempPath, finalPath, ec);    // Если другой процесс уже записал тот же ключ - содержимое совпадает
+    if (ec)
+        fs::remove(tempPath, ec);
+}
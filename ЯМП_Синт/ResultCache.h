@@ -0,0 +1,46 @@
+﻿#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+struct CachedResult         // Сохраненный результат анализа одного входного файла
+{
+    bool syntaxCorrect;     // Итог анализа
+    string output;          // Полный текст отчета: хеш-таблица, дерево, постфикс, ошибки
+
+    CachedResult() : syntaxCorrect(false) {}
+};
+
+// Кеш результатов на диске с адресацией по содержимому.
+// Ключ - хеш текста программы вместе с версией анализатора и опциями,
+// поэтому побайтно совпадающий вход не лексируется и не разбирается повторно.
+// Хеш только выбирает файл: запись хранит сам вход и опции, и попадание
+// засчитывается лишь при их полном совпадении.
+class ResultCache
+{
+private:
+    string directory;       // Каталог с файлами кеша
+    bool enabled;           // Кеш отключен, если каталог не удалось создать
+
+    string pathForKey(uint64_t key) const;
+
+public:
+    explicit ResultCache(const string& dir);
+
+    static uint64_t hashContent(const string& content);     // Быстрый хеш содержимого (по 8 байт за шаг)
+    static uint64_t makeKey(const string& content, const string& options);
+
+    // Версия - хеш образа исполняемого файла анализатора: любая пересборка
+    // с другим кодом делает старые записи промахами без ручного учета версий
+    static const string& analyzerVersion();
+
+    // true - попадание в кеш; content и options - те же, что при makeKey
+    bool lookup(uint64_t key, const string& content, const string& options, CachedResult& result) const;
+    void store(uint64_t key, const string& content, const string& options, const CachedResult& result) const;
+    bool isEnabled() const { return enabled; }
+};
+
+#endif
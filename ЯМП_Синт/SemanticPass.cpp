@@ -0,0 +1,216 @@
+﻿#include "SemanticPass.h"
+#include "Trace.h"
+#include <stack>
+#include <thread>
+#include <algorithm>
+
+static const size_t CHECKS_PER_THREAD = 512;    // Меньше проверок на поток - дешевле без потоков
+
+static SymbolType symbolType(ValueType type)
+{
+    return type == ValueType::INT ? SymbolType::INT : SymbolType::DOUBLE;
+}
+
+// Очередная лексема выражения: меняет стек типов операндов
+static void applyToken(const Expression& expression, size_t i, size_t count, vector<SymbolType>& typeStack,
+    const SymbolTable& symbols, const FunctionTable& imports)
+{
+    int handle = expression[i];
+    if (i + 1 < count && expression[i + 1] == CALL_MARKER)  // Имя вызываемой функции - тип дает CALL
+        return;
+    if (handle == CALL_MARKER)  // Вызов: снимает аргументы, кладет тип результата
+    {
+        auto callee = imports.find(*symbols.at(expression[i - 1]).text);
+        if (callee == imports.end())
+            return;
+        for (size_t p = 0; p < callee->second.params.size() && !typeStack.empty(); p++)
+            typeStack.pop_back();
+        typeStack.push_back(symbolType(callee->second.returnType));
+        return;
+    }
+
+    switch (symbols.at(handle).kind)
+    {
+    case TokenType::ID:         // Тип объявленной переменной, видимой в этом месте
+    {
+        const Declaration* declaration = symbols.lookup(handle);
+        if (declaration != nullptr && declaration->type != SymbolType::UNTYPED)
+            typeStack.push_back(declaration->type);
+        break;
+    }
+    case TokenType::INT_NUM:
+        typeStack.push_back(SymbolType::INT);
+        break;
+    case TokenType::DOUBLE_NUM:
+        typeStack.push_back(SymbolType::DOUBLE);
+        break;
+    case TokenType::ITOD:       // Функция itod: берет int из стека, возвращает double
+    case TokenType::DTOI:       // Функция dtoi: берет double из стека, возвращает int
+        if (!typeStack.empty())
+            typeStack.back() = symbols.at(handle).kind == TokenType::ITOD ? SymbolType::DOUBLE : SymbolType::INT;
+        break;
+    case TokenType::PLUS:
+    case TokenType::MINUS:
+        if (typeStack.size() >= 2)          // Нужно как минимум два операнда в стеке
+        {
+            SymbolType right = typeStack.back();
+            typeStack.pop_back();
+            // Если хотя бы один операнд имеет тип double, результат - double
+            if (right == SymbolType::DOUBLE)
+                typeStack.back() = SymbolType::DOUBLE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void PrefixTypes::reset(const Expression* checked)
+{
+    expression = checked;
+    typeStack.clear();
+    tops.assign(1, SymbolType::UNTYPED);
+}
+
+string PrefixTypes::typeOf(size_t count, const SymbolTable& symbols, const FunctionTable& imports)
+{
+    // Префикс проверки не разрывает пару "имя, CALL_MARKER" - продолжение прохода дает тот же стек
+    for (size_t i = tops.size() - 1; i < count; i++)
+    {
+        applyToken(*expression, i, count, typeStack, symbols, imports);
+        tops.push_back(typeStack.empty() ? SymbolType::UNTYPED : typeStack.back());
+    }
+    return tops[count] == SymbolType::UNTYPED ? "unknown" : SymbolTable::typeName(tops[count]);
+}
+
+string SemanticPass::check(const CheckEvent& event, PrefixTypes& types, const SymbolTable& symbols,
+    const FunctionTable& imports)
+{
+    string exprType = types.typeOf(event.prefix, symbols, imports);
+
+    switch (event.kind)
+    {
+    case CheckKind::ASSIGNMENT:
+    {
+        const Declaration* declaration = symbols.lookup(event.symbol);
+        string varType = declaration != nullptr ? SymbolTable::typeName(declaration->type) : "";
+        if (varType.empty() || varType == exprType) // Переменная не найдена или типы совпадают
+            return "";
+        return "строка " + to_string(event.line) +
+            ": несоответствие типов в присваивании '" + event.name +
+            "' (" + varType + ") = выражение (" + exprType + ")";
+    }
+    case CheckKind::BINARY_OPERATION:
+    {
+        string leftType = types.typeOf(event.leftPrefix, symbols, imports);
+        // Если типы разные - это неявное преобразование
+        if (leftType == exprType || leftType == "unknown" || exprType == "unknown")
+            return "";
+        return "строка " + to_string(event.line) +
+            ": неявное преобразование типов в операции '" + event.name +
+            "' между " + leftType + " и " + exprType;
+    }
+    case CheckKind::FUNCTION_ARGUMENT:
+    {
+        string expected = event.name == "itod" ? "int" : event.name == "dtoi" ? "double" : "";
+        if (expected.empty() || exprType == expected)
+            return "";
+        return "строка " + to_string(event.line) +
+            ": функция '" + event.name + "' ожидает аргумент типа '" + expected + "', получен '" + exprType + "'";
+    }
+    case CheckKind::CALL_ARGUMENT:
+    {
+        auto callee = imports.find(event.name);
+        if (callee == imports.end() || event.argument >= callee->second.params.size())
+            return "";
+        string expected = SymbolTable::typeName(symbolType(callee->second.params[event.argument]));
+        if (exprType == expected || exprType == "unknown")
+            return "";
+        return "строка " + to_string(event.line) +
+            ": функция '" + event.name + "' ожидает аргумент " + to_string(event.argument + 1) +
+            " типа '" + expected + "', получен '" + exprType + "'";
+    }
+    }
+    return "";
+}
+
+void SemanticPass::defer(CheckEvent event)
+{
+    event.expression = expressions.size();  // Индекс, под которым будет сохранено текущее выражение
+    events.push_back(event);
+    currentReferenced = true;
+}
+
+void SemanticPass::archiveExpression(Expression& current)
+{
+    if (!currentReferenced)
+        return;
+    expressions.push_back(move(current));
+    currentReferenced = false;
+}
+
+void SemanticPass::run(const Expression& current, const SymbolTable& symbols, const FunctionTable& imports,
+    vector<string>& errors, unsigned threads)
+{
+    if (events.empty())
+        return;
+    if (currentReferenced)  // Выражение еще разбирается - проверкам нужна его копия
+    {
+        expressions.push_back(current);
+        currentReferenced = false;
+    }
+
+    vector<string> diagnostics(events.size());
+    uint32_t traceFile = Trace::getCurrentFile();
+    auto checkRange = [&](size_t from, size_t to)
+    {
+        TraceFile file(traceFile);      // Потоки проверок относят события к файлу разбора
+        TRACE_SCOPE("typecheck range");
+        PrefixTypes types;      // Проверки одного выражения идут подряд
+        for (size_t i = from; i < to; i++)
+        {
+            if (i == from || events[i].expression != events[i - 1].expression)
+                types.reset(&expressions[events[i].expression]);
+            diagnostics[i] = check(events[i], types, symbols, imports);
+        }
+    };
+
+    size_t threadCount = min<size_t>(max(1u, threads),
+        (events.size() + CHECKS_PER_THREAD - 1) / CHECKS_PER_THREAD);
+    if (threadCount <= 1)
+        checkRange(0, events.size());
+    else
+    {
+        // Таблицы только читаются, каждый поток пишет в свой диапазон diagnostics
+        vector<thread> workers;
+        size_t chunk = (events.size() + threadCount - 1) / threadCount;
+        for (size_t from = chunk; from < events.size(); from += chunk)
+            workers.emplace_back(checkRange, from, min(from + chunk, events.size()));
+        checkRange(0, min(chunk, events.size()));
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    // Слияние: диагностика проверки встает перед ошибками, найденными после нее
+    vector<string> merged;
+    merged.reserve(errors.size() + events.size());
+    size_t next = 0;
+    for (size_t slot = 0; slot <= errors.size(); slot++)
+    {
+        for (; next < events.size() && events[next].errorSlot == slot; next++)
+            if (!diagnostics[next].empty())
+                merged.push_back(move(diagnostics[next]));
+        if (slot < errors.size())
+            merged.push_back(move(errors[slot]));
+    }
+    errors.swap(merged);
+
+    clear();
+}
+
+void SemanticPass::clear()
+{
+    expressions.clear();
+    events.clear();
+    currentReferenced = false;
+}
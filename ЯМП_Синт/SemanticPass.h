@@ -0,0 +1,83 @@
+﻿#ifndef SEMANTICPASS_H
+#define SEMANTICPASS_H
+
+#include "SymbolTable.h"
+#include "Ir.h"
+#include <vector>
+#include <string>
+
+using namespace std;
+
+enum class CheckKind
+{
+    ASSIGNMENT,         // Тип переменной слева совпадает с типом выражения
+    BINARY_OPERATION,   // Операнды + и - одного типа
+    FUNCTION_ARGUMENT,  // Аргумент itod/dtoi нужного типа
+    CALL_ARGUMENT       // Аргумент функции импортированного модуля нужного типа
+};
+
+// Выражение - номера лексем в таблице символов в постфиксном порядке.
+// Вызов функции модуля записан как номер имени функции, за которым идет CALL_MARKER.
+typedef vector<int> Expression;
+const int CALL_MARKER = -1;
+
+// Отложенная проверка типов. Выражение задается индексом и длиной префикса:
+// тип вычисляется по тем токенам, которые были разобраны к моменту проверки.
+struct CheckEvent
+{
+    CheckKind kind;
+    string name;            // Переменная, операция или функция
+    int symbol = -1;        // Номер переменной присваивания в таблице символов
+    size_t expression = 0;  // Индекс выражения в SemanticPass
+    size_t prefix = 0;      // Длина префикса для типа выражения (правого операнда)
+    size_t leftPrefix = 0;  // Длина префикса для типа левого операнда бинарной операции
+    size_t argument = 0;    // Номер аргумента вызова (с 0)
+    int64_t line = 0;       // Строка, к которой относится диагностика
+    size_t errorSlot = 0;   // Число ошибок разбора, найденных до этой проверки
+};
+
+// Типы префиксов одного выражения. Цепочка + и - проверяет много префиксов одного
+// выражения; стек типов проходится один раз, а тип каждого префикса запоминается.
+// Выражение должно только расти; после его очистки нужен reset.
+class PrefixTypes
+{
+private:
+    const Expression* expression;
+    vector<SymbolType> typeStack;
+    vector<SymbolType> tops;        // Тип вершины стека после каждого префикса; UNTYPED - стек пуст
+
+public:
+    PrefixTypes() : expression(nullptr) { reset(nullptr); }
+
+    void reset(const Expression* checked);
+    string typeOf(size_t count, const SymbolTable& symbols, const FunctionTable& imports);
+};
+
+// Семантический проход по операторам верхнего уровня. После разбора описаний
+// операторы только читают таблицу объявленных переменных (и таблицу импортированных
+// функций, которая заполняется до описаний), поэтому их проверки
+// копятся и выполняются параллельно над неизменяемой таблицей. Диагностики
+// вставляются в список ошибок по errorSlot, порядок не зависит от потоков.
+class SemanticPass
+{
+private:
+    vector<Expression> expressions;     // Выражения, на которые ссылаются отложенные проверки
+    vector<CheckEvent> events;          // Проверки в порядке исходного текста
+    bool currentReferenced;             // На текущее (недоразобранное) выражение есть ссылки
+
+public:
+    SemanticPass() : currentReferenced(false) {}
+
+    // Текст диагностики или пустая строка, если проверка пройдена
+    static string check(const CheckEvent& event, PrefixTypes& types, const SymbolTable& symbols,
+        const FunctionTable& imports);
+
+    bool hasPending() const { return !events.empty(); }
+    void defer(CheckEvent event);                       // Отложить проверку текущего выражения
+    void archiveExpression(Expression& current);        // Текущее выражение завершено
+    void run(const Expression& current, const SymbolTable& symbols, const FunctionTable& imports,
+        vector<string>& errors, unsigned threads);     // threads - не больше стольких потоков (--jobs)
+    void clear();
+};
+
+#endif
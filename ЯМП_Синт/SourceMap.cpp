@@ -0,0 +1,76 @@
+﻿#include "SourceMap.h"
+#include "TextScan.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+SourceMap::SourceMap(const string& sourceText) : text(sourceText), textStart(0)
+{
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0)   // Метка порядка байтов UTF-8 не является частью текста
+        textStart = 3;
+}
+
+bool SourceMap::readFile(const string& filename, string& content)
+{
+    ifstream input(filename, ios::binary);
+    if (!input.is_open())
+        return false;
+
+    ostringstream buffer;
+    buffer << input.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+void SourceMap::buildLineIndex() const
+{
+    const char* data = text.data();
+    size_t size = text.size();
+
+    lineStarts.push_back(textStart);
+    size_t i = textStart;
+    for (; i + 32 <= size; i += 32)     // По 32 байта: маска переводов строк, затем обход ее единичных битов
+    {
+        uint32_t mask = newlineMask32(data + i);
+        while (mask != 0)
+        {
+            lineStarts.push_back(i + lowestSetBit(mask) + 1);
+            mask &= mask - 1;
+        }
+    }
+    for (; i < size; ++i)
+        if (data[i] == '\n')
+            lineStarts.push_back(i + 1);
+}
+
+int64_t SourceMap::lineOf(size_t offset) const
+{
+    call_once(indexBuilt, [this]() { buildLineIndex(); });
+
+    // Первая строка, начинающаяся правее offset, - следующая за искомой
+    return (int64_t)(upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin());
+}
+
+int64_t SourceMap::columnOf(size_t offset) const
+{
+    int64_t line = lineOf(offset);
+    size_t lineStart = lineStarts[line > 0 ? line - 1 : 0];
+    if (offset < lineStart)
+        return 1;
+
+    const char* data = text.data();
+    size_t firstNonAscii = findNonAscii(data, lineStart, offset);
+    if (firstNonAscii >= offset)    // Чистый ASCII - позиция равна числу байтов
+        return (int64_t)(offset - lineStart) + 1;
+
+    // Многобайтовый символ - одна позиция; каждый байт некорректной последовательности - тоже одна
+    size_t column = firstNonAscii - lineStart;
+    size_t i = firstNonAscii;
+    while (i < offset)
+    {
+        size_t length = utf8SequenceLength(data + i, text.size() - i);
+        i += length != 0 ? length : 1;
+        column++;
+    }
+    return (int64_t)column + 1;
+}
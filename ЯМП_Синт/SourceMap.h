@@ -0,0 +1,35 @@
+﻿#ifndef SOURCEMAP_H
+#define SOURCEMAP_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+using namespace std;
+
+// Исходный текст и индекс начал строк. Токены хранят только смещение в тексте,
+// а номер строки и позиция вычисляются двоичным поиском лишь тогда, когда они нужны.
+class SourceMap
+{
+private:
+    string text;                    // Исходный текст
+    size_t textStart;               // Начало текста после метки порядка байтов UTF-8
+    mutable vector<size_t> lineStarts;  // Смещения начал строк, строится при первом запросе
+    mutable once_flag indexBuilt;
+
+    void buildLineIndex() const;    // Векторный поиск переводов строк по всему тексту
+
+public:
+    explicit SourceMap(const string& sourceText);
+
+    static bool readFile(const string& filename, string& content);    // Чтение файла целиком
+
+    const string& getText() const { return text; }
+    size_t getTextStart() const { return textStart; }
+
+    int64_t lineOf(size_t offset) const;    // Номер строки (с 1)
+    int64_t columnOf(size_t offset) const;  // Позиция в строке в символах UTF-8 (с 1)
+};
+
+#endif
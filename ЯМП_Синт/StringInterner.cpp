@@ -0,0 +1,144 @@
+﻿#include "StringInterner.h"
+#include <algorithm>
+
+static const size_t INITIAL_BUCKETS = 64;   // Корзин сегмента в начале
+
+StringInterner::StringInterner(uint64_t limit)
+    : shards(new Shard[SHARD_COUNT]), maxStrings(min<uint64_t>(limit, (uint64_t)SHARD_CAPACITY * SHARD_COUNT)), total(0)
+{
+    for (unsigned s = 0; s < SHARD_COUNT; s++)
+    {
+        Shard& shard = shards[s];
+        for (atomic<string*>& page : shard.pages)
+            page.store(nullptr, memory_order_relaxed);
+        shard.count = 0;
+        shard.tables.emplace_back(new Table{ INITIAL_BUCKETS - 1, unique_ptr<atomic<const Entry*>[]>(new atomic<const Entry*>[INITIAL_BUCKETS]) });
+        for (size_t b = 0; b < INITIAL_BUCKETS; b++)
+            shard.tables.back()->buckets[b].store(nullptr, memory_order_relaxed);
+        shard.table.store(shard.tables.back().get(), memory_order_release);
+    }
+}
+
+StringInterner::~StringInterner()
+{
+    for (unsigned s = 0; s < SHARD_COUNT; s++)
+        for (atomic<string*>& page : shards[s].pages)
+            delete[] page.load(memory_order_relaxed);
+}
+
+StringInterner& StringInterner::global()
+{
+    static StringInterner* instance = []()
+    {
+        // Не разрушается при выходе: потоки других статических объектов могут еще обращаться к словарю
+        StringInterner* interner = new StringInterner();
+        interner->internKeywords();
+        return interner;
+    }();
+    return *instance;
+}
+
+void StringInterner::internKeywords()
+{
+    for (const char* keyword : { "return", "int", "double", "itod", "dtoi", "import" })
+        intern(keyword);
+}
+
+uint32_t StringInterner::hashOf(const char* data, size_t size)     // FNV-1a
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+const StringInterner::Entry* StringInterner::findIn(const Shard& shard, uint32_t hash, const char* data, size_t size) const
+{
+    // Старшие биты выбирают сегмент, младшие - корзину, чтобы они не зависели друг от друга
+    const Table* table = shard.table.load(memory_order_acquire);
+    for (const Entry* entry = table->buckets[hash & table->mask].load(memory_order_acquire); entry != nullptr; entry = entry->next)
+        if (entry->hash == hash)
+        {
+            const string& candidate = text(entry->id);
+            if (candidate.size() == size && candidate.compare(0, size, data, size) == 0)
+                return entry;
+        }
+    return nullptr;
+}
+
+uint32_t StringInterner::find(const string& value) const
+{
+    uint32_t hash = hashOf(value.data(), value.size());
+    const Entry* entry = findIn(shards[hash >> (32 - SHARD_BITS)], hash, value.data(), value.size());
+    return entry != nullptr ? entry->id : NONE;
+}
+
+void StringInterner::link(Shard& shard, Table& table, uint32_t hash, uint32_t id)
+{
+    atomic<const Entry*>& head = table.buckets[hash & table.mask];
+    shard.entries.push_back({ hash, id, head.load(memory_order_relaxed) });
+    head.store(&shard.entries.back(), memory_order_release);    // Запись видна читателям целиком
+}
+
+// Новая таблица вдвое больше: записи копируются, а не перецепляются,
+// потому что читатели могут в это время идти по цепочкам старой таблицы
+void StringInterner::grow(Shard& shard)
+{
+    const Table& old = *shard.table.load(memory_order_relaxed);
+    size_t size = (old.mask + 1) * 2;
+    shard.tables.emplace_back(new Table{ size - 1, unique_ptr<atomic<const Entry*>[]>(new atomic<const Entry*>[size]) });
+    Table& table = *shard.tables.back();
+    for (size_t b = 0; b < size; b++)
+        table.buckets[b].store(nullptr, memory_order_relaxed);
+    for (size_t b = 0; b <= old.mask; b++)
+        for (const Entry* entry = old.buckets[b].load(memory_order_relaxed); entry != nullptr; entry = entry->next)
+            link(shard, table, entry->hash, entry->id);
+    shard.table.store(&table, memory_order_release);
+}
+
+void StringInterner::full() const
+{
+    throw BudgetExceeded("анализ прерван: словарь строк заполнен (" + to_string(size()) + " строк)");
+}
+
+uint32_t StringInterner::intern(const string& value)
+{
+    uint32_t hash = hashOf(value.data(), value.size());
+    unsigned index = hash >> (32 - SHARD_BITS);
+    Shard& shard = shards[index];
+    if (const Entry* entry = findIn(shard, hash, value.data(), value.size()))  // Частый случай - без блокировки
+        return entry->id;
+
+    lock_guard<mutex> guard(shard.insertLock);
+    if (const Entry* entry = findIn(shard, hash, value.data(), value.size()))  // Другой поток мог успеть вставить
+        return entry->id;
+
+    uint32_t local = shard.count;
+    if (local >= SHARD_CAPACITY)
+        full();
+    if (total.fetch_add(1, memory_order_relaxed) >= maxStrings)    // Место занимается до вставки - предел точный
+    {
+        total.fetch_sub(1, memory_order_relaxed);
+        full();
+    }
+    unsigned pageIndex = highestSetBit((local >> FIRST_PAGE_BITS) + 1);
+    uint32_t pageStart = (1u << (FIRST_PAGE_BITS + pageIndex)) - (1u << FIRST_PAGE_BITS);
+    atomic<string*>& page = shard.pages[pageIndex];
+    string* strings = page.load(memory_order_relaxed);
+    if (strings == nullptr)
+    {
+        strings = new string[(size_t)1 << (FIRST_PAGE_BITS + pageIndex)];
+        page.store(strings, memory_order_release);
+    }
+    strings[local - pageStart] = value;
+    uint32_t id = (local << SHARD_BITS) | index;
+
+    Table& table = *shard.table.load(memory_order_relaxed);
+    link(shard, table, hash, id);
+    if (++shard.count > table.mask + 1)     // В среднем не больше одной записи на корзину
+        grow(shard);
+    return id;
+}
@@ -0,0 +1,89 @@
+﻿#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "ResourceBudget.h"
+#include "TextScan.h"
+
+using namespace std;
+
+// Общий для процесса словарь строк: каждая различная строка хранится один раз
+// и получает постоянный номер, одинаковый во всех потоках. Словарь разбит на
+// сегменты по хешу; поиск идет без блокировок, вставка блокирует только свой сегмент.
+// Строки сегмента лежат в страницах, каждая следующая вдвое больше предыдущей:
+// маленький словарь (один анализ) занимает килобайты, а каталог страниц не растет.
+// Строки не удаляются, пока жив словарь - таблицы файлов ссылаются на них по номеру.
+// Поэтому число строк ограничено: новая строка сверх предела (или сверх места в сегменте)
+// не добавляется, а intern бросает BudgetExceeded - анализ прерывается с диагностикой.
+class StringInterner
+{
+private:
+    static const unsigned SHARD_BITS = 4;
+    static const unsigned SHARD_COUNT = 1u << SHARD_BITS;
+    static const unsigned FIRST_PAGE_BITS = 6;      // Строк в первой странице - 64
+    static const unsigned PAGE_COUNT = 22;          // Страниц в сегменте
+    static const uint32_t SHARD_CAPACITY = ((1u << PAGE_COUNT) - 1) << FIRST_PAGE_BITS;    // 64 * (2^22 - 1) строк
+    static_assert(SHARD_CAPACITY < (1u << (32 - SHARD_BITS)), "местный номер не помещается в номер строки");
+
+    struct Entry
+    {
+        uint32_t hash;
+        uint32_t id;
+        const Entry* next;
+    };
+    struct Table            // Корзины сегмента; при росте заменяется целиком
+    {
+        size_t mask;
+        unique_ptr<atomic<const Entry*>[]> buckets;
+    };
+    struct Shard
+    {
+        mutex insertLock;
+        atomic<Table*> table;
+        atomic<string*> pages[PAGE_COUNT];  // Страница k - строки с местными номерами от 64 * (2^k - 1), 64 * 2^k штук
+        uint32_t count;                     // Меняется только под insertLock
+        vector<unique_ptr<Table>> tables;   // Прежние таблицы живут, пока по ним могут идти читатели
+        deque<Entry> entries;               // Записи всех таблиц; адреса не меняются
+    };
+
+    unique_ptr<Shard[]> shards;
+    uint64_t maxStrings;
+    atomic<uint64_t> total;     // Строк во всех сегментах
+
+    static uint32_t hashOf(const char* data, size_t size);
+    const Entry* findIn(const Shard& shard, uint32_t hash, const char* data, size_t size) const;
+    void link(Shard& shard, Table& table, uint32_t hash, uint32_t id);
+    void grow(Shard& shard);
+    [[noreturn]] void full() const;
+
+public:
+    static const uint32_t NONE = UINT32_MAX;
+    static const uint64_t CAPACITY = 1ull << 26;    // Предел по умолчанию - 64М строк
+
+    explicit StringInterner(uint64_t limit = CAPACITY);
+    ~StringInterner();
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    static StringInterner& global();    // Словарь процесса; ключевые слова в нем с самого начала
+    void internKeywords();              // Ключевые слова языка - первыми номерами словаря
+
+    uint32_t intern(const string& text);            // Номер строки, новая строка добавляется (BudgetExceeded - нет места)
+    uint32_t find(const string& text) const;        // Номер строки или NONE
+    uint64_t size() const { return total.load(memory_order_relaxed); }
+    const string& text(uint32_t id) const           // Без блокировок: страница не меняется после публикации
+    {
+        const Shard& shard = shards[id & (SHARD_COUNT - 1)];
+        uint32_t local = id >> SHARD_BITS;
+        unsigned page = highestSetBit((local >> FIRST_PAGE_BITS) + 1);
+        return shard.pages[page].load(memory_order_acquire)[local + (1u << FIRST_PAGE_BITS) - (1u << (FIRST_PAGE_BITS + page))];
+    }
+};
+
+#endif
@@ -0,0 +1,142 @@
+﻿#include "SymbolTable.h"
+#include <iomanip>
+
+static const size_t INITIAL_BUCKETS = 128;
+
+SymbolTable::SymbolTable() : strings(StringInterner::global()), buckets(INITIAL_BUCKETS, -1), budget(nullptr)
+{
+}
+
+SymbolTable::SymbolTable(StringInterner& dictionary) : strings(dictionary), buckets(INITIAL_BUCKETS, -1), budget(nullptr)
+{
+}
+
+uint32_t SymbolTable::hashOf(uint32_t name)     // Перемешивание номера, чтобы соседние номера не попадали в соседние корзины
+{
+    name ^= name >> 16;
+    name *= 0x85EBCA6Bu;
+    name ^= name >> 13;
+    return name;
+}
+
+void SymbolTable::grow()    // Удвоение числа корзин, записи перецепляются
+{
+    buckets.assign(buckets.size() * 2, -1);
+    size_t mask = buckets.size() - 1;
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        int& head = buckets[hashOf(symbols[i].name) & mask];
+        symbols[i].next = head;
+        head = (int)i;
+    }
+}
+
+int SymbolTable::findName(uint32_t name) const
+{
+    for (int i = buckets[hashOf(name) & (buckets.size() - 1)]; i >= 0; i = symbols[i].next)
+        if (symbols[i].name == name)
+            return i;
+    return -1;
+}
+
+int SymbolTable::find(const string& text) const
+{
+    uint32_t name = strings.find(text);
+    return name != StringInterner::NONE ? findName(name) : -1;
+}
+
+int SymbolTable::intern(const Token& token)
+{
+    if (budget != nullptr)  // Сюда приходит каждая лексема текста - здесь и считаем
+        budget->countToken();
+
+    const string& text = token.getValue();
+    uint32_t name = strings.intern(text);
+    int found = findName(name);
+    if (found >= 0)
+    {
+        symbols[found].uses++;
+        return found;
+    }
+    if (budget != nullptr)
+        budget->addSymbol(sizeof(Symbol) + text.size());
+
+    Symbol symbol;
+    symbol.name = name;
+    symbol.text = &strings.text(name);
+    symbol.kind = token.getType();
+    symbol.uses = 1;
+    int& head = buckets[hashOf(name) & (buckets.size() - 1)];
+    symbol.next = head;
+    symbol.constant = symbol.isLiteral() ? constants.add(symbol.kind, text) : -1;    // Литерал разбирается один раз
+    head = (int)symbols.size();
+    symbols.push_back(move(symbol));
+
+    if (symbols.size() > buckets.size())    // Средняя длина цепочки не больше 1
+        grow();
+    return (int)symbols.size() - 1;
+}
+
+Declaration& SymbolTable::declare(int handle, SymbolType type, int64_t line, int64_t position)
+{
+    vector<Declaration>& declarations = symbols[handle].declarations;
+    int level = (int)scopeMarks.size();
+    if (!declarations.empty() && declarations.back().scopeLevel == level)
+    {
+        declarations.back().type = type;    // Повторное объявление в том же блоке меняет тип
+        return declarations.back();
+    }
+    declarations.push_back({ type, level, line, position, -1 });
+    if (!scopeMarks.empty())        // Запоминаем объявления блока, чтобы снять их при выходе
+        scopeLog.push_back(handle);
+    return declarations.back();
+}
+
+void SymbolTable::enterScope()
+{
+    scopeMarks.push_back(scopeLog.size());
+}
+
+void SymbolTable::exitScope()
+{
+    if (scopeMarks.empty())
+        return;
+
+    size_t mark = scopeMarks.back();
+    scopeMarks.pop_back();
+
+    // Объявления блока - последние в своих списках, снимаем их в обратном порядке
+    while (scopeLog.size() > mark)
+    {
+        symbols[scopeLog.back()].declarations.pop_back();
+        scopeLog.pop_back();
+    }
+}
+
+void SymbolTable::clearDeclarations()
+{
+    for (Symbol& symbol : symbols)
+        symbol.declarations.clear();
+    scopeLog.clear();
+    scopeMarks.clear();
+}
+
+void SymbolTable::printToFile(ostream& output) const
+{
+    output << setw(35) << "=== ХЕШ-ТАБЛИЦА ===" << "\n";
+    output << left;
+    output << setw(15) << "Тип лексемы" << " | "
+        << setw(15) << "Лексема" << " | "
+        << "Индекс\n";
+    output << "----------------|-----------------|-------\n";
+
+    // Записи хранятся в порядке добавления - номер записи и есть индекс лексемы
+    for (size_t i = 0; i < symbols.size(); ++i)
+    {
+        output << setw(15) << Token::typeString(symbols[i].kind) << " | "
+            << setw(15) << *symbols[i].text << " | "
+            << i << "\n";
+    }
+
+    output << "\nВсего уникальных лексем: " << symbols.size() << "\n";
+}
@@ -0,0 +1,100 @@
+﻿#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include "Token.h"
+#include "ConstantPool.h"
+#include "StringInterner.h"
+#include "ResourceBudget.h"
+#include <ostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+enum class SymbolType : uint8_t
+{
+    UNTYPED,        // Объявлена с ошибочным типом - тип неизвестен
+    INT,
+    DOUBLE
+};
+
+struct Declaration          // Объявление переменной в одном из блоков
+{
+    SymbolType type;
+    int scopeLevel;         // Уровень вложенности блока
+    int64_t line;           // Место объявления
+    int64_t position;
+    int slot;               // Номер переменной в анализе потока данных, -1 - не назначен
+};
+
+struct Symbol               // Запись таблицы - одна на каждую различную лексему
+{
+    uint32_t name;          // Номер текста в словаре процесса
+    const string* text;     // Текст лексемы - строка словаря
+    TokenType kind;         // Тип лексемы
+    uint64_t uses;          // Сколько раз лексема встретилась в тексте
+    int next;               // Следующая запись в цепочке корзины или -1
+    int constant;           // Номер значения литерала в пуле констант, -1 - не литерал или вне диапазона
+    vector<Declaration> declarations;   // Объявления по вложенности блоков, внутреннее - последнее
+
+    bool isLiteral() const { return kind == TokenType::INT_NUM || kind == TokenType::DOUBLE_NUM; }
+};
+
+// Единая таблица символов: лексер добавляет каждую лексему один раз и получает
+// ее номер (handle), разбор объявляет переменные и проверяет типы по этому же номеру,
+// не вычисляя хеш имени повторно. Номер записи совпадает с индексом лексемы в отчете.
+// Тексты лексем общие для всех файлов процесса (StringInterner::global) или контекста
+// анализа, таблица файла по номеру текста хранит только свои атрибуты.
+class SymbolTable
+{
+private:
+    vector<Symbol> symbols;
+    StringInterner& strings;
+    vector<int> buckets;            // Начала цепочек по номеру текста, размер - степень двойки
+    vector<int> scopeLog;           // Символы, объявленные внутри блоков, в порядке объявления
+    vector<size_t> scopeMarks;      // Размер scopeLog на момент входа в каждый блок
+    ConstantPool constants;         // Значения числовых литералов
+    ResourceBudget* budget;         // Счет лексем и символов анализа или nullptr
+
+    static uint32_t hashOf(uint32_t name);
+    int findName(uint32_t name) const;
+    void grow();
+
+public:
+    SymbolTable();                                  // Тексты - в словаре процесса
+    explicit SymbolTable(StringInterner& dictionary);   // Тексты - в словаре контекста анализа
+
+    void setBudget(ResourceBudget* analysisBudget) { budget = analysisBudget; }
+
+    int intern(const Token& token);             // Номер лексемы, новая лексема добавляется
+    int find(const string& text) const;         // Номер лексемы или -1
+    const Symbol& at(int handle) const { return symbols[handle]; }
+    size_t size() const { return symbols.size(); }
+    const ConstantPool& getConstants() const { return constants; }
+
+    Declaration& declare(int handle, SymbolType type, int64_t line, int64_t position);  // Объявление в текущем блоке
+    const Declaration* lookup(int handle) const // Самое внутреннее видимое объявление или nullptr
+    {
+        return handle >= 0 && !symbols[handle].declarations.empty() ? &symbols[handle].declarations.back() : nullptr;
+    }
+    bool isDeclared(int handle) const { return lookup(handle) != nullptr; }
+    bool isDeclaredInCurrentScope(int handle) const
+    {
+        const Declaration* declaration = lookup(handle);
+        return declaration != nullptr && declaration->scopeLevel == (int)scopeMarks.size();
+    }
+
+    void enterScope();                          // Вход в блок - O(1)
+    void exitScope();                           // Выход из блока - снимает только объявления этого блока
+    void clearDeclarations();                   // Лексемы остаются, объявления удаляются
+
+    void printToFile(ostream& output) const;    // Вывод лексем в порядке их появления
+
+    static const char* typeName(SymbolType type) // "int", "double" или "" для неизвестного типа
+    {
+        return type == SymbolType::INT ? "int" : type == SymbolType::DOUBLE ? "double" : "";
+    }
+};
+
+#endif
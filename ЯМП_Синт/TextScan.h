@@ -0,0 +1,144 @@
+﻿#ifndef TEXTSCAN_H
+#define TEXTSCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Векторный просмотр текста блоками по 32 байта (SSE2 есть на любом x64, AVX2 - если включен при сборке).
+// На других платформах используется обычный побайтовый цикл.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TEXTSCAN_AVX2
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXTSCAN_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline unsigned lowestSetBit(uint32_t mask)     // Номер младшего единичного бита (mask != 0)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+inline unsigned highestSetBit(uint32_t mask)    // Номер старшего единичного бита (mask != 0)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, mask);
+    return (unsigned)index;
+#else
+    return 31u - (unsigned)__builtin_clz(mask);
+#endif
+}
+
+// Маска байтов блока [p, p + 32) со старшим битом, то есть не-ASCII байтов
+inline uint32_t nonAsciiMask32(const char* p)
+{
+#if defined(TEXTSCAN_AVX2)
+    return (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)p));
+#elif defined(TEXTSCAN_SSE2)
+    uint32_t low = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p));
+    uint32_t high = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p + 16)));
+    return low | (high << 16);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < 32; ++i)
+        mask |= (uint32_t)((unsigned char)p[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+// Маска байтов '\n' в блоке [p, p + 32)
+inline uint32_t newlineMask32(const char* p)
+{
+#if defined(TEXTSCAN_AVX2)
+    __m256i newline = _mm256_set1_epi8('\n');
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), newline));
+#elif defined(TEXTSCAN_SSE2)
+    __m128i newline = _mm_set1_epi8('\n');
+    uint32_t low = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), newline));
+    uint32_t high = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 16)), newline));
+    return low | (high << 16);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < 32; ++i)
+        mask |= (uint32_t)(p[i] == '\n') << i;
+    return mask;
+#endif
+}
+
+// Смещение первого не-ASCII байта в [from, size) или size, если весь остаток - ASCII
+inline size_t findNonAscii(const char* text, size_t from, size_t size)
+{
+    size_t i = from;
+    for (; i + 32 <= size; i += 32)     // Быстрый путь: целый блок проверяется одной маской
+    {
+        uint32_t mask = nonAsciiMask32(text + i);
+        if (mask != 0)
+            return i + lowestSetBit(mask);
+    }
+    for (; i < size; ++i)
+        if ((unsigned char)text[i] >= 0x80)
+            return i;
+    return size;
+}
+
+// Длина корректной UTF-8 последовательности в начале [p, p + available) или 0, если она некорректна
+inline size_t utf8SequenceLength(const char* p, size_t available)
+{
+    const unsigned char* s = (const unsigned char*)p;
+    unsigned char lead = s[0];
+    size_t length;
+    unsigned char low = 0x80, high = 0xBF;  // Допустимый диапазон второго байта
+
+    if (lead < 0x80)
+        return 1;
+    else if (lead >= 0xC2 && lead <= 0xDF)
+        length = 2;
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;       // Избыточная (overlong) запись
+        if (lead == 0xED) high = 0x9F;      // Суррогаты UTF-16
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;       // Избыточная запись
+        if (lead == 0xF4) high = 0x8F;      // Больше U+10FFFF
+    }
+    else
+        return 0;                           // Продолжение без начала, C0, C1, F5..FF
+
+    if (available < length || s[1] < low || s[1] > high)
+        return 0;
+    for (size_t i = 2; i < length; ++i)
+        if (s[i] < 0x80 || s[i] > 0xBF)
+            return 0;
+    return length;
+}
+
+// Число позиций в строке, которые занимает текст, - по тому же правилу, что и номер позиции:
+// многобайтовый символ - одна позиция, каждый байт некорректной последовательности - тоже одна
+inline size_t utf8Length(const char* text, size_t size)
+{
+    size_t i = findNonAscii(text, 0, size);
+    size_t length = i;
+    for (; i < size; length++)
+    {
+        size_t sequence = utf8SequenceLength(text + i, size - i);
+        i += sequence != 0 ? sequence : 1;
+    }
+    return length;
+}
+
+#endif
@@ -1,57 +1,74 @@
 #include "Token.h"
-#include <map>
+#include "SourceMap.h"
+#include "TextScan.h"
 
-Token::Token() : type(TokenType::ERROR), value(""), line(0), position(0) {}
+Token::Token() : type(TokenType::ERROR), value(""), offset(0), source(nullptr), column(0), symbol(-1) {}
 
-Token::Token(TokenType t, const string& v, int l, int p) : type(t), value(v), line(l), position(p) {}
+Token::Token(TokenType t, const string& v, int64_t l, int64_t p)
+    : type(t), value(v), offset((uint64_t)l), source(nullptr), column(p), symbol(-1) {}
+
+Token::Token(TokenType t, const string& v, size_t o, const SourceMap* s)
+    : type(t), value(v), offset(o), source(s), column(0), symbol(-1) {}
+
+Token::Token(TokenType t, const string& v, const Token& at)
+    : type(t), value(v), offset(at.offset), source(at.source), column(at.column), symbol(-1) {}
 
 TokenType Token::getType() const
 {
     return type;
 }
 
-string Token::getValue() const
+int64_t Token::getLine() const
+{
+    return source != nullptr ? source->lineOf((size_t)offset) : (int64_t)offset;
+}
+
+int64_t Token::getPosition() const
 {
-    return value;
+    return source != nullptr ? source->columnOf((size_t)offset) : column;
 }
 
-int Token::getLine() const
+int64_t Token::getEndPosition() const
 {
-    return line;
+    return getPosition() + (int64_t)utf8Length(value.data(), value.size());
 }
 
-int Token::getPosition() const
+uint64_t Token::getOffset() const
 {
-    return position;
+    return offset;
 }
 
 string Token::getTypeString() const
 {
-    static map<TokenType, string> typeStrings =
+    return typeString(type);
+}
+
+string Token::typeString(TokenType type)
+{
+    switch (type)   //   :     
     {
-        //    -> 
-        {TokenType::RETURN, "RETURN"},
-        {TokenType::INT, "INT"},
-        {TokenType::DOUBLE, "DOUBLE"},
-        {TokenType::ITOD, "ITOD"},
-        {TokenType::DTOI, "DTOI"},
-        {TokenType::ID, "ID"},
-        {TokenType::INT_NUM, "INT_NUM"},
-        {TokenType::DOUBLE_NUM, "DOUBLE_NUM"},
-        {TokenType::ASSIGN, "ASSIGN"},
-        {TokenType::PLUS, "PLUS"},
-        {TokenType::MINUS, "MINUS"},
-        {TokenType::MULT, "MULT"},
-        {TokenType::DIV, "DIV"},
-        {TokenType::COMMA, "COMMA"},
-        {TokenType::SEMICOLON, "SEMICOLON"},
-        {TokenType::LPAREN, "LPAREN"},
-        {TokenType::RPAREN, "RPAREN"},
-        {TokenType::LBRACE, "LBRACE"},
-        {TokenType::RBRACE, "RBRACE"},
-        {TokenType::END_OF_FILE, "END_OF_FILE"},
-        {TokenType::ERROR, "ERROR"}
-    };
-
-    return typeStrings[type]; //    
+    case TokenType::RETURN: return "RETURN";
+    case TokenType::INT: return "INT";
+    case TokenType::DOUBLE: return "DOUBLE";
+    case TokenType::ITOD: return "ITOD";
+    case TokenType::DTOI: return "DTOI";
+    case TokenType::IMPORT: return "IMPORT";
+    case TokenType::ID: return "ID";
+    case TokenType::INT_NUM: return "INT_NUM";
+    case TokenType::DOUBLE_NUM: return "DOUBLE_NUM";
+    case TokenType::ASSIGN: return "ASSIGN";
+    case TokenType::PLUS: return "PLUS";
+    case TokenType::MINUS: return "MINUS";
+    case TokenType::MULT: return "MULT";
+    case TokenType::DIV: return "DIV";
+    case TokenType::COMMA: return "COMMA";
+    case TokenType::SEMICOLON: return "SEMICOLON";
+    case TokenType::LPAREN: return "LPAREN";
+    case TokenType::RPAREN: return "RPAREN";
+    case TokenType::LBRACE: return "LBRACE";
+    case TokenType::RBRACE: return "RBRACE";
+    case TokenType::END_OF_FILE: return "END_OF_FILE";
+    case TokenType::ERROR: return "ERROR";
+    }
+    return "";
 }
\ No newline at end of file
@@ -2,12 +2,15 @@
 #define TOKEN_H
 
 #include <string>
+#include <cstdint>
 
 using namespace std;
 
+class SourceMap;
+
 enum class TokenType            //   
 {
-    RETURN, INT, DOUBLE, ITOD, DTOI,  //  
+    RETURN, INT, DOUBLE, ITOD, DTOI, IMPORT,  //  
 
     ID, INT_NUM, DOUBLE_NUM,    //   
 
@@ -21,18 +24,27 @@ class Token
 private:
     TokenType type;     //  
     string value;       //  
-    int line;           //     
-    int position;       //   
+    uint64_t offset;    //     ( source -  )
+    const SourceMap* source;    // ,        
+    int64_t column;     //   ,  source 
+    int symbol;         //       -1
 
 public:
     Token();
-    Token(TokenType t, const string& v, int l, int p);
+    Token(TokenType t, const string& v, int64_t l, int64_t p);      //       
+    Token(TokenType t, const string& v, size_t o, const SourceMap* s);  //    
+    Token(TokenType t, const string& v, const Token& at);           //     
 
     TokenType getType() const;
-    string getValue() const;
-    int getLine() const;
-    int getPosition() const;
+    const string& getValue() const { return value; }
+    int64_t getLine() const;
+    int64_t getPosition() const;
+    int64_t getEndPosition() const;     //     -    
+    uint64_t getOffset() const;
+    int getSymbol() const { return symbol; }
+    void setSymbol(int s) { symbol = s; }
     string getTypeString() const; //    
+    static string typeString(TokenType t);
 };
 
 #endif
\ No newline at end of file
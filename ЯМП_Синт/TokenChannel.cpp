@@ -0,0 +1,42 @@
+﻿#include "TokenChannel.h"
+#include <algorithm>
+
+TokenChannel::TokenChannel(size_t maxTokens)
+    : capacity(max<size_t>(1, maxTokens)), closed(false), end(TokenType::END_OF_FILE, "", 0, nullptr)
+{
+}
+
+void TokenChannel::push(Token token)
+{
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [&] { return tokens.size() < capacity; });
+    tokens.push_back(move(token));
+    changed.notify_all();
+}
+
+void TokenChannel::close(const Token& endOfText)
+{
+    lock_guard<mutex> guard(lock);
+    end = endOfText;
+    closed = true;
+    changed.notify_all();
+}
+
+Token TokenChannel::pop()
+{
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [&] { return !tokens.empty() || closed; });
+    if (tokens.empty())
+        return end;
+    Token token = move(tokens.front());
+    tokens.pop_front();
+    changed.notify_all();
+    return token;
+}
+
+Token TokenChannel::peek()
+{
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard, [&] { return !tokens.empty() || closed; });
+    return tokens.empty() ? end : tokens.front();
+}
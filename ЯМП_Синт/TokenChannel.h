@@ -0,0 +1,33 @@
+﻿#ifndef TOKENCHANNEL_H
+#define TOKENCHANNEL_H
+
+#include "Token.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// Очередь лексем между потоком, получающим текст частями, и потоком разбора.
+// Очередь ограничена: если разбор отстает, поставщик ждет, и в памяти
+// не накапливаются лексемы всего текста.
+class TokenChannel
+{
+private:
+    deque<Token> tokens;
+    size_t capacity;
+    bool closed;            // Лексем больше не будет
+    Token end;              // Конец файла - выдается после всех лексем
+    mutex lock;
+    condition_variable changed;
+
+public:
+    explicit TokenChannel(size_t maxTokens);
+
+    void push(Token token);     // Ждет, пока в очереди есть место
+    void close(const Token& endOfText = Token(TokenType::END_OF_FILE, "", 0, nullptr));   // Место конца текста
+    Token pop();                // Ждет лексему; после close и опустошения - END_OF_FILE
+    Token peek();               // То же без извлечения
+};
+
+#endif
@@ -0,0 +1,36 @@
+﻿#include "TokenStream.h"
+
+void TokenStream::append(TokenType type, size_t offset, size_t length, int symbol)
+{
+    types.push_back((uint8_t)type);
+    offsets.push_back((uint64_t)offset);
+    lengths.push_back((uint32_t)length);
+    symbols.push_back((uint32_t)symbol);
+}
+
+void TokenStream::reserve(size_t count)
+{
+    types.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    symbols.reserve(count);
+}
+
+Token TokenStream::tokenAt(size_t i) const
+{
+    Token token(typeAt(i), source->getText().substr(offsets[i], lengths[i]), (size_t)offsets[i], source);
+    token.setSymbol((int)symbols[i]);
+    return token;
+}
+
+Token TokenStream::endAt(size_t i) const
+{
+    size_t offset = i < offsets.size() ? (size_t)offsets[i] : source->getText().size();
+    return Token(TokenType::END_OF_FILE, "", offset, source);
+}
+
+size_t TokenStream::memoryUsage() const
+{
+    return types.capacity() * sizeof(uint8_t) + offsets.capacity() * sizeof(uint64_t) +
+        lengths.capacity() * sizeof(uint32_t) + symbols.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,46 @@
+﻿#ifndef TOKENSTREAM_H
+#define TOKENSTREAM_H
+
+#include "Token.h"
+#include "SourceMap.h"
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+const size_t MAX_LEXEME_LENGTH = UINT32_MAX;    // Длина лексемы в потоке - 32-битная, длиннее лексема обрывается
+
+// Поток токенов в виде параллельных массивов (structure of arrays).
+// Текст лексемы не копируется - он восстанавливается по смещению и длине
+// из исходного текста, поэтому один токен занимает 17 байт вместо объекта Token
+// со строкой внутри. Просмотр вперед читает только плотный массив типов.
+// Смещения 64-битные - текст может быть больше 4 ГБ; лексема не длиннее MAX_LEXEME_LENGTH.
+class TokenStream
+{
+private:
+    const SourceMap* source;    // Текст, на который ссылаются смещения
+    vector<uint8_t> types;      // TokenType
+    vector<uint64_t> offsets;   // Смещение лексемы в тексте
+    vector<uint32_t> lengths;   // Длина лексемы в байтах
+    vector<uint32_t> symbols;   // Номер лексемы в таблице символов
+
+public:
+    static constexpr size_t BYTES_PER_TOKEN = sizeof(uint8_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+    explicit TokenStream(const SourceMap& src) : source(&src) {}
+
+    void append(TokenType type, size_t offset, size_t length, int symbol);
+    void reserve(size_t count);
+
+    size_t size() const { return types.size(); }
+    TokenType typeAt(size_t i) const { return (TokenType)types[i]; }
+    uint64_t offsetAt(size_t i) const { return offsets[i]; }
+    uint32_t lengthAt(size_t i) const { return lengths[i]; }
+    uint32_t symbolAt(size_t i) const { return symbols[i]; }
+
+    Token tokenAt(size_t i) const;      // Сборка полноценного токена по запросу
+    Token endAt(size_t i) const;        // Конец файла на месте лексемы i, за последней лексемой - в конце текста
+    size_t memoryUsage() const;         // Объем памяти под массивы, в байтах
+};
+
+#endif
@@ -0,0 +1,134 @@
+﻿#include "Trace.h"
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <locale>
+
+struct TraceEvent
+{
+    const char* name;       // Имена событий - строковые литералы
+    uint64_t time;          // Наносекунды от включения трассировки
+    uint32_t file;          // 0 - вне файла
+    char phase;
+};
+
+struct TraceBuffer          // Буфер одного потока; пишет в него только владелец
+{
+    uint32_t thread;
+    vector<TraceEvent> events;
+};
+
+atomic<bool> Trace::enabled(false);
+
+static mutex registryLock;      // Регистрация буферов и файлов
+static vector<unique_ptr<TraceBuffer>> buffers;     // Переживают свои потоки - до записи файла
+static vector<string> files(1);
+static chrono::steady_clock::time_point traceStart;
+
+static thread_local TraceBuffer* threadBuffer = nullptr;
+static thread_local uint32_t threadFile = 0;
+
+static void registerThread()     // Потоки нумеруются в порядке первого события
+{
+    lock_guard<mutex> guard(registryLock);
+    buffers.emplace_back(new TraceBuffer());
+    threadBuffer = buffers.back().get();
+    threadBuffer->thread = (uint32_t)buffers.size();
+    threadBuffer->events.reserve(1024);
+}
+
+void Trace::enable()
+{
+    traceStart = chrono::steady_clock::now();
+    if (threadBuffer == nullptr)    // Включающий поток - главный, он получает номер 1
+        registerThread();
+    enabled.store(true, memory_order_relaxed);
+}
+
+uint32_t Trace::registerFile(const string& name)
+{
+    lock_guard<mutex> guard(registryLock);
+    files.push_back(name);
+    return (uint32_t)files.size() - 1;
+}
+
+uint32_t Trace::getCurrentFile()
+{
+    return threadFile;
+}
+
+void Trace::setCurrentFile(uint32_t file)
+{
+    threadFile = file;
+}
+
+void Trace::record(const char* name, char phase)
+{
+    if (threadBuffer == nullptr)
+        registerThread();
+    uint64_t time = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceStart).count();
+    threadBuffer->events.push_back({ name, time, threadFile, phase });
+}
+
+static void writeJsonString(ostream& out, const string& text)
+{
+    out << '"';
+    for (unsigned char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c < 0x20)
+        {
+            static const char* const HEX = "0123456789abcdef";
+            out << "\\u00" << HEX[c >> 4] << HEX[c & 15];
+        }
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+bool Trace::write(const string& path, string& error)
+{
+    lock_guard<mutex> guard(registryLock);
+    ofstream out(path, ios::binary);
+    if (!out.is_open())
+    {
+        error = "не удалось открыть файл " + path;
+        return false;
+    }
+    out.imbue(locale::classic());
+
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& buffer : buffers)
+    {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread
+            << ",\"args\":{\"name\":\"" << (buffer->thread == 1 ? "main" : "worker") << " " << buffer->thread << "\"}}";
+        first = false;
+        for (const TraceEvent& event : buffer->events)
+        {
+            // ts - микросекунды, дробная часть сохраняет точность до наносекунды
+            out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":"
+                << buffer->thread << ",\"ts\":" << event.time / 1000 << "." << (char)('0' + event.time / 100 % 10)
+                << (char)('0' + event.time / 10 % 10) << (char)('0' + event.time % 10);
+            if (event.file != 0)
+            {
+                out << ",\"args\":{\"file\":";
+                writeJsonString(out, files[event.file]);
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    if (!out)
+    {
+        error = "не удалось записать " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+﻿#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+// Трассировка этапов анализа в формате Chrome trace_event (chrome://tracing, Perfetto).
+// Каждый поток пишет события в свой буфер без блокировок; мьютекс берется только
+// при первом событии потока, чтобы зарегистрировать буфер. Пока трассировка
+// выключена, область TRACE_SCOPE стоит одной проверки флага.
+class Trace
+{
+private:
+    static atomic<bool> enabled;
+
+public:
+    static void enable();
+    static bool isEnabled() { return enabled.load(memory_order_relaxed); }
+
+    static uint32_t registerFile(const string& name);  // Номер файла для событий
+    static uint32_t getCurrentFile();                   // Файл, который обрабатывает поток
+    static void setCurrentFile(uint32_t file);
+
+    static void record(const char* name, char phase);   // phase: 'B' - начало, 'E' - конец
+    // Запись всех событий; вызывается, когда потоки с событиями завершены
+    static bool write(const string& path, string& error);
+};
+
+class TraceScope            // Интервал от создания до конца области видимости
+{
+private:
+    const char* name;
+    bool active;
+
+public:
+    explicit TraceScope(const char* eventName) : name(eventName), active(Trace::isEnabled())
+    {
+        if (active)
+            Trace::record(name, 'B');
+    }
+    ~TraceScope()
+    {
+        if (active)
+            Trace::record(name, 'E');
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+class TraceFile             // События потока в этой области относятся к файлу
+{
+private:
+    uint32_t previous;
+
+public:
+    explicit TraceFile(const string& name) : previous(Trace::getCurrentFile())
+    {
+        if (Trace::isEnabled())
+            Trace::setCurrentFile(Trace::registerFile(name));
+    }
+    explicit TraceFile(uint32_t file) : previous(Trace::getCurrentFile())     // Файл другого потока
+    {
+        Trace::setCurrentFile(file);
+    }
+    ~TraceFile() { Trace::setCurrentFile(previous); }
+    TraceFile(const TraceFile&) = delete;
+    TraceFile& operator=(const TraceFile&) = delete;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif
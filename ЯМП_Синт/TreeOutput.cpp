@@ -0,0 +1,62 @@
+﻿#include "TreeOutput.h"
+
+void JsonTreeOutput::writeString(ostream& o, const string& s)
+{
+    o << '"';
+    for (unsigned char c : s)
+    {
+        if (c == '"' || c == '\\')
+            o << '\\' << (char)c;
+        else if (c < 0x20)
+            o << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 0xF];
+        else
+            o << (char)c;
+    }
+    o << '"';
+}
+
+void JsonTreeOutput::closeTo(int depth)
+{
+    while (!openDepths.empty() && openDepths.back() >= depth)
+    {
+        out << "]}";
+        openDepths.pop_back();
+        needComma = true;
+    }
+}
+
+void JsonTreeOutput::endLine()
+{
+    size_t start = line.find_first_not_of(' ');
+    if (start == string::npos)  // Пустые строки в дерево не попадают
+    {
+        line.clear();
+        return;
+    }
+    int depth = (int)start / 2;
+
+    if (!hasNodes)
+        out << '[';
+    closeTo(depth);
+    if (needComma)
+        out << ',';
+
+    out << "{\"node\":";
+    writeString(out, line.substr(start));
+    out << ",\"children\":[";
+    openDepths.push_back(depth);
+    hasNodes = true;
+    needComma = false;      // Следующий узел - первый потомок этого
+    line.clear();
+}
+
+void JsonTreeOutput::finish()
+{
+    if (!line.empty())
+        endLine();
+    if (hasNodes)
+    {
+        closeTo(0);
+        out << ']' << endl;
+    }
+}
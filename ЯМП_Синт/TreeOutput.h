@@ -0,0 +1,91 @@
+﻿#ifndef TREEOUTPUT_H
+#define TREEOUTPUT_H
+
+#include <ostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Политики вывода дерева разбора. Parser параметризуется одной из них:
+// TextTreeOutput - текстовое дерево с отступами (формат отчета по умолчанию),
+// JsonTreeOutput - то же дерево в виде вложенных JSON-объектов,
+// NullTreeOutput - дерево не строится, весь код вывода удаляется компилятором.
+
+struct Indent               // Отступ узла дерева - уровень вложенности, по 2 пробела на уровень
+{
+    int level;
+    explicit Indent(int l = 0) : level(l) {}
+};
+
+class TextTreeOutput
+{
+private:
+    ostream& out;
+
+public:
+    static const bool enabled = true;
+
+    explicit TextTreeOutput(ostream& o) : out(o) {}
+
+    void header() { out << "=== ДЕРЕВО РАЗБОРА ===" << endl; }
+    void finish() {}
+
+    template <class T>
+    TextTreeOutput& operator<<(const T& value) { out << value; return *this; }
+    TextTreeOutput& operator<<(Indent indent)
+    {
+        if (indent.level > 0)
+            out << setw(indent.level * 2) << "";    // Без построения строки из пробелов
+        return *this;
+    }
+    TextTreeOutput& operator<<(ostream& (*manip)(ostream&)) { manip(out); return *this; }
+};
+
+// Строки текстового дерева собираются в буфер; по endl глубина узла
+// определяется по ведущим пробелам, и узел дописывается в JSON-поток.
+class JsonTreeOutput
+{
+private:
+    ostream& out;
+    string line;                // Текущая (еще не завершенная) строка дерева
+    vector<int> openDepths;     // Глубины узлов, у которых еще открыт массив children
+    bool hasNodes;              // Выведен ли хотя бы один узел
+    bool needComma;             // Перед следующим узлом нужна запятая
+
+    void endLine();
+    void closeTo(int depth);    // Закрыть все узлы с глубиной >= depth
+    static void writeString(ostream& o, const string& s);
+
+public:
+    static const bool enabled = true;
+
+    explicit JsonTreeOutput(ostream& o) : out(o), hasNodes(false), needComma(false) {}
+
+    void header() { out << "=== ДЕРЕВО РАЗБОРА (JSON) ===" << endl; }
+    void finish();
+
+    JsonTreeOutput& operator<<(const string& value) { line += value; return *this; }
+    JsonTreeOutput& operator<<(const char* value) { line += value; return *this; }
+    JsonTreeOutput& operator<<(char value) { line += value; return *this; }
+    JsonTreeOutput& operator<<(Indent indent) { line.append(indent.level * 2, ' '); return *this; }
+    JsonTreeOutput& operator<<(ostream& (*)(ostream&)) { endLine(); return *this; }  // Дерево использует только endl
+};
+
+class NullTreeOutput
+{
+public:
+    static const bool enabled = false;
+
+    explicit NullTreeOutput(ostream&) {}
+
+    void header() {}
+    void finish() {}
+
+    template <class T>
+    NullTreeOutput& operator<<(const T&) { return *this; }
+    NullTreeOutput& operator<<(ostream& (*)(ostream&)) { return *this; }
+};
+
+#endif
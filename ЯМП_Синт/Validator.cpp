@@ -0,0 +1,521 @@
+﻿#include "Validator.h"
+#include "Grammar.h"
+#include "Trace.h"
+#include "ConstantPool.h"
+#include "TextScan.h"
+#include <algorithm>
+
+static uint32_t hashName(string_view name)     // FNV-1a
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : name)
+        hash = (hash ^ c) * 16777619u;
+    return hash;
+}
+
+static const char* typeName(ValueType type)
+{
+    return type == ValueType::INT ? "int" : "double";
+}
+
+static bool startsExpr(TokenType type)
+{
+    return type == TokenType::ID || type == TokenType::INT_NUM || type == TokenType::DOUBLE_NUM ||
+        type == TokenType::LPAREN || type == TokenType::ITOD || type == TokenType::DTOI;
+}
+
+Validator::Validator(InterfaceLibrary* library)
+    : interfaces(library), scanner(nullptr, 0), current(), lookahead(), previous(), level(0),
+    functionType(ValueType::INT), budget(nullptr), nesting(0)
+{
+}
+
+Lexeme Validator::nextLexeme()
+{
+    Lexeme lexeme = scanner.next();
+    if (budget != nullptr && lexeme.type != TokenType::END_OF_FILE)
+        budget->countToken();
+    return lexeme;
+}
+
+void Validator::advance()
+{
+    previous = current;
+    current = lookahead;
+    lookahead = nextLexeme();
+}
+
+bool Validator::fail(const Lexeme& at, const string& message)
+{
+    // Позиция в строке считается только для ошибки - так же, как у токенов полного анализа
+    errorMessage = "строка " + to_string(at.line) + ", позиция " + to_string(scanner.columnOf(at)) + ": " + message;
+    return false;
+}
+
+bool Validator::failAfter(const Lexeme& at, const string& message)
+{
+    // Как в полном анализе: позиция лексемы плюс ее длина в символах
+    int64_t column = scanner.columnOf(at);
+    string_view text = textOf(at);
+    errorMessage = "строка " + to_string(at.line) + ", позиция " +
+        to_string(column + (int64_t)utf8Length(text.data(), text.size())) + ": " + message;
+    return false;
+}
+
+bool Validator::failAtLine(int64_t line, const string& message)
+{
+    errorMessage = "строка " + to_string(line) + ": " + message;
+    return false;
+}
+
+bool Validator::expect(TokenType type, const string& message)
+{
+    if (current.type != type)
+        return fail(current, message);
+    advance();
+    return true;
+}
+
+int Validator::findName(string_view name) const
+{
+    if (buckets.empty())
+        return -1;
+    size_t mask = buckets.size() - 1;
+    for (size_t i = hashName(name) & mask;; i = (i + 1) & mask)
+    {
+        int index = buckets[i];
+        if (index < 0 || nameOf(names[index]) == name)
+            return index;
+    }
+}
+
+int Validator::declare(string_view name, ValueType type)
+{
+    int index = findName(name);
+    if (index < 0)
+    {
+        if ((names.size() + 1) * 2 > buckets.size())    // Заполнение не больше половины
+        {
+            buckets.assign(max<size_t>(64, buckets.size() * 2), -1);
+            size_t mask = buckets.size() - 1;
+            for (size_t n = 0; n < names.size(); n++)
+            {
+                size_t i = hashName(nameOf(names[n])) & mask;
+                while (buckets[i] >= 0)
+                    i = (i + 1) & mask;
+                buckets[i] = (int)n;
+            }
+        }
+        size_t mask = buckets.size() - 1;
+        size_t i = hashName(name) & mask;
+        while (buckets[i] >= 0)
+            i = (i + 1) & mask;
+        if (budget != nullptr)
+            budget->addSymbol(sizeof(Name) + name.size());
+        index = (int)names.size();
+        buckets[i] = index;
+        names.push_back({ nameChars.size(), name.size(), -1 });
+        nameChars.append(name);
+    }
+
+    int visible = names[index].declaration;
+    if (visible >= 0 && declarations[visible].level == level)
+        return -1;
+    names[index].declaration = (int)declarations.size();
+    declarations.push_back({ index, type, level, visible });
+    return names[index].declaration;
+}
+
+const Validator::Declaration* Validator::lookup(string_view name) const
+{
+    int index = findName(name);
+    return index >= 0 && names[index].declaration >= 0 ? &declarations[names[index].declaration] : nullptr;
+}
+
+void Validator::exitScope()
+{
+    while (!declarations.empty() && declarations.back().level == level)
+    {
+        names[declarations.back().name].declaration = declarations.back().shadowed;
+        declarations.pop_back();
+    }
+    level--;
+}
+
+bool Validator::validate(const char* source, size_t size, string& error)
+{
+    scanner = LexemeScanner(source, size);
+    return run(error);
+}
+
+bool Validator::validate(MappedWindow& file, string& error)
+{
+    scanner = LexemeScanner(file);
+    return run(error);
+}
+
+bool Validator::run(string& error)
+{
+    TRACE_SCOPE("validate");
+    current = Lexeme();
+    lookahead = Lexeme();
+    previous = current;
+    nesting = 0;
+    stack = StackLimit();   // Граница стека потока, в котором идет проверка
+    names.clear();
+    nameChars.clear();
+    buckets.clear();
+    declarations.clear();
+    level = 0;
+    importedSignatures.clear();
+    importedFunctions.clear();
+    importedModules.clear();
+    errorMessage.clear();
+
+    bool valid;
+    try
+    {
+        current = nextLexeme();
+        lookahead = nextLexeme();
+        previous = current;
+        valid = function() && (current.type == TokenType::END_OF_FILE || fail(current, "ожидался конец файла"));
+    }
+    catch (const BudgetExceeded& exceeded)  // Проверка прервана - ошибка в месте остановки, как у разбора
+    {
+        valid = fail(current, exceeded.what());
+    }
+    if (scanner.failed())   // Окно не отобразилось - ошибка выше может быть следствием оборванного текста
+    {
+        valid = false;
+        errorMessage = "ошибка чтения файла";
+    }
+    error = errorMessage;
+    return valid;
+}
+
+// Function → Imports Begin Descriptions Operators End
+bool Validator::function()
+{
+    while (current.type == TokenType::IMPORT)
+        if (!importModule())
+            return false;
+
+    // Begin → Type Id ( Params ) {
+    if (current.type != TokenType::INT && current.type != TokenType::DOUBLE)
+        return fail(current, "некорректный тип функции '" + string(textOf(current)) + "', ожидался int или double");
+    functionType = current.type == TokenType::INT ? ValueType::INT : ValueType::DOUBLE;
+    advance();
+    if (!expect(TokenType::ID, "ожидалось имя функции") || !expect(TokenType::LPAREN, "ожидалась ("))
+        return false;
+    if (current.type == TokenType::INT || current.type == TokenType::DOUBLE || current.type == TokenType::ID)
+    {
+        if (!parameter())
+            return false;
+        while (current.type == TokenType::COMMA)
+        {
+            advance();
+            if (!parameter())
+                return false;
+        }
+    }
+    if (!expect(TokenType::RPAREN, "ожидалась )") || !expect(TokenType::LBRACE, "ожидалась {"))
+        return false;
+
+    if (!descriptions() || !operators())
+        return false;
+
+    // End → return Id ; }
+    if (!expect(TokenType::RETURN, "ожидался return"))
+        return false;
+    if (current.type != TokenType::ID)
+        return fail(current, "ожидался идентификатор после return");
+    const Declaration* result = lookup(textOf(current));
+    if (result == nullptr)
+        return failAtLine(current.line, "переменная возврата '" + string(textOf(current)) + "' не объявлена");
+    if (result->type != functionType)
+        return failAtLine(current.line, string("несоответствие типа возврата '") + typeName(result->type) +
+            "' с типом функции '" + typeName(functionType) + "'");
+    advance();
+    if (current.type != TokenType::SEMICOLON)
+        return failAfter(previous, "ожидалась ;");
+    advance();
+    if (current.type != TokenType::RBRACE)
+        return failAfter(previous, "ожидалась }");
+    advance();
+    return true;
+}
+
+// Import → import Id ; - функции модуля берутся из его интерфейса
+bool Validator::importModule()
+{
+    advance();
+    if (current.type != TokenType::ID)
+        return fail(current, "ожидалось имя модуля");
+
+    string module(textOf(current));
+    if (find(importedModules.begin(), importedModules.end(), module) == importedModules.end())
+    {
+        importedModules.push_back(module);
+        string loadError = "импорт модулей недоступен";
+        const InterfaceFile* ifc = interfaces != nullptr ? interfaces->load(module, loadError) : nullptr;
+        if (ifc == nullptr)
+            return fail(current, loadError);
+        for (size_t i = 0; i < ifc->functionCount(); i++)
+        {
+            FunctionSignature signature;
+            if (!ifc->function(i, signature))
+                return fail(current, "интерфейс модуля '" + module + "' поврежден");
+            importedSignatures.push_back(move(signature));
+        }
+        // Ключи ссылаются на строки importedSignatures, которые могли переехать, - индекс строится заново
+        importedFunctions.clear();
+        for (size_t i = 0; i < importedSignatures.size(); i++)
+            if (!importedFunctions.emplace(importedSignatures[i].name, i).second)
+                return fail(current, "функция '" + importedSignatures[i].name + "' импортирована из нескольких модулей");
+    }
+    advance();
+    return expect(TokenType::SEMICOLON, "ожидалась ; после имени модуля");
+}
+
+// Param → Type Id
+bool Validator::parameter()
+{
+    if (current.type != TokenType::INT && current.type != TokenType::DOUBLE)
+        return fail(current, "ожидался тип параметра");
+    ValueType type = current.type == TokenType::INT ? ValueType::INT : ValueType::DOUBLE;
+    advance();
+    if (current.type != TokenType::ID)
+        return fail(current, "ожидалось имя параметра");
+    if (declare(textOf(current), type) < 0)
+        return failAtLine(current.line, "повторное объявление переменной '" + string(textOf(current)) + "'");
+    advance();
+    return true;
+}
+
+// Descriptions → Descr Descriptions | ε, Descr → Type VarList ;
+bool Validator::descriptions()
+{
+    while (true)
+    {
+        DescrRecovery recovery = current.type == TokenType::ID ? predictDescrRecovery(lookahead.type) : DescrRecovery::NONE;
+        if (recovery == DescrRecovery::UNKNOWN_TYPE)
+            return fail(current, "неизвестный тип '" + string(textOf(current)) + "'");
+        if (recovery == DescrRecovery::WITHOUT_TYPE)
+            return fail(current, "ожидался тип (int или double) перед '" + string(textOf(current)) + "'");
+        if (predict(NonTerminal::DESCRIPTIONS, current.type) != Production::DESCRIPTIONS_LIST)
+            return true;
+
+        ValueType type = current.type == TokenType::INT ? ValueType::INT : ValueType::DOUBLE;
+        advance();
+        if (current.type == TokenType::COMMA)
+            return fail(current, "неожиданная запятая перед идентификатором");
+        if (current.type != TokenType::ID)
+            return fail(current, "ожидался идентификатор в объявлении");
+        while (true)
+        {
+            if (declare(textOf(current), type) < 0)
+                return failAtLine(current.line, "повторное объявление переменной '" + string(textOf(current)) + "'");
+            advance();
+            if (current.type != TokenType::COMMA)
+                break;
+            advance();
+            if (current.type != TokenType::ID)
+                return fail(current, "ожидался идентификатор после ,");
+        }
+
+        if (current.type != TokenType::SEMICOLON)
+        {
+            if (current.type == TokenType::ID && current.line == previous.line)
+                return fail(current, "отсутствует ',' между переменными");
+            if (current.line != previous.line || inSet(SYNC_VARLIST, current.type))
+                return failAfter(previous, "ожидалась ;");
+            return fail(current, "ожидалась ',' вместо '" + string(textOf(current)) + "'");
+        }
+        advance();
+    }
+}
+
+// Operators → Op Operators | ε, Op → Id = Expr ; | { Descriptions Operators }
+bool Validator::operators()
+{
+    NestingGuard guard(nesting, budget, stack);
+    while (true)
+    {
+        if (current.type == TokenType::ID)
+        {
+            if (!assignment())
+                return false;
+        }
+        else if (current.type == TokenType::LBRACE)
+        {
+            advance();
+            level++;
+            if (!descriptions() || !operators())
+                return false;
+            exitScope();
+            if (current.type != TokenType::RBRACE)
+                return failAfter(previous, "ожидалась }");
+            advance();
+        }
+        else
+            break;
+    }
+
+    if (current.type == TokenType::INT || current.type == TokenType::DOUBLE)
+        return fail(current, "объявление переменных после операторов");
+    if (current.type == TokenType::ASSIGN)
+        return fail(current, "ожидался идентификатор в левой части присваивания");
+    return true;
+}
+
+bool Validator::assignment()
+{
+    Lexeme target = current;
+    const Declaration* declaration = lookup(textOf(target));
+    if (declaration == nullptr)
+        return failAtLine(target.line, "использование необъявленной переменной '" + string(textOf(target)) + "'");
+    advance();
+    if (current.type != TokenType::ASSIGN)
+        return fail(current, "ожидался = после идентификатора");
+    advance();
+
+    int64_t exprLine = current.line;
+    ValueType type;
+    if (!expr(type))
+        return false;
+    if (current.type == TokenType::RPAREN)
+        return fail(current, "лишняя закрывающаяся скобка");
+    if (type != declaration->type)
+        return failAtLine(current.line, "несоответствие типов в присваивании '" + string(nameOf(names[declaration->name])) +
+            "' (" + typeName(declaration->type) + ") = выражение (" + typeName(type) + ")");
+
+    // Как в полном анализе: выражение и ; - на одной строке
+    if (current.line != exprLine || current.type != TokenType::SEMICOLON)
+        return failAfter(current.line != exprLine ? previous : current, "ожидалась ;");
+    advance();
+    return true;
+}
+
+// Expr → SimpleExpr | SimpleExpr + Expr | SimpleExpr - Expr
+// Цепочка разбирается циклом и, как в полном анализе, левоассоциативна: операция
+// проверяется сразу за своим правым операндом, левый - вся цепочка до нее.
+bool Validator::expr(ValueType& type)
+{
+    NestingGuard guard(nesting, budget, stack);
+    if (!simpleExpr(type))
+        return false;
+
+    while (true)
+    {
+        if (current.type == TokenType::MULT || current.type == TokenType::DIV)
+            return fail(current, "операция '" + string(textOf(current)) + "' не поддерживается");
+        if (current.type != TokenType::PLUS && current.type != TokenType::MINUS)
+            break;
+
+        const char* op = current.type == TokenType::PLUS ? "+" : "-";
+        advance();
+        ValueType right;
+        if (!simpleExpr(right))
+            return false;
+        if (right != type)  // Без ошибок тип цепочки - тип первого операнда
+            return failAtLine(current.line, string("неявное преобразование типов в операции '") + op + "' между " +
+                typeName(type) + " и " + typeName(right));
+    }
+    return true;
+}
+
+// SimpleExpr → Id | Const | ( Expr ) | itod ( Expr ) | dtoi ( Expr ) | Id ( Args )
+bool Validator::simpleExpr(ValueType& type)
+{
+    switch (current.type)
+    {
+    case TokenType::ID:
+    {
+        string_view name = textOf(current);
+        if (lookahead.type == TokenType::LPAREN)
+        {
+            auto callee = importedFunctions.find(name);
+            if (callee == importedFunctions.end())
+                return fail(current, "вызов неизвестной функции '" + string(name) + "'");
+            return callImported(importedSignatures[callee->second], type);
+        }
+        const Declaration* declaration = lookup(name);
+        if (declaration == nullptr)
+            return fail(current, "использование необъявленной переменной '" + string(name) + "' в выражении");
+        type = declaration->type;
+        advance();
+        return true;
+    }
+
+    case TokenType::INT_NUM:
+    case TokenType::DOUBLE_NUM:
+    {
+        // Значение разбирается так же, как в пуле констант, но без копии текста
+        const char* first = textOf(current).data();
+        Constant value;
+        type = current.type == TokenType::INT_NUM ? ValueType::INT : ValueType::DOUBLE;
+        if (!ConstantPool::parse(current.type, first, first + current.length, value))
+            return fail(current, "константа " + string(textOf(current)) + " вне диапазона " + typeName(type));
+        advance();
+        return true;
+    }
+
+    case TokenType::LPAREN:
+        advance();
+        return expr(type) && expect(TokenType::RPAREN, "ожидалась )");
+
+    case TokenType::ITOD:
+    case TokenType::DTOI:
+    {
+        bool toDouble = current.type == TokenType::ITOD;
+        string funcName = toDouble ? "itod" : "dtoi";
+        advance();
+        if (!expect(TokenType::LPAREN, "ожидалась ( после " + funcName))
+            return false;
+        ValueType argument;
+        if (!expr(argument))
+            return false;
+        ValueType expected = toDouble ? ValueType::INT : ValueType::DOUBLE;
+        if (argument != expected)
+            return failAtLine(current.line, "функция '" + funcName + "' ожидает аргумент типа '" + typeName(expected) +
+                "', получен '" + typeName(argument) + "'");
+        type = toDouble ? ValueType::DOUBLE : ValueType::INT;
+        return expect(TokenType::RPAREN, "ожидалась ) после выражения в " + funcName);
+    }
+
+    default:
+        return fail(current, "ожидалось простое выражение");
+    }
+}
+
+// Id ( Args ): Args → Expr ArgsTail | ε, ArgsTail → , Expr ArgsTail | ε
+bool Validator::callImported(const FunctionSignature& signature, ValueType& type)
+{
+    advance();  // Имя функции
+    if (!expect(TokenType::LPAREN, "ожидалась ( после " + signature.name))
+        return false;
+
+    size_t count = 0;
+    if (startsExpr(current.type))
+    {
+        while (true)
+        {
+            ValueType argument;
+            if (!expr(argument))
+                return false;
+            if (count < signature.params.size() && argument != signature.params[count])
+                return failAtLine(current.line, "функция '" + signature.name + "' ожидает аргумент " + to_string(count + 1) +
+                    " типа '" + typeName(signature.params[count]) + "', получен '" + typeName(argument) + "'");
+            count++;
+            if (current.type != TokenType::COMMA)
+                break;
+            advance();
+        }
+    }
+    if (count != signature.params.size())
+        return fail(current, "функция '" + signature.name + "' ожидает аргументов: " + to_string(signature.params.size()) +
+            ", передано: " + to_string(count));
+
+    type = signature.returnType;
+    return expect(TokenType::RPAREN, "ожидалась ) после аргументов " + signature.name);
+}
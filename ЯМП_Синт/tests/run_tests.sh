@@ -0,0 +1,275 @@
+#!/bin/bash
+# Проверки поведения анализатора на небольших программах.
+# Запуск: tests/run_tests.sh <путь к собранному анализатору>
+# Каждая группа проверок работает в своем временном каталоге: программа
+# записывается в input.txt, отчет читается из output.txt. Вывод анализатора
+# в кодировке Windows-1251 перекодируется в UTF-8 для сравнения.
+
+ANALYZER="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+TESTS="$(cd "$(dirname "$0")" && pwd)"
+if [ ! -x "$ANALYZER" ]; then
+    echo "Использование: $0 <путь к анализатору>"
+    exit 2
+fi
+
+WORK=""
+FAILED=0
+PASSED=0
+
+fresh()         # Новый пустой рабочий каталог
+{
+    [ -n "$WORK" ] && rm -rf "$WORK"
+    WORK="$(mktemp -d)"
+}
+
+program()       # program <файл из tests> | program - (текст со стандартного входа)
+{
+    if [ "$1" = "-" ]; then
+        cat > "$WORK/input.txt"
+    else
+        cp "$TESTS/$1" "$WORK/input.txt"
+    fi
+}
+
+run()           # run <параметры>: вывод - в OUT, отчет - в REPORT, код возврата - в STATUS
+{
+    rm -f "$WORK/output.txt"
+    (cd "$WORK" && "$ANALYZER" "$@" > "$WORK/.stdout" 2>&1)
+    STATUS=$?
+    OUT="$(iconv -f cp1251 -t utf-8 "$WORK/.stdout")"
+    REPORT=""
+    [ -f "$WORK/output.txt" ] && REPORT="$(iconv -f cp1251 -t utf-8 "$WORK/output.txt")"
+}
+
+check()         # check <название> <ожидаемая подстрока> <текст>
+{
+    if [[ "$3" == *"$2"* ]]; then
+        PASSED=$((PASSED + 1))
+    else
+        FAILED=$((FAILED + 1))
+        echo "ОШИБКА: $1"
+        echo "  ожидалось: $2"
+        echo "  получено:  $(printf '%s' "$3" | head -c 400)"
+    fi
+}
+
+check_equal()   # check_equal <название> <ожидаемый текст> <текст>
+{
+    if [ "$2" = "$3" ]; then
+        PASSED=$((PASSED + 1))
+    else
+        FAILED=$((FAILED + 1))
+        echo "ОШИБКА: $1"
+        echo "  ожидалось: $2"
+        echo "  получено:  $3"
+    fi
+}
+
+chain()         # chain <N>: программа с присваиванием суммы N единиц
+{
+    printf 'int main() {\n    int x;\n    x = 1'
+    for ((i = 1; i < $1; i++)); do printf ' + 1'; done
+    printf ';\n    return x;\n}\n'
+}
+
+nested()        # nested <N>: программа с N вложенными скобками
+{
+    printf 'int main() {\n    int x;\n    x = '
+    for ((i = 0; i < $1; i++)); do printf '('; done
+    printf '1'
+    for ((i = 0; i < $1; i++)); do printf ')'; done
+    printf ';\n    return x;\n}\n'
+}
+
+# --- Глубина вложенности (--limit-depth) ---
+fresh
+chain 1100 | program -
+run --no-cache
+check "длинная цепочка +: текстовое дерево" "Синтаксический анализ: УСПЕХ" "$OUT"
+run --no-cache --tree json
+check "длинная цепочка +: дерево JSON" "Синтаксический анализ: УСПЕХ" "$OUT"
+run --no-cache --limit-depth 3
+check "цепочка + не считается вложенностью" "Синтаксический анализ: УСПЕХ" "$OUT"
+run --check --limit-depth 3
+check "цепочка + не считается вложенностью (--check)" "программа корректна" "$OUT"
+nested 10 | program -
+run --no-cache --limit-depth 5
+check "вложенные скобки сверх --limit-depth" "анализ прерван: превышена глубина вложенности (5)" "$REPORT"
+run --check --limit-depth 5
+check "вложенные скобки сверх --limit-depth (--check)" "анализ прерван: превышена глубина вложенности (5)" "$OUT"
+
+# --- Позиция после лексемы считается в символах, а не в байтах ---
+fresh
+program - <<'END'
+int main() {
+    int x;
+    x = 1 я
+    return x;
+}
+END
+run --no-cache
+check "позиция после многобайтовой лексемы" "строка 3, позиция 12: ожидалась ;" "$REPORT"
+run --no-cache --stream 3
+check "позиция после многобайтовой лексемы (--stream)" "строка 3, позиция 12: ожидалась ;" "$REPORT"
+run --check
+check "позиция после многобайтовой лексемы (--check)" "строка 3, позиция 12: ожидалась ;" "$OUT"
+program - <<'END'
+int main() {
+    int x;
+    x = 1 + я;
+    return x;
+}
+END
+run --no-cache
+check "позиция после многобайтовой лексемы в выражении" "строка 3, позиция 14: ожидалась ;" "$REPORT"
+
+# --- Идентификатор на месте типа: ветвь выбирает токен после него ---
+fresh
+program - <<'END'
+int main() {
+    x, y;
+    int z;
+    z = 1;
+    return z;
+}
+END
+run --no-cache
+check "объявление без типа" "строка 2, позиция 8: ожидался тип (int или double) перед 'y'" "$REPORT"
+run --check
+check "объявление без типа (--check)" "строка 2, позиция 5: ожидался тип (int или double) перед 'x'" "$OUT"
+program - <<'END'
+int main() {
+    float a, b;
+    a = 1;
+    return a;
+}
+END
+run --no-cache
+check "объявление с неизвестным типом" "строка 2, позиция 5: неизвестный тип 'float'" "$REPORT"
+run --check
+check "объявление с неизвестным типом (--check)" "строка 2, позиция 5: неизвестный тип 'float'" "$OUT"
+program - <<'END'
+int main() {
+    int z;
+    z = 1;
+    return z;
+}
+END
+run --check
+check "присваивание после объявлений - оператор" "программа корректна" "$OUT"
+
+# --- Цепочка + и - левоассоциативна: a - b - c = (a - b) - c ---
+fresh
+program - <<'END'
+int f(int a, int b, int c) {
+    int x;
+    x = a - b - c - 1;
+    return x;
+}
+END
+run --no-cache --emit-bytecode f.bc
+check "постфиксная запись цепочки -" "a b - c - 1 - x =" "$REPORT"
+run --exec f.bc 10 5 1
+check "исполнение a - b - c - 1" "f = 3" "$OUT"
+run --exec f.bc 0 5 1
+check "исполнение a - b - c - 1 с отрицательным результатом" "f = -7" "$OUT"
+printf '10 5 1\n0 5 1\n' > "$WORK/values.txt"
+run --no-cache --batch values.txt results.txt
+check_equal "пакетное вычисление a - b - c - 1" "$(printf '3\n-7')" "$(cat "$WORK/results.txt")"
+
+# --- Вещественный литерал: потеря значимости - ноль, переполнение - ошибка ---
+fresh
+tiny="0.$(printf '%0400d' 0)1"
+huge="1$(printf '%0400d' 0).0"
+printf 'double f(double a) {\n    double x;\n    x = a + %s;\n    return x;\n}\n' "$tiny" | program -
+run --no-cache --emit-bytecode f.bc
+check "литерал меньше наименьшего double" "Синтаксический анализ: УСПЕХ" "$OUT"
+run --check
+check "литерал меньше наименьшего double (--check)" "программа корректна" "$OUT"
+run --exec f.bc 2.5
+check "литерал меньше наименьшего double равен нулю" "f = 2.5" "$OUT"
+printf 'double f(double a) {\n    double x;\n    x = a + %s;\n    return x;\n}\n' "$huge" | program -
+run --no-cache
+check "литерал больше наибольшего double" "строка 3, позиция 13: константа $huge" "$REPORT"
+run --check
+check "литерал больше наибольшего double (--check)" "строка 3, позиция 13: константа $huge" "$OUT"
+
+# --- Байт-код: исполнение из файла совпадает с вычислением по IR ---
+fresh
+program - <<'END'
+double f(int a, double b) {
+    int n;
+    double r;
+    n = a - 3 - dtoi(b);
+    {
+        double t;
+        t = itod(n) + b - 0.25;
+        r = t - 1.5 + itod(a);
+    }
+    return r;
+}
+END
+printf '10 2.75\n0 -4.5\n-7 0.125\n' > "$WORK/values.txt"
+run --no-cache --emit-bytecode f.bc --batch values.txt results.txt
+check_equal "пакетное вычисление по IR" "$(printf '16\n-5.25\n-18.625')" "$(cat "$WORK/results.txt")"
+while read -r a b expected; do
+    run --exec f.bc "$a" "$b"
+    check_equal "исполнение байт-кода f($a, $b)" "f = $expected" "$OUT"
+done < <(paste -d ' ' "$WORK/values.txt" "$WORK/results.txt")
+size=$(wc -c < "$WORK/f.bc")
+for ((length = 0; length < size; length++)); do
+    head -c $length "$WORK/f.bc" > "$WORK/cut.bc"
+    run --exec cut.bc 1 2
+    check "обрезанный байт-код ($length байт из $size) отвергается" "Байт-код не исполнен:" "$OUT"
+done
+
+# --- Кеш результатов: попадание только при совпадении входа, а не одного хеша ---
+fresh
+program - <<'END'
+int main() {
+    int x;
+    x = 1;
+    return x;
+}
+END
+run --cache-dir cache
+first="$REPORT"
+entry="$(ls "$WORK/cache")"
+check_equal "кеш: одна запись после первого анализа" "1" "$(ls "$WORK/cache" | wc -l | tr -d ' ')"
+sed -i '1s/^\(\S* \S* \S*\) 1 /\1 0 /' "$WORK/cache/$entry"    # Итог в записи - ОШИБКИ
+run --cache-dir cache
+check "кеш: повторный анализ берет отчет из записи" "Синтаксический анализ: ОШИБКИ" "$OUT"
+check_equal "кеш: отчет из записи совпадает с первым" "$first" "$REPORT"
+run --no-cache
+check "--no-cache не читает кеш" "Синтаксический анализ: УСПЕХ" "$OUT"
+program - <<'END'
+int main() {
+    int y;
+    y = 2;
+    return y;
+}
+END
+run --cache-dir cache
+other="$(ls "$WORK/cache" | grep -v "^$entry$")"
+check "кеш: измененный вход - промах" "Синтаксический анализ: УСПЕХ" "$OUT"
+# Запись первой программы под ключом второй - как при совпадении 64-битных хешей
+key="$(basename "$other" .cache | sed 's/^0*//')"
+sed "1s/^\(\S* \S*\) \S* /\1 $key /" "$WORK/cache/$entry" > "$WORK/cache/$other"
+run --cache-dir cache
+check "кеш: совпадение хеша при другом входе - промах" "Синтаксический анализ: УСПЕХ" "$OUT"
+check "кеш: отчет построен по текущему входу" "Id: y" "$REPORT"
+
+# --- Оборванная программа: --check сообщает ту же первую ошибку, что и полный анализ ---
+fresh
+text="$(cat "$TESTS/truncated.txt")"
+for ((length = 0; length < ${#text}; length++)); do
+    printf '%s' "${text:0:length}" | program -
+    run --no-cache
+    full="$(printf '%s\n' "$REPORT" | sed -n '/=== ОШИБКИ ===/,$p' | grep -m 1 '^строка')"
+    run --check
+    check_equal "оборванная программа ($length символов): --check и полный анализ" "$full" "${OUT#Проверка: }"
+done
+
+[ -n "$WORK" ] && rm -rf "$WORK"
+echo "Проверок пройдено: $PASSED, не пройдено: $FAILED"
+[ $FAILED -eq 0 ]